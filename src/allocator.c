@@ -6,20 +6,197 @@
 #include "dyn_array.h"
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(PLATFORM_LINUX)
+    #define ARENA_HUGE_PAGES_SUPPORTED
+    #include <sys/mman.h>
+#endif
+
+#if defined(_MSC_VER)
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL _Thread_local
+#endif
+
+// blocks released by the arenas of this thread
+static THREAD_LOCAL MemBlock *block_cache = NULL;     // dyn_array
+static THREAD_LOCAL size_t block_cache_bytes = 0;
+
+// allocation statistics of this thread
+bool mem_stats__enabled = false;
+static THREAD_LOCAL MemStats stats[MemTagCount];
+static THREAD_LOCAL MemTag stats_tag = MemTagOther;
+
+static const char *stats_tag_names[MemTagCount] = {"other", "module", "simulator", "frame", "text"};
+
+static inline void stats_reserve(MemTag tag, size_t size) {
+    MemStats *s = &stats[tag];
+    s->blocks_allocated++;
+    s->bytes_reserved += size;
+    s->peak_reserved = MAX(s->peak_reserved, s->bytes_reserved);
+}
+
+static inline void stats_release(MemTag tag, size_t size) {
+    /* the block may have been allocated before the statistics were enabled */
+    stats[tag].bytes_reserved -= MIN(size, stats[tag].bytes_reserved);
+}
+
+static inline bool block_alloc_mapped(size_t size, MemBlock *block) {
+#ifdef ARENA_HUGE_PAGES_SUPPORTED
+    /* only the parts of a mapping that are aligned to a huge page can be backed by one:
+       map an extra huge page and trim the mapping to an aligned range */
+    size = ALIGN_UP(size, (size_t) ARENA_HUGE_PAGE_SIZE);
+    size_t map_size = size + ARENA_HUGE_PAGE_SIZE;
+
+    uint8_t *mapping = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    uint8_t *data = PTR_ALIGN_UP(mapping, ARENA_HUGE_PAGE_SIZE);
+    if (data > mapping) {
+        munmap(mapping, data - mapping);
+    }
+    if (data + size < mapping + map_size) {
+        munmap(data + size, (mapping + map_size) - (data + size));
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(data, size, MADV_HUGEPAGE);     // only a hint, the kernel may not have huge pages available
+#endif
+
+    *block = (MemBlock) {.data = data, .size = size, .kind = MemBlockMapped};
+    return true;
+#else
+    (void) size;
+    (void) block;
+    return false;
+#endif
+}
+
+static inline MemBlock block_alloc(size_t size, size_t align, bool huge_pages) {
+    MemBlock block = {.size = size, .kind = MemBlockMalloc};
+
+    if (huge_pages && size >= ARENA_HUGE_PAGE_SIZE && block_alloc_mapped(size, &block)) {
+        return block;
+    }
+
+    if (align <= _Alignof(max_align_t)) {
+        block.data = malloc(size);
+    } else {
+        block.kind = MemBlockAligned;
+#if defined(_WIN32)
+        block.data = _aligned_malloc(size, align);
+#else
+        void *data = NULL;
+        block.data = (posix_memalign(&data, align, size) == 0) ? data : NULL;
+#endif
+    }
+
+    return block;
+}
+
+static inline void block_free(MemBlock block) {
+    switch (block.kind) {
+        case MemBlockMalloc:
+            free(block.data);
+            break;
+        case MemBlockAligned:
+#if defined(_WIN32)
+            _aligned_free(block.data);
+#else
+            free(block.data);
+#endif
+            break;
+        case MemBlockMapped:
+#ifdef ARENA_HUGE_PAGES_SUPPORTED
+            munmap(block.data, block.size);
+#endif
+            break;
+    }
+}
+
+static inline bool block_cache_take(size_t min_size, size_t align, bool mapped, MemBlock *block) {
+/* reuse a cached block that is large enough, but not more than twice the size that's needed.
+   Both the start and the size of the block must be aligned: the arena aligns its pointer after each allocation
+   and would step over the end of a block with an unaligned size. */
+    for (size_t idx = arr_len(block_cache); idx > 0; --idx) {
+        MemBlock *cached = &block_cache[idx - 1];
+        if (cached->size >= min_size && cached->size / 2 <= min_size &&
+            ((uintptr_t) cached->data & (align - 1)) == 0 && (cached->size & (align - 1)) == 0 &&
+            (!mapped || cached->kind == MemBlockMapped)) {
+            *block = *cached;
+            *cached = arr_pop(block_cache);
+            block_cache_bytes -= block->size;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline void block_cache_put(MemBlock block) {
+    if (block_cache_bytes + block.size > ARENA_CACHE_MAX_BYTES) {
+        block_free(block);
+        return;
+    }
+
+    arr_push(block_cache, block);
+    block_cache_bytes += block.size;
+}
 
 static inline void mem_arena_grow(MemArena *arena, size_t min_size) {
     size_t new_size = ALIGN_UP(MAX(min_size, arena->block_size), arena->align);
     
-    arena->ptr = malloc(new_size);
-    assert(arena->ptr == PTR_ALIGN_DOWN(arena->ptr, arena->align));
+    bool mapped = arena->huge_pages && new_size >= ARENA_HUGE_PAGE_SIZE;
+
+    MemBlock block;
+    bool reused = block_cache_take(new_size, arena->align, mapped, &block);
+    if (!reused) {
+        block = block_alloc(new_size, arena->align, arena->huge_pages);
+    }
+    assert(block.data != NULL);
+    assert(block.data == PTR_ALIGN_DOWN(block.data, arena->align));
+    block.tag = (arena->tag != MemTagOther) ? arena->tag : stats_tag;
+
+    if (mem_stats__enabled) {
+        if (arr_len(arena->blocks) > 0) {
+            stats[arr_end(arena->blocks)[-1].tag].bytes_wasted += arena->end - arena->ptr;
+        }
+        stats_reserve(block.tag, block.size);
+        stats[block.tag].blocks_reused += reused;
+    }
     
-    arena->end = arena->ptr + new_size;
-    arr_push(arena->blocks, arena->ptr);
+    arena->ptr = block.data;
+    arena->end = block.data + block.size;
+    arr_push(arena->blocks, block);
+}
+
+static inline void mem_arena_release_blocks(MemArena *arena, size_t keep) {
+/* return the blocks after the first keep blocks to the cache */
+    while (arr_len(arena->blocks) > keep) {
+        MemBlock block = arr_pop(arena->blocks);
+        if (mem_stats__enabled) {
+            stats_release(block.tag, block.size);
+        }
+        block_cache_put(block);
+    }
+
+    if (keep > 0) {
+        MemBlock *last = &arena->blocks[keep - 1];
+        arena->end = last->data + last->size;
+    } else {
+        arena->ptr = NULL;
+        arena->end = NULL;
+    }
 }
 
 void mem_arena_init(MemArena *arena, size_t block_size, uint32_t align) {
     assert(arena);
+    assert(align > 0 && (align & (align - 1)) == 0);
     
     *arena = (MemArena) {
         .block_size = block_size,
@@ -27,13 +204,22 @@ void mem_arena_init(MemArena *arena, size_t block_size, uint32_t align) {
     };
 }
 
+void mem_arena_use_huge_pages(MemArena *arena) {
+    assert(arena);
+    arena->huge_pages = true;
+}
+
 void *mem_arena_allocate(MemArena *arena, size_t num_bytes) {
     
     assert(arena);
     
-    if (num_bytes > (arena->end - arena->ptr)) {
+    if (arena->ptr > arena->end || num_bytes > (size_t) (arena->end - arena->ptr)) {
         mem_arena_grow(arena, num_bytes);
     }
+
+    if (mem_stats__enabled && arena->blocks) {
+        stats[arr_end(arena->blocks)[-1].tag].bytes_requested += num_bytes;
+    }
     
     void *result = arena->ptr;
     
@@ -46,8 +232,103 @@ void *mem_arena_allocate(MemArena *arena, size_t num_bytes) {
 void mem_arena_free(MemArena *arena) {
     assert(arena);
     
-    for (uint8_t **iter = arena->blocks; iter != arr_end(arena->blocks); ++iter) {
-        free(*iter);
-    }
+    mem_arena_release_blocks(arena, 0);
     arr_free(arena->blocks);
 }
+
+MemArenaMark mem_arena_mark(MemArena *arena) {
+    assert(arena);
+
+    return (MemArenaMark) {
+        .num_blocks = arr_len(arena->blocks),
+        .ptr = arena->ptr
+    };
+}
+
+void mem_arena_rewind_to(MemArena *arena, MemArenaMark mark) {
+    assert(arena);
+    assert(mark.num_blocks <= arr_len(arena->blocks));
+
+    mem_arena_release_blocks(arena, mark.num_blocks);
+    if (mark.num_blocks > 0) {
+        arena->ptr = mark.ptr;
+    }
+}
+
+void mem_arena_reset(MemArena *arena) {
+    assert(arena);
+
+    if (arr_len(arena->blocks) > 0) {
+        mem_arena_release_blocks(arena, 1);
+        arena->ptr = arena->blocks[0].data;
+    }
+}
+
+void mem_arena_release_cache(void) {
+    for (MemBlock *block = block_cache; block != arr_end(block_cache); ++block) {
+        block_free(*block);
+    }
+    arr_free(block_cache);
+    block_cache_bytes = 0;
+}
+
+void mem_stats_enable(bool enable) {
+    mem_stats__enabled = enable;
+    mem_stats_reset();
+}
+
+MemTag mem_stats_set_tag(MemTag tag) {
+    assert(tag < MemTagCount);
+
+    MemTag prev = stats_tag;
+    stats_tag = tag;
+    return prev;
+}
+
+void mem_stats_track_alloc(MemTag tag, size_t size) {
+    assert(tag < MemTagCount);
+
+    if (mem_stats__enabled) {
+        stats[tag].bytes_requested += size;
+        stats_reserve(tag, size);
+    }
+}
+
+void mem_stats_track_free(MemTag tag, size_t size) {
+    assert(tag < MemTagCount);
+
+    if (mem_stats__enabled) {
+        stats_release(tag, size);
+    }
+}
+
+void mem_stats__array_grow(size_t old_bytes, size_t new_bytes, size_t used_bytes) {
+    MemStats *s = &stats[stats_tag];
+    s->array_grows++;
+    s->array_bytes_grown += new_bytes - old_bytes;
+    s->array_bytes_copied += used_bytes;
+}
+
+const MemStats *mem_stats_get(MemTag tag) {
+    assert(tag < MemTagCount);
+    return &stats[tag];
+}
+
+void mem_stats_reset(void) {
+    memset(stats, 0, sizeof(stats));
+}
+
+void mem_stats_report(char **output) {
+    assert(output);
+
+    arr_printf(*output, "%-10s %12s %12s %12s %8s %8s %10s %8s %12s %12s\n",
+               "memory", "requested", "reserved", "peak", "blocks", "reused", "wasted", "grows", "grown", "copied");
+
+    for (int tag = 0; tag < MemTagCount; ++tag) {
+        const MemStats *s = &stats[tag];
+        arr_printf(*output, "%-10s %12zu %12zu %12zu %8zu %8zu %10zu %8zu %12zu %12zu\n",
+                   stats_tag_names[tag], s->bytes_requested, s->bytes_reserved, s->peak_reserved,
+                   s->blocks_allocated, s->blocks_reused, s->bytes_wasted,
+                   s->array_grows, s->array_bytes_grown, s->array_bytes_copied);
+    }
+}
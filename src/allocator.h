@@ -9,6 +9,43 @@
 #include "types.h"
 
 // types
+typedef enum MemBlockKind {
+    MemBlockMalloc,         // malloc, the alignment of malloc is sufficient
+    MemBlockAligned,        // over-aligned allocation
+    MemBlockMapped          // mapped directly from the OS, may be backed by huge pages
+} MemBlockKind;
+
+// owner of allocations in the statistics (see mem_stats_enable)
+typedef enum MemTag {
+    MemTagOther,            // arenas: the tag of the calling thread when a block is allocated (see mem_stats_set_tag)
+    MemTagModule,
+    MemTagSimulator,        // includes the memory image of the simulator
+    MemTagFrame,
+    MemTagText,
+    MemTagCount
+} MemTag;
+
+typedef struct MemStats {
+    // arenas (and other tracked blocks)
+    size_t bytes_requested;     // sum of the sizes passed to mem_arena_allocate
+    size_t bytes_reserved;      // size of the blocks currently held
+    size_t peak_reserved;       // high-water mark of bytes_reserved
+    size_t blocks_allocated;
+    size_t blocks_reused;       // blocks taken from the block cache instead of allocated
+    size_t bytes_wasted;        // unused space at the end of a block when the arena moved to the next block
+    // dyn_arrays
+    size_t array_grows;         // calls to arr__grow (one realloc each)
+    size_t array_bytes_grown;   // capacity added by the grows
+    size_t array_bytes_copied;  // contents of the arrays at the time of the grow (realloc may have to copy it)
+} MemStats;
+
+typedef struct MemBlock {
+    uint8_t *data;
+    size_t size;
+    MemBlockKind kind;
+    MemTag tag;
+} MemBlock;
+
 typedef struct MemArena MemArena;
 struct MemArena {
     size_t block_size;
@@ -16,16 +53,64 @@ struct MemArena {
     
     uint8_t *ptr;
     uint8_t *end;
-    uint8_t **blocks;   // dyn_array
+    MemBlock *blocks;   // dyn_array - the last block is the one being allocated from
+    bool huge_pages;    // see mem_arena_use_huge_pages
+    MemTag tag;         // owner in the statistics, set after mem_arena_init
 };
 
+// position in an arena, everything allocated after it is released by mem_arena_rewind_to
+typedef struct MemArenaMark {
+    size_t num_blocks;
+    uint8_t *ptr;
+} MemArenaMark;
+
 #define ARENA_DEFAULT_SIZE (1024 * 1024)
 #define ARENA_DEFAULT_ALIGN 8
+#define ARENA_SIMD_ALIGN 32             // wide enough for AVX loads and stores
+
+// blocks of at least this size can be backed by (transparent) huge pages
+#define ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// the blocks released by arenas are kept in a per-thread cache (up to this many bytes) for the next arena that grows
+#define ARENA_CACHE_MAX_BYTES (4 * ARENA_DEFAULT_SIZE)
 
 // interface functions
+// the alignment can be larger than the alignment of malloc (e.g. ARENA_SIMD_ALIGN or a cache line)
 void mem_arena_init(MemArena *arena, size_t block_size, uint32_t align);
+// blocks of ARENA_HUGE_PAGE_SIZE or larger are mapped from the OS and marked for huge pages (Linux only, ignored elsewhere)
+void mem_arena_use_huge_pages(MemArena *arena);
 void *mem_arena_allocate(MemArena *arena, size_t num_bytes);
 void mem_arena_free(MemArena *arena);
 
+MemArenaMark mem_arena_mark(MemArena *arena);
+void mem_arena_rewind_to(MemArena *arena, MemArenaMark mark);
+// release all allocations but keep the first block of the arena
+void mem_arena_reset(MemArena *arena);
+
+// free the blocks in the cache of the calling thread (e.g. before the thread exits)
+void mem_arena_release_cache(void);
+
+// allocation statistics: off by default, the counters are kept per thread.
+// Enable before the allocations of interest are made, the statistics start from zero.
+extern bool mem_stats__enabled;
+
+void mem_stats_enable(bool enable);
+static inline bool mem_stats_enabled(void) {
+    return mem_stats__enabled;
+}
+
+// the owner of the dyn_array grows and untagged arena blocks on this thread, returns the previous tag
+MemTag mem_stats_set_tag(MemTag tag);
+// track memory that isn't allocated by an arena (e.g. the memory image of the simulator)
+void mem_stats_track_alloc(MemTag tag, size_t size);
+void mem_stats_track_free(MemTag tag, size_t size);
+
+const MemStats *mem_stats_get(MemTag tag);
+void mem_stats_reset(void);
+// append a table of the statistics of the calling thread to output (dyn_array)
+void mem_stats_report(char **output);
+
+// internal: called by arr__grow
+void mem_stats__array_grow(size_t old_bytes, size_t new_bytes, size_t used_bytes);
 
 #endif /* JS_ALLOCATOR_H */
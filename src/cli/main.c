@@ -8,6 +8,8 @@
 #include "spirv_text.h"
 #include "spirv_module.h"
 #include "spirv_simulator.h"
+#include "spirv_corpus.h"
+#include "thread_pool.h"
 #include "runner.h"
 
 #include "spirv/spirv.h"
@@ -26,57 +28,79 @@ void execute_runner(const char *filename) {
 
 void disassemble_spirv_shader(const char *filename) {
 
-    int8_t *data;
+    FileMapping file;
 
-    if (file_load_binary(filename, &data) == 0) {
+    if (!file_map(filename, false, &file)) {
+        fatal_error("Error opening file %s", filename);
         return;
     }
 
+    if (file.size % 4 != 0) {
+        fatal_error("SPIR-V binary length should be a multiple of 32bit");
+    }
+
     SPIRV_binary spirv_bin;
     SPIRV_module spirv_mod;
 
-    if (!spirv_bin_load(&spirv_bin, data)) {
+    if (!spirv_bin_load_borrowed(&spirv_bin, file.data, file.size / 4)) {
         fatal_error(spirv_bin.error_msg);
         return;
     }
 
-    spirv_module_load(&spirv_mod, &spirv_bin);
-    spirv_bin_opcode_rewind(&spirv_bin);
+    if (!spirv_module_load(&spirv_mod, &spirv_bin)) {
+        fatal_error(spirv_mod.error_msg);
+        return;
+    }
 
     spirv_text_set_flag(&spirv_mod, SPIRV_TEXT_USE_ID_NAMES, true);
     spirv_text_set_flag(&spirv_mod, SPIRV_TEXT_USE_TYPE_ALIAS, true);
     spirv_text_set_flag(&spirv_mod, SPIRV_TEXT_USE_CONSTANT_ALIAS, true);
 
-    char **output_lines = NULL;
-
-    for (int idx = 0; idx < spirv_text_header_num_lines(spirv_bin_header(&spirv_bin)); ++idx) {
-        char *line = spirv_text_header_line(spirv_bin_header(&spirv_bin), idx);
-        arr_push(output_lines, line);
+    if (!spirv_text_module_to_file(&spirv_mod, stdout)) {
+        fatal_error("Error writing the disassembly");
     }
 
-    for (SPIRV_opcode *op = spirv_bin_opcode_current(&spirv_bin); op != spirv_bin_opcode_end(&spirv_bin); op = spirv_bin_opcode_next(&spirv_bin)) {
-        char *line = spirv_text_opcode(op, &spirv_mod, NULL);
-        arr_push(output_lines, line);
+    spirv_module_free(&spirv_mod);
+    spirv_bin_free(&spirv_bin);
+    file_unmap(&file);
+}
+
+bool load_spirv_corpus(const char *dir) {
+
+    SPIRV_corpus corpus;
+
+    if (!spirv_corpus_scan(&corpus, dir)) {
+        fatal_error("Unable to list the files in %s", dir);
     }
 
-    for (char **it = output_lines; it != arr_end(output_lines); ++it) {
-        printf("%s\n", *it);
-        arr_free(*it);
+    uint64_t start = time_now_ns();
+    spirv_corpus_load(&corpus, thread_pool_num_cpus(), true);
+    uint64_t total_ns = time_now_ns() - start;
+
+    for (SPIRV_corpus_file *file = corpus.files; file != arr_end(corpus.files); ++file) {
+        if (file->success) {
+            printf("%10.3f ms  OK    %s\n", file->load_ns / 1e6, file->filename);
+        } else {
+            printf("%10.3f ms  FAIL  %s: %s\n", file->load_ns / 1e6, file->filename, file->error_msg);
+        }
     }
 
-    arr_free(output_lines);
-    spirv_module_free(&spirv_mod);
-    spirv_bin_free(&spirv_bin);
-    arr_free(data);
+    printf("%zu files, %u failed, %.3f ms\n", arr_len(corpus.files), corpus.num_failed, total_ns / 1e6);
+
+    bool success = corpus.num_failed == 0;
+    spirv_corpus_free(&corpus);
+    return success;
 }
 
 int main(int argc, char *argv[]) {
 
     // handle command line arguments (keep it simple for now)
     if (argc != 3) {
-        printf("Usage: %s [-r|-d] <input-file>\n", argv[0]);
+        printf("Usage: %s [-r|-d|-L] <input-file>\n", argv[0]);
         printf("  -r runner.json : to run the specified runner script\n");
         printf("  -d binary shader : to display the dissassembled shader\n");
+        printf("  -L directory : to load all shaders (*.spv) in the directory and report the time to load\n");
+        printf("                 and disassemble each one (the disassembly itself isn't printed)\n");
         return -1;
     }
 
@@ -87,6 +111,8 @@ int main(int argc, char *argv[]) {
         execute_runner(input_filename);
     } else if (!strcmp(input_cmd, "-d")) {
         disassemble_spirv_shader(input_filename);
+    } else if (!strcmp(input_cmd, "-L")) {
+        return load_spirv_corpus(input_filename) ? 0 : 1;
     } else {
         printf("Invalid command (%s)\n", input_cmd);
         return -1;
@@ -5,6 +5,7 @@
 #include "utils.h"
 #include "dyn_array.h"
 #include "spirv_simulator.h"
+#include "spirv_module_cache.h"
 #include "spirv_text.h"
 
 #include <stdlib.h>
@@ -25,21 +26,27 @@
 
 RUNNER_FUNC_BEGIN(CmdAssociateData)
 
-    spirv_sim_variable_associate_data(
-        runner->spirv_sim,
-        cmd->storage_class,
-        (VariableAccess) {cmd->var_if_type, cmd->var_if_index},
-        cmd->data, cmd->data_size);
+    if (cmd->intf == SIM_INTERFACE_INVALID) {
+        fatal_error("no interface found for variable (%d/%d/%d)", cmd->storage_class, cmd->var_if_type, cmd->var_if_index);
+        return false;
+    }
+
+    if (cmd->data_size > spirv_sim_interface(runner->spirv_sim, cmd->intf)->size) {
+        fatal_error("data for variable (%d/%d/%d) is larger than the variable", cmd->storage_class, cmd->var_if_type, cmd->var_if_index);
+        return false;
+    }
+
+    spirv_sim_interface_write(runner->spirv_sim, cmd->intf, cmd->data, cmd->data_size);
     return true;
 
 RUNNER_FUNC_END
 
-static void print_registers(SPIRV_simulator *sim, HashMap *reg_map) {
+static void print_registers(SPIRV_simulator *sim, RegisterMap *regs) {
     char *reg_str = NULL;
 
     // FIXME: sort output by ID
-    for (int iter = map_begin(reg_map); iter != map_end(reg_map); iter = map_next(reg_map, iter)) {
-        spirv_register_to_string(sim, map_val(reg_map, iter), &reg_str);
+    for (int iter = reg_map_begin(regs); iter != reg_map_end(regs); iter = reg_map_next(regs, iter)) {
+        spirv_register_to_string(sim, regs->slots[iter].val, &reg_str);
         printf("%s\n", reg_str);
         arr_clear(reg_str);
     }
@@ -74,24 +81,22 @@ RUNNER_FUNC_END
 
 RUNNER_FUNC_BEGIN(CmdCmpOutput)
 
-    SimPointer *result = spirv_sim_retrieve_intf_pointer(
-        runner->spirv_sim, ClassOutput,
-        (VariableAccess) {cmd->var_if_type, cmd->var_if_index});
-
     char *error_msg = NULL;
 
-    if (!result) {
+    if (cmd->intf == SIM_INTERFACE_INVALID) {
         fatal_error("no result found for that variable");
         return false;
     }
 
+    uint8_t *result = spirv_sim_interface_data(runner->spirv_sim, cmd->intf);
+
     switch (cmd->data_type) {
             
         case TypeVoid:
             break;
             
         case TypeBool: {
-            bool actual = *((bool *) (runner->spirv_sim->memory + result->pointer));
+            bool actual = *((bool *) result);
             bool expect = *((bool *) cmd->data);
 
             if (actual != expect) {
@@ -106,7 +111,7 @@ RUNNER_FUNC_BEGIN(CmdCmpOutput)
         case TypeInteger:
         case TypeVectorInteger:
         case TypeMatrixInteger: {
-            int32_t *actual = (int32_t *) (runner->spirv_sim->memory + result->pointer);
+            int32_t *actual = (int32_t *) result;
             int32_t *expect = (int32_t *) cmd->data;
             int32_t count = cmd->data_size / sizeof(int32_t);
 
@@ -123,7 +128,7 @@ RUNNER_FUNC_BEGIN(CmdCmpOutput)
         case TypeFloat:
         case TypeVectorFloat:
         case TypeMatrixFloat: {
-            float *actual = (float *) (runner->spirv_sim->memory + result->pointer);
+            float *actual = (float *) result;
             float *expect = (float *) cmd->data;
             int32_t count = cmd->data_size / sizeof(float);
 
@@ -426,6 +431,72 @@ bool runner_init(Runner *runner, const char *filename) {
         fatal_error("runner_init(): '%s' is not a valid language", lang->valuestring);
     }
 
+    /* precision of the transcendental functions (optional) */
+    const cJSON *precision = cJSON_GetObjectItemCaseSensitive(json, "precision");
+
+    if (precision == NULL) {
+        runner->precision = SimPrecisionExact;
+    } else if (!cJSON_IsString(precision)) {
+        fatal_error("runner_init(): precision property should be a string");
+    } else if (!strcmp(precision->valuestring, "exact")) {
+        runner->precision = SimPrecisionExact;
+    } else if (!strcmp(precision->valuestring, "fast")) {
+        runner->precision = SimPrecisionFast;
+    } else {
+        fatal_error("runner_init(): '%s' is not a valid precision", precision->valuestring);
+    }
+
+    /* detect out of bounds memory accesses with guard pages (optional) */
+    const cJSON *guard_pages = cJSON_GetObjectItemCaseSensitive(json, "guard_pages");
+
+    if (guard_pages == NULL) {
+        runner->guard_pages = false;
+    } else if (!cJSON_IsBool(guard_pages)) {
+        fatal_error("runner_init(): guard_pages property should be a boolean");
+    } else {
+        runner->guard_pages = cJSON_IsTrue(guard_pages);
+    }
+
+    /* validate the shader before running it (optional) */
+    const cJSON *validate = cJSON_GetObjectItemCaseSensitive(json, "validate");
+
+    if (validate == NULL) {
+        runner->validate = false;
+    } else if (!cJSON_IsBool(validate)) {
+        fatal_error("runner_init(): validate property should be a boolean");
+    } else {
+        runner->validate = cJSON_IsTrue(validate);
+    }
+
+    /* report the memory use of the simulator after the commands ran (optional) */
+    const cJSON *memory_stats = cJSON_GetObjectItemCaseSensitive(json, "memory_stats");
+
+    if (memory_stats == NULL) {
+        runner->memory_stats = false;
+    } else if (!cJSON_IsBool(memory_stats)) {
+        fatal_error("runner_init(): memory_stats property should be a boolean");
+    } else {
+        runner->memory_stats = cJSON_IsTrue(memory_stats);
+    }
+
+    /* the module is loaded below: start counting before it is */
+    if (runner->memory_stats) {
+        mem_stats_enable(true);
+    }
+
+    /* directory with cached modules (optional), relative to the runner config file */
+    const cJSON *module_cache = cJSON_GetObjectItemCaseSensitive(json, "module_cache");
+    char cache_dir[2048];
+
+    if (module_cache == NULL) {
+        cache_dir[0] = '\0';
+    } else if (!cJSON_IsString(module_cache)) {
+        fatal_error("runner_init(): module_cache property should be a string");
+    } else {
+        path_dirname(filename, cache_dir);
+        path_append(cache_dir, module_cache->valuestring);
+    }
+
     /* shader file */
     const cJSON *file = cJSON_GetObjectItemCaseSensitive(json, "file");
 
@@ -440,17 +511,21 @@ bool runner_init(Runner *runner, const char *filename) {
         path_dirname(filename, full_path);
         path_append(full_path, file->valuestring);
 
-        int8_t *binary_data = NULL;
+        if (!file_map(full_path, false, &runner->spirv_file)) {
+            fatal_error("Error opening file %s", full_path);
+        }
 
-        if (file_load_binary(full_path, &binary_data) == 0) {
-            fatal_error("runner_init(): unable to load shader '%s'", file->valuestring);
+        if (runner->spirv_file.size % 4 != 0) {
+            fatal_error("runner_init(): SPIR-V binary length should be a multiple of 32bit");
         }
 
-        if (!spirv_bin_load(&runner->spirv_bin, binary_data)) {
+        if (!spirv_bin_load_borrowed(&runner->spirv_bin, runner->spirv_file.data, runner->spirv_file.size / 4)) {
             goto end;
         }
 
-        spirv_module_load(&runner->spirv_module, &runner->spirv_bin);
+        if (!spirv_module_load_cached((cache_dir[0] != '\0') ? cache_dir : NULL, &runner->spirv_module, &runner->spirv_bin)) {
+            fatal_error("runner_init(): %s", runner->spirv_module.error_msg);
+        }
     }
 
     /* commands */
@@ -485,8 +560,36 @@ void runner_execute(Runner *runner, struct SPIRV_simulator *sim) {
 
     runner->spirv_sim = sim;
     spirv_sim_init(sim, &runner->spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+    sim->precision = runner->precision;
+
+    if (runner->guard_pages && !spirv_sim_use_guard_pages(sim)) {
+        printf("Guard pages aren't supported on this platform\n");
+    }
+
+    /* an invalid shader isn't executed, the error is reported like any other simulator error */
+    if (runner->validate) {
+        spirv_sim_use_validation(sim);
+    }
+
+    /* resolve the interface variables once, the commands only use the handles */
+    for (RunnerCmd **iter = runner->commands; iter != arr_end(runner->commands); ++iter) {
+        if ((*iter)->kind == CmdAssociateData) {
+            RunnerCmdAssociateData *cmd = (RunnerCmdAssociateData *) *iter;
+            cmd->intf = spirv_sim_resolve_interface(sim, cmd->storage_class, (VariableAccess) {cmd->var_if_type, cmd->var_if_index});
+        } else if ((*iter)->kind == CmdCmpOutput) {
+            RunnerCmdCmpOutput *cmd = (RunnerCmdCmpOutput *) *iter;
+            cmd->intf = spirv_sim_resolve_interface(sim, ClassOutput, (VariableAccess) {cmd->var_if_type, cmd->var_if_index});
+        }
+    }
 
     for (RunnerCmd **iter = runner->commands; iter != arr_end(runner->commands); ++iter) {
         (*iter)->cmd_func(runner, *iter);
     }
+
+    if (runner->memory_stats) {
+        char *report = NULL;
+        mem_stats_report(&report);
+        printf("Memory statistics (bytes):\n%s", report);
+        arr_free(report);
+    }
 }
@@ -7,6 +7,7 @@
 
 #include "spirv_module.h"
 #include "spirv_binary.h"
+#include "spirv_simulator.h"
 
 // forward declarations
 struct Runner;
@@ -46,6 +47,7 @@ typedef struct RunnerCmdAssociateData {
     StorageClass storage_class;
     VariableAccessKind var_if_type;
     uint32_t var_if_index;
+    SimInterfaceHandle intf;
     uint8_t *data;
     size_t data_size;
 } RunnerCmdAssociateData;
@@ -64,12 +66,18 @@ typedef struct RunnerCmdCmpOutput {
     TypeKind data_type;
     VariableAccessKind var_if_type;
     uint32_t var_if_index;
+    SimInterfaceHandle intf;
     uint8_t *data;
     size_t data_size;
 } RunnerCmdCmpOutput;
 
 typedef struct Runner {
     RunnerLanguage  language;
+    SimPrecision precision;
+    bool guard_pages;
+    bool validate;
+    bool memory_stats;
+    FileMapping spirv_file;
     SPIRV_binary spirv_bin;
     SPIRV_module spirv_module;
     RunnerCmd **commands;       // dyn_array
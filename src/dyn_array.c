@@ -5,10 +5,17 @@
 //  based on code from Bitwise (https://bitwise.handmade.network/)
 
 #include "dyn_array.h"
+#include "allocator.h"
+#include "utils.h"
+
+// minimum free space arr_printf/arr_append_float ensure before formatting, most output then fits in a single pass
+#define ARR_PRINTF_RESERVE  64
 
 __attribute__((__format__ (__printf__, 2, 0)))  /* to silence clang (non-constant format string for printf) */
 char *arr__printf(char *array, const char *fmt, ...) {
     va_list args;
+
+    arr__fit(array, ARR_PRINTF_RESERVE);
     size_t avail = arr_cap(array) - arr_len(array);
 
     va_start(args, fmt);
@@ -36,12 +43,69 @@ char *arr__printf(char *array, const char *fmt, ...) {
     return array;
 }
 
+static inline void arr__check_append(const char *array, size_t len) {
+    /* the appended characters and the zero-terminator must fit in a size_t: a wrapped around length would
+       pass arr__fit without growing the array */
+    if (len >= SIZE_MAX - arr_len(array)) {
+        fatal_error("dyn_array: cannot append %zu characters to a string of %zu characters", len, arr_len(array));
+    }
+}
+
+char *arr__append_buf(char *array, const char *str, size_t len) {
+    arr__check_append(array, len);
+    arr__fit(array, len + 1);
+    memcpy(arr_end(array), str, len);
+    arr__hdr(array)->len += len;
+    array[arr_len(array)] = '\0';
+    return array;
+}
+
+char *arr__append_char(char *array, char c, size_t count) {
+    arr__check_append(array, count);
+    arr__fit(array, count + 1);
+    memset(arr_end(array), c, count);
+    arr__hdr(array)->len += count;
+    array[arr_len(array)] = '\0';
+    return array;
+}
+
+char *arr__append_uint(char *array, uint64_t value) {
+    /* convert back to front into a small buffer: no format parsing, one copy */
+    char buffer[24];
+    char *start = buffer + sizeof(buffer);
+
+    do {
+        *--start = (char) ('0' + (value % 10));
+        value /= 10;
+    } while (value > 0);
+
+    return arr__append_buf(array, start, (size_t) (buffer + sizeof(buffer) - start));
+}
+
+char *arr__append_int(char *array, int64_t value) {
+    if (value < 0) {
+        array = arr__append_char(array, '-', 1);
+        return arr__append_uint(array, 0 - (uint64_t) value);
+    }
+    return arr__append_uint(array, (uint64_t) value);
+}
+
+char *arr__append_float(char *array, double value, int precision) {
+    /* rounding floats correctly is best left to the C library, but the format is fixed (identical to "%.*f")
+       and the pre-reservation means there's only one pass unless the number is huge */
+    return arr__printf(array, "%.*f", precision, value);
+}
+
 void *arr__grow(const void *array, size_t new_len, size_t elem_size) {
     size_t dbl_cap = arr_cap(array) * 2;
     size_t new_cap = (new_len > dbl_cap) ? new_len : dbl_cap;
     assert(new_len <= new_cap);
     size_t new_size = sizeof(ArrayHeader) + elem_size * new_cap;
 
+    if (mem_stats_enabled()) {
+        mem_stats__array_grow(arr_cap(array) * elem_size, new_cap * elem_size, arr_len(array) * elem_size);
+    }
+
     ArrayHeader *new_hdr;
     new_hdr = (ArrayHeader *) realloc(array ? arr__hdr(array) : 0, new_size);
     if (!array) {
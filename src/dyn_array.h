@@ -13,6 +13,7 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdint.h>
 
 typedef struct ArrayHeader {
     size_t len;
@@ -21,6 +22,11 @@ typedef struct ArrayHeader {
 } ArrayHeader;
 
 char *arr__printf(char *array, const char *fmt, ...);
+char *arr__append_buf(char *array, const char *str, size_t len);
+char *arr__append_char(char *array, char c, size_t count);
+char *arr__append_int(char *array, int64_t value);
+char *arr__append_uint(char *array, uint64_t value);
+char *arr__append_float(char *array, double value, int precision);
 void *arr__grow(const void *array, size_t new_len, size_t elem_size);
 
 #define arr__hdr(a) ((ArrayHeader *) (void *) ((char *)(a) - offsetof(ArrayHeader, data)))
@@ -39,6 +45,15 @@ void *arr__grow(const void *array, size_t new_len, size_t elem_size);
 #define arr_end(a) ((a) + arr_len(a))
 #define arr_printf(a, ...) (a) = arr__printf((a), __VA_ARGS__)
 #define arr_strcat(a, s) (arr_push_buf((a), (s), strlen((s))), arr__fit((a),1), (a)[arr_len((a))] = '\0');
+// string builder: append without format string parsing (zero-terminator is kept but not counted, like arr_printf)
+#define arr_append_str(a, s) (a) = arr__append_buf((a), (s), strlen((s)))
+#define arr_append_buf(a, s, n) (a) = arr__append_buf((a), (s), (n))
+#define arr_append_char(a, c) (a) = arr__append_char((a), (c), 1)
+#define arr_append_fill(a, c, n) (a) = arr__append_char((a), (c), (n))
+#define arr_append_int(a, v) (a) = arr__append_int((a), (v))
+#define arr_append_uint(a, v) (a) = arr__append_uint((a), (v))
+#define arr_append_float(a, v, p) (a) = arr__append_float((a), (v), (p))
 #define arr_reserve(a, n) (arr__fit((a), (n)), arr__hdr(a)->len+=(n))
+#define arr_fit(a, n) ((void) arr__fit((a), (n)))
 
 #endif // JS_DYN_ARRAY_H
@@ -1,5 +1,6 @@
 #include <emscripten.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
 #include "types.h"
 #include "utils.h"
@@ -12,6 +13,8 @@
 
 
 typedef struct SimApiContext {
+	FileMapping spirv_file;
+	uint32_t *spirv_words;
 	SPIRV_binary spirv_bin;
 	SPIRV_module spirv_module;
 	uint32_t entry_point;
@@ -22,7 +25,7 @@ typedef struct SimApiContext {
 
 EMSCRIPTEN_KEEPALIVE
 SimApiContext *simapi_create_context(void) {
-	SimApiContext *context = (SimApiContext *) malloc(sizeof(SimApiContext));
+	SimApiContext *context = (SimApiContext *) calloc(1, sizeof(SimApiContext));
 	lut_init();
 	return context;
 }
@@ -30,23 +33,33 @@ SimApiContext *simapi_create_context(void) {
 EMSCRIPTEN_KEEPALIVE
 void simapi_release_context(SimApiContext *context) {
 	if (context) {
+		file_unmap(&context->spirv_file);
+		free(context->spirv_words);
 		free(context);
 	}
 }
 
 EMSCRIPTEN_KEEPALIVE
 bool simapi_spirv_load_binary(SimApiContext *context, const int8_t *binary_data, size_t length) {
-	/* spirv_bin_load expects an dyn_array ... */
-	int8_t *blob = NULL;
-	arr_push_buf(blob, binary_data, length);
+	/* the array passed from javascript only lives on the stack for the duration of the call, keep one copy */
+	if (length % 4 != 0) {
+		printf("SPIR-V binary length should be a multiple of 32bit\n");
+		return false;
+	}
 
-	if (!spirv_bin_load(&context->spirv_bin, blob)) {
-		arr_free(blob);
+	free(context->spirv_words);
+	context->spirv_words = malloc(length);
+	memcpy(context->spirv_words, binary_data, length);
+
+	if (!spirv_bin_load_borrowed(&context->spirv_bin, context->spirv_words, length / 4)) {
 		printf("%s\n", context->spirv_bin.error_msg);
 		return false;
 	}
 
-	spirv_module_load(&context->spirv_module, &context->spirv_bin);
+	if (!spirv_module_load(&context->spirv_module, &context->spirv_bin)) {
+		printf("%s\n", context->spirv_module.error_msg);
+		return false;
+	}
 	context->entry_point = 0;
 
 	spirv_text_set_flag(&context->spirv_module, SPIRV_TEXT_USE_ID_NAMES, true);
@@ -59,18 +72,21 @@ bool simapi_spirv_load_binary(SimApiContext *context, const int8_t *binary_data,
 
 EMSCRIPTEN_KEEPALIVE
 bool simapi_spirv_load_file(SimApiContext *context, const char *filename) {
-	int8_t *binary_data = NULL;
+	file_unmap(&context->spirv_file);
 
-    if (file_load_binary(filename, &binary_data) == 0) {
+	if (!file_map(filename, false, &context->spirv_file) || context->spirv_file.size % 4 != 0) {
 		return false;
 	}
 
-	if (!spirv_bin_load(&context->spirv_bin, (int8_t *)binary_data)) {
+	if (!spirv_bin_load_borrowed(&context->spirv_bin, context->spirv_file.data, context->spirv_file.size / 4)) {
 		printf("%s\n", context->spirv_bin.error_msg);
 		return false;
 	}
 
-	spirv_module_load(&context->spirv_module, &context->spirv_bin);
+	if (!spirv_module_load(&context->spirv_module, &context->spirv_bin)) {
+		printf("%s\n", context->spirv_module.error_msg);
+		return false;
+	}
 	context->entry_point = 0;
 
 	spirv_text_set_flag(&context->spirv_module, SPIRV_TEXT_USE_ID_NAMES, true);
@@ -265,6 +281,17 @@ static inline void spirv_array_to_json(char **output, Type *type, void *data) {
 	}												\
 }
 
+#define APPEND_ARRAY(t,append)						\
+{													\
+	t *value = (t *) data;							\
+	for (int32_t i = 0; i < type->count; ++i) {		\
+		if (i > 0) {								\
+			arr_append_char(*output, ',');			\
+		}											\
+		append;										\
+	}												\
+}
+
 	if (type->count > 1) {
 		arr_printf(*output, "[");
 	}
@@ -279,20 +306,20 @@ static inline void spirv_array_to_json(char **output, Type *type, void *data) {
 		case TypeVectorInteger:
 		case TypeMatrixInteger: 
 			if (type->is_signed) {
-				FORMAT_ARRAY(int32_t, "%d");
+				APPEND_ARRAY(int32_t, arr_append_int(*output, value[i]));
 			} else {
-				FORMAT_ARRAY(uint32_t, "%d");
+				APPEND_ARRAY(uint32_t, arr_append_int(*output, (int32_t) value[i]));
 			}
 			break;
 
 		case TypeFloat:
 		case TypeVectorFloat:
 		case TypeMatrixFloat: 
-			FORMAT_ARRAY(float, "\"%f\"");
+			APPEND_ARRAY(float, (arr_append_char(*output, '"'), arr_append_float(*output, value[i], 6), arr_append_char(*output, '"')));
 			break;
 
 		case TypePointer:
-			FORMAT_ARRAY(uint32_t, "\"0x%.8x\"");
+			FORMAT_ARRAY(uint64_t, "\"0x%.12" PRIx64 "\"");
 			break;
 
 		case TypeArray: {
@@ -316,6 +343,7 @@ static inline void spirv_array_to_json(char **output, Type *type, void *data) {
 	}
 
 #undef FORMAT_ARRAY
+#undef APPEND_ARRAY
 
 }
 
@@ -344,7 +372,7 @@ const char *simapi_spirv_variable_data(SimApiContext *context, uint32_t id, int3
 	spirv_sim_variable_pointer(&context->spirv_sim, id, member, &ptr);
 
 	char *json = NULL;
-	spirv_array_to_json(&json, ptr.type, context->spirv_sim.memory + ptr.pointer);
+	spirv_array_to_json(&json, ptr.type, spirv_sim_memory_ptr(&context->spirv_sim, ptr.pointer));
 	return json;
 }
 
@@ -361,13 +389,13 @@ void simapi_spirv_variable_data_set_float(SimApiContext *context, uint32_t id, u
 		access = &var->member_access[member];
 	}
 
-	SimPointer *mem = spirv_sim_retrieve_intf_pointer(
-			&context->spirv_sim,
-			var->kind, 
-			*access);
+	SimInterfaceHandle intf = spirv_sim_resolve_interface(&context->spirv_sim, var->kind, *access);
+	if (intf == SIM_INTERFACE_INVALID) {
+		return;
+	}
 
-	float *data = (float *) (context->spirv_sim.memory + mem->pointer);
-	data[index] = value;
+	uint64_t pointer = spirv_sim_interface(&context->spirv_sim, intf)->ptr.pointer + index * sizeof(float);
+	spirv_sim_memory_write(&context->spirv_sim, pointer, &value, sizeof(value));
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -383,13 +411,13 @@ void simapi_spirv_variable_data_set_int(SimApiContext *context, uint32_t id, uin
 		access = &var->member_access[member];
 	}
 
-	SimPointer *mem = spirv_sim_retrieve_intf_pointer(
-			&context->spirv_sim,
-			var->kind, 
-			*access);
+	SimInterfaceHandle intf = spirv_sim_resolve_interface(&context->spirv_sim, var->kind, *access);
+	if (intf == SIM_INTERFACE_INVALID) {
+		return;
+	}
 
-	int32_t *data = (int32_t *) (context->spirv_sim.memory + mem->pointer);
-	data[index] = value;
+	uint64_t pointer = spirv_sim_interface(&context->spirv_sim, intf)->ptr.pointer + index * sizeof(int32_t);
+	spirv_sim_memory_write(&context->spirv_sim, pointer, &value, sizeof(value));
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -421,13 +449,14 @@ const char *simapi_spirv_register_by_id(SimApiContext *context, uint32_t id) {
 
 	char *json = NULL;
 
-	SimRegister *reg = map_int_ptr_get(&context->spirv_sim.current_frame->regs, id);
+	SimRegister *reg = reg_map_get(&context->spirv_sim.current_frame->regs, id);
 	if (!reg) {
 		return NULL;
 	}
 
-	arr_printf(json, "{\"id\": %d", reg->id);
-	arr_printf(json, ",\"type\":");
+	arr_append_str(json, "{\"id\": ");
+	arr_append_uint(json, reg->id);
+	arr_append_str(json, ",\"type\":");
 	spirv_type_to_json(&context->spirv_module, reg->type, &json);
 	arr_printf(json, ",\"value\": ");
 	spirv_array_to_json(&json, reg->type, reg->raw);
@@ -439,18 +468,18 @@ const char *simapi_spirv_register_by_id(SimApiContext *context, uint32_t id) {
 EMSCRIPTEN_KEEPALIVE
 const char *simapi_spirv_local_register_ids(SimApiContext *context) {
 
-	HashMap *regs = &context->spirv_sim.current_frame->regs;
+	RegisterMap *regs = &context->spirv_sim.current_frame->regs;
 
 	char *json = NULL;
-	const char *fmt = "%d";
-	arr_printf(json, "[");
+	char sep = '[';
 
-	for (int iter = map_begin(regs); iter != map_end(regs); iter = map_next(regs, iter)) {
-		arr_printf(json, fmt, ((SimRegister *) map_val(regs, iter))->id);
-		fmt = ",%d";
+	for (int iter = reg_map_begin(regs); iter != reg_map_end(regs); iter = reg_map_next(regs, iter)) {
+		arr_append_char(json, sep);
+		arr_append_uint(json, regs->slots[iter].val->id);
+		sep = ',';
 	}
 
-	arr_printf(json, "]");
+	arr_append_str(json, (sep == '[') ? "[]" : "]");
 	return json;
 }
 
@@ -486,32 +515,35 @@ EMSCRIPTEN_KEEPALIVE
 const char *simapi_spirv_function_variables(SimApiContext *context) {
 
 	uint32_t *var_ids = context->spirv_sim.current_frame->func->func.variable_ids;
-	char *json;
-
-	const char *fmt = "%d";
-	arr_printf(json, "[");
+	char *json = NULL;
+	char sep = '[';
 
 	for (uint32_t *id = var_ids; id != arr_end(var_ids); ++id) {
-		arr_printf(json, fmt, *id);
-		fmt = ",%d";
+		arr_append_char(json, sep);
+		arr_append_uint(json, *id);
+		sep = ',';
 	}
 
-	arr_printf(json, "]");
+	arr_append_str(json, (sep == '[') ? "[]" : "]");
 	return json;
 }
 
 EMSCRIPTEN_KEEPALIVE
 const char *simapi_spirv_simulator_memory_dump(SimApiContext *context) {
 
-	const char *fmt = "%d";
-	char *json;
-	arr_printf(json, "[");
+	uint8_t *end = context->spirv_sim.memory + context->spirv_sim.memory_size;
+
+	/* four characters per byte on average, reserve once instead of growing all the way up */
+	char *json = NULL;
+	arr_fit(json, context->spirv_sim.memory_size * 4 + 2);
+	char sep = '[';
 
-	for (uint8_t *data = context->spirv_sim.memory; data != arr_end(context->spirv_sim.memory); ++data) {
-		arr_printf(json, fmt, *data);
-		fmt = ",%d";
+	for (uint8_t *data = context->spirv_sim.memory; data != end; ++data) {
+		arr_append_char(json, sep);
+		arr_append_uint(json, *data);
+		sep = ',';
 	}
 
-	arr_printf(json, "]");
+	arr_append_str(json, (sep == '[') ? "[]" : "]");
 	return json;
 }
@@ -0,0 +1,298 @@
+// fast_math.c - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Polynomial approximations of transcendental functions.
+// Everything is evaluated in single precision on blocks of FM_LANES components: the inner loops have a
+// fixed trip count, no branches and no calls, so the compiler turns them into SIMD code (e.g. one SSE
+// register for a vec4). Special cases are handled with selects instead of branches.
+
+#include "fast_math.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define FM_LANES    4                       // the largest SPIR-V vector, one 128-bit SIMD register
+
+#define LN2_F       0.693147180559945f
+#define LOG2E_F     1.44269504088896f
+#define PI_2_F      1.57079632679489662f
+#define PI_4_F      0.78539816339744831f
+#define TWO_OVER_PI 0.63661977236758134f
+#define TAN_PI_8    0.41421356237309503f
+#define SQRT_HALF   0x3f3504f3              // bit pattern of sqrt(0.5)
+
+#define LN2_HI      0.693359375f            // ln(2) split in two parts, k * LN2_HI is exact (Cody-Waite)
+#define LN2_LO      -2.12194440e-4f
+#define PI_2_P1     1.5703125f              // pi/2 split in three parts, k * PI_2_P1 and k * PI_2_P2 are exact
+#define PI_2_P2     4.837512969970703125e-4f
+#define PI_2_P3     7.54978995489188216e-8f
+#define REDUCE_MAX  65536.0f                // largest argument the three part reduction handles
+
+#define ROUND_MAGIC 12582912.0f             // 1.5 * 2^23: adding and subtracting it rounds to nearest
+
+static inline uint32_t float_bits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bits_float(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static inline float round_nearest(float x, int32_t *k) {
+/* only valid for |x| < 2^22, callers make sure that's the case.
+   The low bits of the mantissa of (x + ROUND_MAGIC) hold the rounded value as a two's complement integer. */
+    float biased = x + ROUND_MAGIC;
+    *k = (int32_t) (float_bits(biased) - float_bits(ROUND_MAGIC));
+    return biased - ROUND_MAGIC;
+}
+
+static inline float scale_pow2(float x, int32_t k) {
+/* x * 2^k for k in [-252, 254]: in two steps, 2^k itself may not be a normal float */
+    int32_t k1 = k >> 1;
+    int32_t k2 = k - k1;
+    return x * bits_float((uint32_t) (k1 + 127) << 23) * bits_float((uint32_t) (k2 + 127) << 23);
+}
+
+static inline float flip_sign(float f, int32_t bit1) {
+/* negate f when bit1 (== 2) is set */
+    return bits_float(float_bits(f) ^ ((uint32_t) bit1 << 30));
+}
+
+static inline float copy_sign(float magnitude, float sign) {
+    return bits_float((float_bits(magnitude) & 0x7fffffff) | (float_bits(sign) & 0x80000000));
+}
+
+/*
+ * core approximations (one component)
+ */
+
+static inline float fm_exp_poly(float r) {
+/* minimax polynomial of e^r for |r| <= ln2/2 (Cephes expf) */
+    float r2 = r * r;
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    return p * r2 + r + 1.0f;
+}
+
+static inline float fm_exp2(float x) {
+/* 2^x = 2^k * e^(f * ln2) with k = round(x) and f in [-0.5, 0.5] */
+    int32_t is_nan = x != x;
+    float xc = (is_nan) ? 0.0f : CLAMP(x, -150.0f, 129.0f);
+    int32_t k;
+    float f = xc - round_nearest(xc, &k);
+
+    float result = scale_pow2(fm_exp_poly(f * LN2_F), k);
+    return (is_nan) ? x : result;
+}
+
+static inline float fm_exp(float x) {
+/* e^x = 2^k * e^r with k = round(x * log2(e)) and r = x - k * ln2 in [-ln2/2, ln2/2] */
+    int32_t is_nan = x != x;
+    float xc = (is_nan) ? 0.0f : CLAMP(x, -104.0f, 89.0f);
+    int32_t k;
+    float kf = round_nearest(xc * LOG2E_F, &k);
+    float r = (xc - kf * LN2_HI) - kf * LN2_LO;
+
+    float result = scale_pow2(fm_exp_poly(r), k);
+    return (is_nan) ? x : result;
+}
+
+static inline float fm_log(float x) {
+/* split x into 2^e * m with m in [sqrt(0.5), sqrt(2)), ln(x) = e * ln2 + ln(m) */
+    int32_t denorm = x < FLT_MIN;
+    float xn = (denorm) ? x * 8388608.0f : x;
+
+    /* offset the bits so the exponent field rolls over at sqrt(2) instead of at 2 */
+    uint32_t bits = float_bits(xn) + (0x3f800000 - SQRT_HALF);
+    int32_t e = (int32_t) (bits >> 23) - 127 - ((denorm) ? 23 : 0);
+    float m = bits_float((bits & 0x007fffff) + SQRT_HALF);
+    float ef = (float) e;
+
+    /* ln(1 + t) = t - t^2 / 2 + t^3 * P(t) (Cephes logf) */
+    float t = m - 1.0f;
+    float z = t * t;
+    float p = 7.0376836292e-2f;
+    p = p * t - 1.1514610310e-1f;
+    p = p * t + 1.1676998740e-1f;
+    p = p * t - 1.2420140846e-1f;
+    p = p * t + 1.4249322787e-1f;
+    p = p * t - 1.6668057665e-1f;
+    p = p * t + 2.0000714765e-1f;
+    p = p * t - 2.4999993993e-1f;
+    p = p * t + 3.3333331174e-1f;
+    float y = t * z * p - 0.5f * z;
+
+    float result = (t + (y + ef * LN2_LO)) + ef * LN2_HI;
+    result = (x == 0.0f) ? -INFINITY : result;
+    result = (x < 0.0f || x != x) ? NAN : result;
+    result = (x == INFINITY) ? INFINITY : result;
+    return result;
+}
+
+static inline float fm_reduce_pi_2(float x, int32_t *quadrant) {
+/* reduce to r = x - k * pi/2 with |r| <= pi/4, returns the quadrant in the low bits of quadrant */
+    /* arguments beyond the range of the reduction are treated as 0.
+       (x - x) is 0 for finite input and turns the result into NaN for NaN/inf input. */
+    float xc = (fabsf(x) < REDUCE_MAX) ? x : 0.0f;
+    float k = round_nearest(xc * TWO_OVER_PI, quadrant);
+    return ((xc - k * PI_2_P1) - k * PI_2_P2) - k * PI_2_P3 + (x - x);
+}
+
+static inline float fm_sin_poly(float r, float r2) {
+/* minimax polynomial of sin(r) for |r| <= pi/4 (Cephes sinf) */
+    float p = -1.9515295891e-4f;
+    p = p * r2 + 8.3321608736e-3f;
+    p = p * r2 - 1.6666654611e-1f;
+    return r + r * r2 * p;
+}
+
+static inline float fm_cos_poly(float r2) {
+/* minimax polynomial of cos(r) for |r| <= pi/4 (Cephes cosf) */
+    float p = 2.443315711809948e-5f;
+    p = p * r2 - 1.388731625493765e-3f;
+    p = p * r2 + 4.166664568298827e-2f;
+    return 1.0f - 0.5f * r2 + r2 * r2 * p;
+}
+
+static inline float fm_sin(float x) {
+    int32_t q;
+    float r = fm_reduce_pi_2(x, &q);
+    float r2 = r * r;
+    float s = (q & 1) ? fm_cos_poly(r2) : fm_sin_poly(r, r2);
+    return flip_sign(s, q & 2);
+}
+
+static inline float fm_cos(float x) {
+    int32_t q;
+    float r = fm_reduce_pi_2(x, &q);
+    float r2 = r * r;
+    float c = (q & 1) ? fm_sin_poly(r, r2) : fm_cos_poly(r2);
+    return flip_sign(c, (q + 1) & 2);
+}
+
+static inline float fm_tan(float x) {
+/* tan(x) = tan(r) in even quadrants, -1 / tan(r) in odd quadrants */
+    int32_t q;
+    float r = fm_reduce_pi_2(x, &q);
+    float r2 = r * r;
+
+    /* minimax polynomial of tan(r) for |r| <= pi/4 (Cephes tanf) */
+    float p = 9.38540185543e-3f;
+    p = p * r2 + 3.11992232697e-3f;
+    p = p * r2 + 2.44301354525e-2f;
+    p = p * r2 + 5.34112807005e-2f;
+    p = p * r2 + 1.33387994085e-1f;
+    p = p * r2 + 3.33331568548e-1f;
+    float t = r + r * r2 * p;
+    return (q & 1) ? -1.0f / t : t;
+}
+
+static inline float fm_atan_unit(float t) {
+/* atan(t) for t in [0, 1] */
+    int32_t red = t > TAN_PI_8;
+    float u = (red) ? (t - 1.0f) / (t + 1.0f) : t;      // |u| <= tan(pi/8)
+    float u2 = u * u;
+
+    /* minimax polynomial (Cephes atanf) */
+    float p = 8.05374449538e-2f;
+    p = p * u2 - 1.38776856032e-1f;
+    p = p * u2 + 1.99777106478e-1f;
+    p = p * u2 - 3.33329491539e-1f;
+    float a = u + u * u2 * p;
+    return (red) ? PI_4_F + a : a;
+}
+
+static inline float fm_atan2(float y, float x) {
+/* undefined for x = y = 0, returns 0 */
+    float ay = fabsf(y);
+    float ax = fabsf(x);
+    float num = MIN(ax, ay);
+    float den = MAX(ax, ay);
+    float t = (den == 0.0f) ? 0.0f : num / den;
+
+    float a = fm_atan_unit(t);
+    a = (ay > ax) ? PI_2_F - a : a;
+    a = (x < 0.0f) ? 2.0f * PI_2_F - a : a;
+    return copy_sign(a, y);
+}
+
+static inline float fm_asin(float x) {
+/* asin(x) = atan2(x, sqrt(1 - x^2)) */
+    return fm_atan2(x, sqrtf((1.0f - x) * (1.0f + x)));
+}
+
+static inline float fm_acos(float x) {
+/* acos(x) = atan2(sqrt(1 - x^2), x) */
+    return fm_atan2(sqrtf((1.0f - x) * (1.0f + x)), x);
+}
+
+static inline float fm_atan(float x) {
+    return fm_atan2(x, 1.0f);
+}
+
+static inline float fm_inverse_sqrt(float x) {
+/* exact, but a complete block compiles to SIMD instructions (this file is built with -fno-math-errno) */
+    return 1.0f / sqrtf(x);
+}
+
+/*
+ * public interface: complete blocks of FM_LANES components use the approximations, the remaining components
+ * (e.g. a scalar or a vec3) go to the C library: a single lane isn't faster than a good libm implementation.
+ */
+
+#define FAST_MATH_1OP(name, libm_func)                                  \
+    void fast_math_##name(float *res, const float *x, size_t n) {       \
+        size_t base = 0;                                                \
+        for (; base + FM_LANES <= n; base += FM_LANES) {                \
+            float in[FM_LANES];                                         \
+            float out[FM_LANES];                                        \
+            memcpy(in, x + base, sizeof(in));                           \
+            for (int i = 0; i < FM_LANES; ++i) {                        \
+                out[i] = fm_##name(in[i]);                              \
+            }                                                           \
+            memcpy(res + base, out, sizeof(out));                       \
+        }                                                               \
+        for (; base < n; ++base) {                                      \
+            res[base] = libm_func(x[base]);                             \
+        }                                                               \
+    }
+
+#define FAST_MATH_2OP(name, libm_func)                                                  \
+    void fast_math_##name(float *res, const float *x, const float *y, size_t n) {       \
+        size_t base = 0;                                                                \
+        for (; base + FM_LANES <= n; base += FM_LANES) {                                \
+            float in1[FM_LANES];                                                        \
+            float in2[FM_LANES];                                                        \
+            float out[FM_LANES];                                                        \
+            memcpy(in1, x + base, sizeof(in1));                                         \
+            memcpy(in2, y + base, sizeof(in2));                                         \
+            for (int i = 0; i < FM_LANES; ++i) {                                        \
+                out[i] = fm_##name(in1[i], in2[i]);                                     \
+            }                                                                           \
+            memcpy(res + base, out, sizeof(out));                                       \
+        }                                                                               \
+        for (; base < n; ++base) {                                                      \
+            res[base] = libm_func(x[base], y[base]);                                    \
+        }                                                                               \
+    }
+
+FAST_MATH_1OP(exp, expf)
+FAST_MATH_1OP(exp2, exp2f)
+FAST_MATH_1OP(log, logf)
+
+FAST_MATH_1OP(sin, sinf)
+FAST_MATH_1OP(cos, cosf)
+FAST_MATH_1OP(tan, tanf)
+FAST_MATH_1OP(asin, asinf)
+FAST_MATH_1OP(acos, acosf)
+FAST_MATH_1OP(atan, atanf)
+FAST_MATH_2OP(atan2, atan2f)
+FAST_MATH_1OP(inverse_sqrt, fm_inverse_sqrt)
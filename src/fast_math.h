@@ -0,0 +1,38 @@
+// fast_math.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Polynomial approximations of transcendental functions, used by the simulator when
+// running in SimPrecisionFast mode. All functions operate on arrays of floats: complete
+// blocks of 4 components are evaluated with SIMD instructions, the remaining components
+// use the C library. Only functions that beat the C library on a vec4 are provided
+// (pow and log2 are not, see the /fast_math/benchmark test).
+//
+// The results stay within the precision requirements of the Vulkan specification
+// (section "Precision and Operation of SPIR-V Instructions"):
+//  - exp, exp2:        3 + 2 * |x| ULP
+//  - log:              3 ULP outside [0.5, 2], absolute error < 2^-21 inside
+//  - sin, cos:         absolute error <= 2^-11 inside [-pi, pi]
+//  - tan:              inherited from sin(x) / cos(x)
+//  - atan, atan2:      4096 ULP
+//  - asin, acos:       inherited from atan2
+//  - inversesqrt:      2 ULP
+
+#ifndef JS_SHADER_SIM_FAST_MATH_H
+#define JS_SHADER_SIM_FAST_MATH_H
+
+#include "types.h"
+
+void fast_math_exp(float *res, const float *x, size_t n);
+void fast_math_exp2(float *res, const float *x, size_t n);
+void fast_math_log(float *res, const float *x, size_t n);
+
+void fast_math_sin(float *res, const float *x, size_t n);
+void fast_math_cos(float *res, const float *x, size_t n);
+void fast_math_tan(float *res, const float *x, size_t n);
+void fast_math_asin(float *res, const float *x, size_t n);
+void fast_math_acos(float *res, const float *x, size_t n);
+void fast_math_atan(float *res, const float *x, size_t n);
+void fast_math_atan2(float *res, const float *y, const float *x, size_t n);
+
+void fast_math_inverse_sqrt(float *res, const float *x, size_t n);
+
+#endif // JS_SHADER_SIM_FAST_MATH_H
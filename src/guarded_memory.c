@@ -0,0 +1,164 @@
+// guarded_memory.c - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Memory blocks surrounded by inaccessible guard pages.
+
+#include "guarded_memory.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#ifdef GUARDED_MEMORY_SUPPORTED
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define BLOCK_ALIGN 16
+#define MAX_GUARDED_BLOCKS 64
+
+static _Thread_local sigjmp_buf *fault_env = NULL;
+
+static atomic_flag handler_installed = ATOMIC_FLAG_INIT;
+static struct sigaction prev_segv_action;
+static struct sigaction prev_bus_action;
+
+// the complete mappings of the live blocks (guard pages included), read by the signal handler without locking
+static _Atomic(uintptr_t) guarded_start[MAX_GUARDED_BLOCKS];
+static _Atomic(uintptr_t) guarded_end[MAX_GUARDED_BLOCKS];
+
+static bool register_mapping(uint8_t *mapping, size_t map_size) {
+    for (int idx = 0; idx < MAX_GUARDED_BLOCKS; ++idx) {
+        uintptr_t expected = 0;
+        if (atomic_compare_exchange_strong(&guarded_start[idx], &expected, (uintptr_t) mapping)) {
+            atomic_store(&guarded_end[idx], (uintptr_t) mapping + map_size);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void unregister_mapping(uint8_t *mapping) {
+    for (int idx = 0; idx < MAX_GUARDED_BLOCKS; ++idx) {
+        if (atomic_load(&guarded_start[idx]) == (uintptr_t) mapping) {
+            atomic_store(&guarded_end[idx], 0);
+            atomic_store(&guarded_start[idx], 0);
+            return;
+        }
+    }
+}
+
+static bool is_guarded_address(uintptr_t addr) {
+/* the data pages are accessible, so a fault inside a mapping can only come from one of its guard pages */
+    for (int idx = 0; idx < MAX_GUARDED_BLOCKS; ++idx) {
+        uintptr_t start = atomic_load(&guarded_start[idx]);
+        if (start != 0 && addr >= start && addr < atomic_load(&guarded_end[idx])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void chain_fault_handler(int sig, siginfo_t *info, void *context) {
+    struct sigaction *prev = (sig == SIGSEGV) ? &prev_segv_action : &prev_bus_action;
+
+    if ((prev->sa_flags & SA_SIGINFO) && prev->sa_sigaction != NULL) {
+        prev->sa_sigaction(sig, info, context);
+    } else if (!(prev->sa_flags & SA_SIGINFO) && prev->sa_handler != SIG_DFL && prev->sa_handler != SIG_IGN) {
+        prev->sa_handler(sig);
+    } else {
+        /* default action: restore it, the instruction faults again and the process terminates as it would have */
+        signal(sig, SIG_DFL);
+    }
+}
+
+static void guard_fault_handler(int sig, siginfo_t *info, void *context) {
+    /* only faults in a guard page are turned into a jump, anything else is a real crash */
+    if (fault_env != NULL && is_guarded_address((uintptr_t) info->si_addr)) {
+        sigjmp_buf *env = fault_env;
+        fault_env = NULL;
+        siglongjmp(*env, 1);
+    }
+
+    chain_fault_handler(sig, info, context);
+}
+
+static void install_fault_handler(void) {
+    if (atomic_flag_test_and_set(&handler_installed)) {
+        return;
+    }
+
+    struct sigaction action = {0};
+    action.sa_sigaction = guard_fault_handler;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;      // no need to restore the signal mask after jumping out
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGSEGV, &action, &prev_segv_action);
+    sigaction(SIGBUS, &action, &prev_bus_action);
+}
+
+static inline size_t page_size(void) {
+    return (size_t) sysconf(_SC_PAGESIZE);
+}
+
+static inline size_t data_size(size_t size) {
+    return ALIGN_UP(MAX(size, 1u), (size_t) BLOCK_ALIGN);
+}
+
+bool guarded_memory_supported(void) {
+    return true;
+}
+
+void *guarded_memory_alloc(size_t size) {
+    size_t page = page_size();
+    size_t data_pages = ALIGN_UP(data_size(size), page);
+    size_t map_size = data_pages + 2 * page;
+
+    uint8_t *mapping = mmap(NULL, map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (mprotect(mapping + page, data_pages, PROT_READ | PROT_WRITE) != 0 || !register_mapping(mapping, map_size)) {
+        munmap(mapping, map_size);
+        return NULL;
+    }
+
+    install_fault_handler();
+
+    /* detect overflows as soon as possible: the (aligned) block ends where the trailing guard page starts */
+    return mapping + page + (data_pages - data_size(size));
+}
+
+void guarded_memory_free(void *block, size_t size) {
+    if (block == NULL) {
+        return;
+    }
+
+    size_t page = page_size();
+    size_t data_pages = ALIGN_UP(data_size(size), page);
+    uint8_t *mapping = (uint8_t *) block - (data_pages - data_size(size)) - page;
+
+    unregister_mapping(mapping);
+    munmap(mapping, data_pages + 2 * page);
+}
+
+void guarded_memory_catch_faults(sigjmp_buf *env) {
+    fault_env = env;
+}
+
+#else
+
+bool guarded_memory_supported(void) {
+    return false;
+}
+
+void *guarded_memory_alloc(size_t size) {
+    return NULL;
+}
+
+void guarded_memory_free(void *block, size_t size) {
+    assert(block == NULL);
+}
+
+#endif // GUARDED_MEMORY_SUPPORTED
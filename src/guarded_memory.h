@@ -0,0 +1,33 @@
+// guarded_memory.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Memory blocks surrounded by inaccessible guard pages.
+//  - the block ends against the trailing guard page: overflows fault instead of silently corrupting memory
+//    (once they pass the padding that rounds the size up to 16 bytes)
+//  - underflows only fault when they reach past the unused start of the first data page
+//  - faults in a guard page inside a protected region of code are turned into a jump back to the start of that region,
+//    other faults are passed on to the previous signal handler
+//  - only available on POSIX platforms, guarded_memory_supported() returns false elsewhere
+
+#ifndef JS_SHADER_SIM_GUARDED_MEMORY_H
+#define JS_SHADER_SIM_GUARDED_MEMORY_H
+
+#include "types.h"
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+    #define GUARDED_MEMORY_SUPPORTED
+    #include <setjmp.h>
+#endif
+
+bool guarded_memory_supported(void);
+
+// the end of the returned block (size rounded up to 16 bytes) is placed directly against the trailing guard page
+// returns NULL when mapping fails or too many guarded blocks are alive
+void *guarded_memory_alloc(size_t size);
+void guarded_memory_free(void *block, size_t size);
+
+#ifdef GUARDED_MEMORY_SUPPORTED
+// faults in guarded memory on the calling thread jump to env (set with sigsetjmp) until called with NULL
+void guarded_memory_catch_faults(sigjmp_buf *env);
+#endif
+
+#endif // JS_SHADER_SIM_GUARDED_MEMORY_H
@@ -1,30 +1,14 @@
 // hash_map.c - Johan Smet - BSD-3-Clause (see LICENSE)
 //
-// an associative container (open addressing, linear probing)
+// an associative container (open addressing, "swiss table" layout)
 
 #include "hash_map.h"
+#include "typed_map.h"      // the swiss table helpers (tmap__*) are shared with the type-specialized maps
 
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
-#define META_EMPTY  0
-#define META_IN_USE 2
-
-static uint64_t hash_uint64(uint64_t key) {
-    // mixer from MurmurHash3 (public domain -- see https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp)
-    key ^= (key >> 33);
-    key *= 0xff51afd7ed558ccd;
-    key ^= (key >> 33);
-    key *= 0xc4ceb9fe1a85ec53;
-    key ^= (key >> 33);
-    return key;
-}
-
-static uint64_t hash_ptr(void *key) {
-    return hash_uint64((uint64_t) key);
-}
-
 static uint64_t hash_str(const char *ptr) {
     // fnv-hash
     uint64_t x = 0xcbf29ce484222325;
@@ -39,114 +23,131 @@ static uint64_t hash_str(const char *ptr) {
 }
 
 static_assert(sizeof(MapValue) <= sizeof(uint64_t), "MapValue is bigger that uint64, change hash function!");
-#define hash_mapvalue(x)   hash_uint64(*((uint64_t *) (&x)))
-
-typedef void (*HASHMAP_PUT_FUNC)(HashMap *map, MapValue key, MapValue val);
 
-static void hashmap_put_int(HashMap *map, MapValue key, MapValue val) {
-    assert(map != NULL);
-
-    uint64_t idx = hash_mapvalue(key) % map->cap;
+typedef enum MapKeyKind {
+    MapKeyInt,          // integers and pointers: compared by value
+    MapKeyStr           // zero-terminated strings: compared by content
+} MapKeyKind;
 
-    for (;;) {
+static inline uint64_t hash_key(MapValue key, MapKeyKind kind) {
+    return (kind == MapKeyStr) ? hash_str(key.as_const_ptr) : tmap__hash_u64(key.as_uint64);
+}
 
-        if (map->meta[idx] == META_EMPTY) {
-            map->keys[idx] = key;
-            map->vals[idx] = val;
-            map->meta[idx] = META_IN_USE;
-            map->len++;
-            return;
-        } else if (memcmp(&map->keys[idx], &key, sizeof(key)) == 0) {
-            map->vals[idx] = val;
-            return;
-        }
+static inline bool key_equal(MapValue a, MapValue b, MapKeyKind kind) {
+    return (kind == MapKeyStr) ? strcmp(a.as_const_ptr, b.as_const_ptr) == 0 : a.as_uint64 == b.as_uint64;
+}
 
-        idx = (idx + 1) % map->cap;
+static inline int64_t hashmap_find(HashMap *map, MapValue key, uint64_t hash, MapKeyKind kind) {
+/* index of the slot of the key, -1 if the key isn't in the map */
+    if (map->cap == 0) {
+        return -1;
     }
-}
 
-static void hashmap_put_str(HashMap *map, MapValue key, MapValue val) {
-    uint64_t idx = hash_str((const char *) key.as_ptr) % map->cap;
+    size_t mask = map->cap - 1;
+    size_t pos = tmap__pos(hash) & mask;
+    uint8_t h2 = tmap__ctrl(hash);
+
+    /* triangular probing over groups visits every group when the capacity is a power of two */
+    for (size_t stride = TMAP_GROUP_SIZE; ; stride += TMAP_GROUP_SIZE) {
+        const uint8_t *group = map->ctrl + pos;
 
-    for (;;) {
-        idx = idx % map->cap;
+        for (uint32_t match = tmap__group_match(group, h2); match != 0; match &= match - 1) {
+            size_t idx = (pos + (size_t) __builtin_ctz(match)) & mask;
+            if (key_equal(map->slots[idx].key, key, kind)) {
+                return (int64_t) idx;
+            }
+        }
 
-        if (map->meta[idx] == META_EMPTY) {
-            map->keys[idx] = key;
-            map->vals[idx] = val;
-            map->meta[idx] = META_IN_USE;
-            map->len++;
-            return;
-        } else if (strcmp((const char *) map->keys[idx].as_ptr, (const char *) key.as_ptr) == 0) {
-            map->vals[idx] = val;
-            return;
+        if (tmap__group_match(group, TMAP_CTRL_EMPTY) != 0) {
+            return -1;
         }
 
-        ++idx;
+        pos = (pos + stride) & mask;
     }
 }
 
-static void hashmap_grow(HashMap *map, size_t new_cap, HASHMAP_PUT_FUNC put_func) {
-    if (new_cap < 16) {
-        new_cap = 16;
-    }
+static void hashmap_rehash(HashMap *map, size_t new_cap, MapKeyKind kind) {
+/* move the entries to a new table of new_cap slots, this also drops the deleted slots */
+    assert(new_cap >= TMAP_MIN_CAP && (new_cap & (new_cap - 1)) == 0);
 
+    /* slots and control bytes share one allocation */
     HashMap new_map = (HashMap) {
         .len = 0,
         .cap = new_cap,
-        .data = calloc(new_cap, sizeof(MapValue) * 2 + sizeof(uint8_t))
+        .slots = malloc(new_cap * sizeof(MapSlot) + new_cap + TMAP_GROUP_SIZE),
+        .str_keys = kind == MapKeyStr
     };
-    new_map.keys = (MapValue *) new_map.data;
-    new_map.vals = new_map.keys + new_cap;
-    new_map.meta = (uint8_t *) (new_map.vals + new_cap);
-
-    for (uint64_t idx = 0; idx < map->cap; ++idx) {
-        if (map->meta[idx] != META_EMPTY) {
-            put_func(&new_map, map->keys[idx], map->vals[idx]);
+    new_map.ctrl = (uint8_t *) (new_map.slots + new_cap);
+    memset(new_map.ctrl, TMAP_CTRL_EMPTY, new_cap + TMAP_GROUP_SIZE);
+
+    for (size_t idx = 0; idx < map->cap; ++idx) {
+        if (!(map->ctrl[idx] & TMAP_CTRL_EMPTY)) {
+            uint64_t hash = hash_key(map->slots[idx].key, kind);
+            size_t dst = tmap__find_free(new_map.ctrl, new_cap, hash);
+            new_map.slots[dst] = map->slots[idx];
+            tmap__set_ctrl(new_map.ctrl, new_cap, dst, tmap__ctrl(hash));
+            new_map.len++;
         }
     }
 
-    free(map->data);
+    free(map->slots);
     *map = new_map;
 }
 
-static MapValue *hashmap_get_int(HashMap *map, MapValue key, uint64_t hash) {
-    assert(map);
+static inline void hashmap_put(HashMap *map, MapValue key, MapValue val, MapKeyKind kind) {
+    assert(map != NULL);
 
-    if (map->cap == 0) {
-        return NULL;
+    uint64_t hash = hash_key(key, kind);
+
+    int64_t found = hashmap_find(map, key, hash, kind);
+    if (found >= 0) {
+        map->slots[found].val = val;
+        return;
     }
 
-    uint64_t idx = hash % map->cap;
+    size_t new_cap = tmap__grow_cap(map->len, map->deleted, map->cap);
+    if (new_cap > 0) {
+        hashmap_rehash(map, new_cap, kind);
+    }
 
-    for (;;) {
-        if (map->meta[idx] == META_EMPTY) {
-            return NULL;
-        } else if (memcmp(&map->keys[idx], &key, sizeof(key)) == 0) {
-            return &map->vals[idx];
-        }
-        idx = (idx + 1) % map->cap;
+    size_t idx = tmap__find_free(map->ctrl, map->cap, hash);
+    if (map->ctrl[idx] == TMAP_CTRL_DELETED) {
+        map->deleted--;
     }
+    map->slots[idx] = (MapSlot) {key, val};
+    tmap__set_ctrl(map->ctrl, map->cap, idx, tmap__ctrl(hash));
+    map->len++;
+    map->str_keys = kind == MapKeyStr;
 }
 
-static MapValue *hashmap_get_str(HashMap *map, MapValue key, uint64_t hash)
-{
+static inline bool hashmap_remove(HashMap *map, MapValue key, MapKeyKind kind) {
     assert(map);
 
-    if (map->cap == 0) {
-        return NULL;
+    if (map->len == 0) {
+        return false;
     }
 
-    uint64_t idx = hash % map->cap;
+    int64_t idx = hashmap_find(map, key, hash_key(key, kind), kind);
+    if (idx < 0) {
+        return false;
+    }
 
-    for (;;) {
-        if (map->meta[idx] == META_EMPTY) {
-            return NULL;
-        } else if (strcmp(map->keys[idx].as_const_ptr, key.as_const_ptr) == 0) {
-            return &map->vals[idx];
-        }
-        idx = (idx + 1) % map->cap;
+    /* the slot may be part of the probe sequence of other keys: mark it deleted instead of empty */
+    tmap__set_ctrl(map->ctrl, map->cap, (size_t) idx, TMAP_CTRL_DELETED);
+    map->len--;
+    map->deleted++;
+    return true;
+}
+
+static inline MapValue *hashmap_get(HashMap *map, MapValue key, MapKeyKind kind) {
+    assert(map);
+
+    if (map->len == 0) {
+        return NULL;
     }
+
+    int64_t idx = hashmap_find(map, key, hash_key(key, kind), kind);
+    return (idx >= 0) ? &map->slots[idx].val : NULL;
 }
 
 /*
@@ -155,27 +156,19 @@ static MapValue *hashmap_get_str(HashMap *map, MapValue key, uint64_t hash)
 
 void map_int_int_put(HashMap *map, uint64_t key, uint64_t value) {
     assert(map);
-
-    // double the container capacity when it becomes half full
-    if (map->len * 2 >= map->cap) {
-        hashmap_grow(map, 2 * map->cap, hashmap_put_int);
-    }
-
-    hashmap_put_int(map, (MapValue) {.as_uint64=key}, (MapValue) {.as_uint64=value});
+    hashmap_put(map, (MapValue) {.as_uint64 = key}, (MapValue) {.as_uint64 = value}, MapKeyInt);
 }
 
 uint64_t map_int_int_get(HashMap *map, uint64_t key) {
     assert(map);
 
-    MapValue *val = hashmap_get_int(map,(MapValue) {.as_uint64 = key}, hash_uint64(key));
+    MapValue *val = hashmap_get(map, (MapValue) {.as_uint64 = key}, MapKeyInt);
     return (val != NULL) ? val->as_uint64 : 0;
 }
 
 bool map_int_int_has(HashMap *map, uint64_t key) {
     assert(map);
-
-    MapValue *val = hashmap_get_int(map,(MapValue) {.as_uint64 = key}, hash_uint64(key));
-    return val != NULL;
+    return hashmap_get(map, (MapValue) {.as_uint64 = key}, MapKeyInt) != NULL;
 }
 
 /*
@@ -184,27 +177,19 @@ bool map_int_int_has(HashMap *map, uint64_t key) {
 
 void map_ptr_ptr_put(HashMap *map, void *key, void *value) {
     assert(map);
-
-    // double the container capacity when it becomes half full
-    if (map->len * 2 >= map->cap) {
-        hashmap_grow(map, 2 * map->cap, hashmap_put_int);
-    }
-
-    hashmap_put_int(map, (MapValue) {.as_ptr=key}, (MapValue) {.as_ptr=value});
+    hashmap_put(map, (MapValue) {.as_uint64 = (uintptr_t) key}, (MapValue) {.as_ptr = value}, MapKeyInt);
 }
 
 void *map_ptr_ptr_get(HashMap *map, void *key) {
     assert(map);
 
-    MapValue *val = hashmap_get_int(map,(MapValue) {.as_ptr = key}, hash_ptr(key));
+    MapValue *val = hashmap_get(map, (MapValue) {.as_uint64 = (uintptr_t) key}, MapKeyInt);
     return (val != NULL) ? val->as_ptr : NULL;
 }
 
 bool map_ptr_ptr_has(HashMap *map, void *key) {
     assert(map);
-
-    MapValue *val = hashmap_get_int(map,(MapValue) {.as_ptr = key}, hash_ptr(key));
-    return val != NULL;
+    return hashmap_get(map, (MapValue) {.as_uint64 = (uintptr_t) key}, MapKeyInt) != NULL;
 }
 
 /*
@@ -212,26 +197,20 @@ bool map_ptr_ptr_has(HashMap *map, void *key) {
  */
 
 void map_int_ptr_put(HashMap *map, uint64_t key, void *value) {
-    // double the container capacity when it becomes half full
-    if (map->len * 2 >= map->cap) {
-        hashmap_grow(map, 2 * map->cap, hashmap_put_int);
-    }
-
-    hashmap_put_int(map, (MapValue) {.as_uint64=key}, (MapValue) {.as_ptr=value});
+    assert(map);
+    hashmap_put(map, (MapValue) {.as_uint64 = key}, (MapValue) {.as_ptr = value}, MapKeyInt);
 }
 
 void *map_int_ptr_get(HashMap *map, uint64_t key) {
     assert(map);
 
-    MapValue *val = hashmap_get_int(map,(MapValue) {.as_uint64 = key}, hash_uint64(key));
+    MapValue *val = hashmap_get(map, (MapValue) {.as_uint64 = key}, MapKeyInt);
     return (val != NULL) ? val->as_ptr : NULL;
 }
 
 bool map_int_ptr_has(HashMap *map, uint64_t key) {
     assert(map);
-
-    MapValue *val = hashmap_get_int(map,(MapValue) {.as_uint64 = key}, hash_uint64(key));
-    return val != NULL;
+    return hashmap_get(map, (MapValue) {.as_uint64 = key}, MapKeyInt) != NULL;
 }
 
 /*
@@ -239,26 +218,20 @@ bool map_int_ptr_has(HashMap *map, uint64_t key) {
  */
 
 void map_int_str_put(HashMap *map, uint64_t key, const char *value) {
-    // double the container capacity when it becomes half full
-    if (map->len * 2 >= map->cap) {
-        hashmap_grow(map, 2 * map->cap, hashmap_put_int);
-    }
-
-    hashmap_put_int(map, (MapValue) {.as_uint64=key}, (MapValue) {.as_const_ptr=value});
+    assert(map);
+    hashmap_put(map, (MapValue) {.as_uint64 = key}, (MapValue) {.as_const_ptr = value}, MapKeyInt);
 }
 
 const char *map_int_str_get(HashMap *map, uint64_t key) {
     assert(map);
 
-    MapValue *val = hashmap_get_int(map,(MapValue) {.as_uint64 = key}, hash_uint64(key));
+    MapValue *val = hashmap_get(map, (MapValue) {.as_uint64 = key}, MapKeyInt);
     return (val != NULL) ? val->as_const_ptr : NULL;
 }
 
 bool map_int_str_has(HashMap *map, uint64_t key) {
     assert(map);
-
-    MapValue *val = hashmap_get_int(map,(MapValue) {.as_uint64 = key}, hash_uint64(key));
-    return val != NULL;
+    return hashmap_get(map, (MapValue) {.as_uint64 = key}, MapKeyInt) != NULL;
 }
 
 /*
@@ -267,27 +240,19 @@ bool map_int_str_has(HashMap *map, uint64_t key) {
 
 void map_str_int_put(HashMap *map, const char *key, uint64_t value) {
     assert(map);
-
-    // double the container capacity when it becomes half full
-    if (map->len * 2 >= map->cap) {
-        hashmap_grow(map, 2 * map->cap, hashmap_put_str);
-    }
-
-    hashmap_put_str(map, (MapValue) {.as_const_ptr = key}, (MapValue) {.as_uint64 = value});
+    hashmap_put(map, (MapValue) {.as_const_ptr = key}, (MapValue) {.as_uint64 = value}, MapKeyStr);
 }
 
 uint64_t map_str_int_get(HashMap *map, const char *key) {
     assert(map);
 
-    MapValue *val = hashmap_get_str(map,(MapValue) {.as_const_ptr = key}, hash_str(key));
+    MapValue *val = hashmap_get(map, (MapValue) {.as_const_ptr = key}, MapKeyStr);
     return (val != NULL) ? val->as_uint64 : 0;
 }
 
 bool map_str_int_has(HashMap *map, const char *key) {
     assert(map);
-    
-    MapValue *val = hashmap_get_str(map,(MapValue) {.as_const_ptr = key}, hash_str(key));
-    return val != NULL;
+    return hashmap_get(map, (MapValue) {.as_const_ptr = key}, MapKeyStr) != NULL;
 }
 
 /*
@@ -296,27 +261,19 @@ bool map_str_int_has(HashMap *map, const char *key) {
 
 void map_str_ptr_put(HashMap *map, const char *key, void *value) {
     assert(map);
-
-    // double the container capacity when it becomes half full
-    if (map->len * 2 >= map->cap) {
-        hashmap_grow(map, 2 * map->cap, hashmap_put_str);
-    }
-
-    hashmap_put_str(map, (MapValue) {.as_const_ptr = key}, (MapValue) {.as_ptr = value});
+    hashmap_put(map, (MapValue) {.as_const_ptr = key}, (MapValue) {.as_ptr = value}, MapKeyStr);
 }
 
 void *map_str_ptr_get(HashMap *map, const char *key) {
     assert(map);
 
-    MapValue *val = hashmap_get_str(map,(MapValue) {.as_const_ptr = key}, hash_str(key));
-    return (val != NULL) ? val->as_ptr : 0;
+    MapValue *val = hashmap_get(map, (MapValue) {.as_const_ptr = key}, MapKeyStr);
+    return (val != NULL) ? val->as_ptr : NULL;
 }
 
 bool map_str_ptr_has(HashMap *map, const char *key) {
     assert(map);
-
-    MapValue *val = hashmap_get_str(map,(MapValue) {.as_const_ptr = key}, hash_str(key));
-    return val != NULL;
+    return hashmap_get(map, (MapValue) {.as_const_ptr = key}, MapKeyStr) != NULL;
 }
 
 /*
@@ -325,52 +282,69 @@ bool map_str_ptr_has(HashMap *map, const char *key) {
 
 void map_str_str_put(HashMap *map, const char *key, const char *value) {
     assert(map);
-
-    // double the container capacity when it becomes half full
-    if (map->len * 2 >= map->cap) {
-        hashmap_grow(map, 2 * map->cap, hashmap_put_str);
-    }
-
-    hashmap_put_str(map, (MapValue) {.as_const_ptr = key}, (MapValue) {.as_const_ptr = value});
+    hashmap_put(map, (MapValue) {.as_const_ptr = key}, (MapValue) {.as_const_ptr = value}, MapKeyStr);
 }
 
 const char *map_str_str_get(HashMap *map, const char *key) {
     assert(map);
 
-    MapValue *val = hashmap_get_str(map,(MapValue) {.as_const_ptr = key}, hash_str(key));
-    return (val != NULL) ? val->as_const_ptr : 0;
+    MapValue *val = hashmap_get(map, (MapValue) {.as_const_ptr = key}, MapKeyStr);
+    return (val != NULL) ? val->as_const_ptr : NULL;
 }
 
 bool map_str_str_has(HashMap *map, const char *key) {
     assert(map);
+    return hashmap_get(map, (MapValue) {.as_const_ptr = key}, MapKeyStr) != NULL;
+}
 
-    MapValue *val = hashmap_get_str(map,(MapValue) {.as_const_ptr = key}, hash_str(key));
-    return val != NULL;
+/*
+ * interface - removal
+ */
+
+bool map_int_remove(HashMap *map, uint64_t key) {
+    return hashmap_remove(map, (MapValue) {.as_uint64 = key}, MapKeyInt);
+}
+
+bool map_ptr_remove(HashMap *map, void *key) {
+    return hashmap_remove(map, (MapValue) {.as_uint64 = (uintptr_t) key}, MapKeyInt);
+}
+
+bool map_str_remove(HashMap *map, const char *key) {
+    return hashmap_remove(map, (MapValue) {.as_const_ptr = key}, MapKeyStr);
 }
 
 /*
  * other interface functions
  */
 
+void map_clear(HashMap *map) {
+    assert(map);
+
+    if (map->cap > 0) {
+        memset(map->ctrl, TMAP_CTRL_EMPTY, map->cap + TMAP_GROUP_SIZE);
+    }
+    map->len = 0;
+    map->deleted = 0;
+}
+
+void map_reserve(HashMap *map, size_t count) {
+    assert(map);
+
+    size_t cap = tmap__reserve_cap(count);
+    if (cap > map->cap) {
+        hashmap_rehash(map, cap, map->str_keys ? MapKeyStr : MapKeyInt);
+    }
+}
+
 void map_free(HashMap *map) {
     assert(map);
     
-    free(map->data);
+    free(map->slots);
     *map = (HashMap) {0};
 }
 
 int map_begin(HashMap *map) {
-    int result = 0;
-    
-    if (map->cap == 0) {
-        return result;
-    }
-    
-    while (map->meta[result] != META_IN_USE && result < (int) map->cap) {
-        ++result;
-    }
-
-    return result;
+    return map_next(map, -1);
 }
 
 int map_end(HashMap *map) {
@@ -378,11 +352,5 @@ int map_end(HashMap *map) {
 }
 
 int map_next(HashMap *map, int cur) {
-    int result = cur + 1;
-
-    while (result < (int) map->cap && map->meta[result] != META_IN_USE) {
-        ++result;
-    }
-
-    return result;
+    return tmap__next(map->ctrl, map->cap, cur);
 }
@@ -1,8 +1,10 @@
 // hash_map.h - Johan Smet - BSD-3-Clause (see LICENSE)
 //
-// an associative container (open addressing, linear probing)
+// an associative container (open addressing, "swiss table" layout)
 //  - basic implementation to avoid dependencies on external library
-//  - limited operations: only add / lookup
+//  - the capacity is a power of two, each slot has a control byte with 7 bits of the hash of its key
+//    the control bytes are probed a group (16 slots) at a time, with SSE2 when available
+//  - operations: add / lookup / remove (leaves a tombstone) / clear (keeps the capacity) / reserve
 //  - hashmap does not copy objects - keep them around long enough or bad things will happen
 //  - iterators can be invalidated by changing the container during iteration
 
@@ -19,13 +21,18 @@ typedef union MapValue {
     const void *as_const_ptr;
 } MapValue;
 
+typedef struct MapSlot {
+    MapValue key;
+    MapValue val;
+} MapSlot;
+
 typedef struct HashMap {
     size_t len;
-    size_t cap;
-    void *data;
-    MapValue *keys;
-    MapValue *vals;
-    uint8_t *meta;
+    size_t cap;         // number of slots: zero or a power of two
+    size_t deleted;     // number of slots with a tombstone (see map_*_remove)
+    bool str_keys;      // the keys are strings, remembered to rehash the map in map_reserve
+    MapSlot *slots;
+    uint8_t *ctrl;      // control byte per slot, followed by a copy of the first group (allocated with slots)
 } HashMap;
 
 inline static size_t map_len(HashMap *map) {
@@ -60,6 +67,16 @@ void map_str_str_put(HashMap *map, const char *key, const char *value);
 const char *map_str_str_get(HashMap *map, const char *key);
 bool map_str_str_has(HashMap *map, const char *key);
 
+// remove the key, returns false if it wasn't in the map
+bool map_int_remove(HashMap *map, uint64_t key);
+bool map_ptr_remove(HashMap *map, void *key);
+bool map_str_remove(HashMap *map, const char *key);
+
+// remove all elements but keep the memory of the map
+void map_clear(HashMap *map);
+// make room for count elements in total: adding them doesn't allocate memory
+void map_reserve(HashMap *map, size_t count);
+
 void map_free(HashMap *map);
 
 // iteration over elements
@@ -67,12 +84,12 @@ int map_begin(HashMap *map);
 int map_end(HashMap *map);
 int map_next(HashMap *map, int cur);
 
-#define map_key(map, idx)      ((map)->keys[(idx)].as_ptr)
-#define map_key_str(map, idx)  ((const char *) (map)->keys[(idx)].as_const_ptr)
-#define map_key_int(map, idx)  ((map)->keys[(idx)].as_uint64)
-#define map_val(map, idx)      ((map)->vals[(idx)].as_ptr)
-#define map_val_str(map, idx)  ((const char *) (map)->vals[(idx)].as_const_ptr)
-#define map_val_int(map, idx)  ((map)->vals[(idx)].as_uint64)
+#define map_key(map, idx)      ((map)->slots[(idx)].key.as_ptr)
+#define map_key_str(map, idx)  ((const char *) (map)->slots[(idx)].key.as_const_ptr)
+#define map_key_int(map, idx)  ((map)->slots[(idx)].key.as_uint64)
+#define map_val(map, idx)      ((map)->slots[(idx)].val.as_ptr)
+#define map_val_str(map, idx)  ((const char *) (map)->slots[(idx)].val.as_const_ptr)
+#define map_val_int(map, idx)  ((map)->slots[(idx)].val.as_uint64)
 
 
 
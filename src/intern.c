@@ -0,0 +1,47 @@
+// intern.c - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// string interning
+
+#include "intern.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define INTERN_BLOCK_SIZE   4096
+
+const char *intern_str(InternTable *table, const char *str) {
+    assert(table);
+    assert(str);
+
+    const char *result = map_str_str_get(&table->map, str);
+    if (result) {
+        return result;
+    }
+
+    /* a zero-initialized table sets up its storage on first use */
+    if (table->strings.block_size == 0) {
+        mem_arena_init(&table->strings, INTERN_BLOCK_SIZE, 1);
+    }
+
+    size_t len = strlen(str) + 1;
+    char *copy = mem_arena_allocate(&table->strings, len);
+    memcpy(copy, str, len);
+
+    map_str_str_put(&table->map, copy, copy);
+    return copy;
+}
+
+const char *intern_find(InternTable *table, const char *str) {
+    assert(table);
+    assert(str);
+
+    return map_str_str_get(&table->map, str);
+}
+
+void intern_free(InternTable *table) {
+    assert(table);
+
+    map_free(&table->map);
+    mem_arena_free(&table->strings);
+    *table = (InternTable) {0};
+}
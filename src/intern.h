@@ -0,0 +1,31 @@
+// intern.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// string interning: the table keeps one copy of each unique string
+//  - equal strings intern to the same pointer, so interned strings can be compared and hashed by address
+//    (e.g. as the keys of a TYPED_MAP_ISTR map, see typed_map.h)
+//  - the copies remain valid until the table is freed
+
+#ifndef JS_INTERN_H
+#define JS_INTERN_H
+
+#include "types.h"
+#include "allocator.h"
+#include "hash_map.h"
+
+typedef struct InternTable {
+    HashMap map;            // string (content) -> interned copy
+    MemArena strings;       // storage of the copies
+} InternTable;
+
+// the interned copy of str, added to the table the first time the string is seen
+const char *intern_str(InternTable *table, const char *str);
+// the interned copy of str, NULL if the string isn't in the table (doesn't add it)
+const char *intern_find(InternTable *table, const char *str);
+
+static inline size_t intern_count(InternTable *table) {
+    return map_len(&table->map);
+}
+
+void intern_free(InternTable *table);
+
+#endif // JS_INTERN_H
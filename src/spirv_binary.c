@@ -47,23 +47,32 @@ bool spirv_bin_load(SPIRV_binary *spirv, int8_t *data) {
     assert(spirv != NULL);
     assert(data != NULL);
 
+    if (arr_len(data) % 4 != 0) {
+        *spirv = (SPIRV_binary) {0};
+        spirv->error_msg = "SPIR-V binary length should be a multiple of 32bit";
+        return false;
+    }
+
+    return spirv_bin_load_borrowed(spirv, (const uint32_t *) data, arr_len(data) / 4);
+}
+
+bool spirv_bin_load_borrowed(SPIRV_binary *spirv, const uint32_t *words, size_t word_count) {
+    assert(spirv != NULL);
+    assert(words != NULL);
+    assert(((uintptr_t) words & 3) == 0);
+
     // initialization
     *spirv = (SPIRV_binary) {0};
 
     // do some basic validation on the binary
-    if (arr_len(data) < 20) {
+    if (word_count < 5) {
         spirv->error_msg = "SPIR-V binary too small (should be at least 20 bytes)";
         return false;
     }
 
-    if (arr_len(data) % 4 != 0) {
-        spirv->error_msg = "SPIR-V binary length should be a multiple of 32bit";
-        return false;
-    }
-
-    // SPIR-V opcodes are 32bit words
-    spirv->word_len = arr_len(data) / 4;
-    spirv->cur_op = (uint32_t *) data;
+    // the binary is never written to, it can be in read-only (mapped) memory
+    spirv->word_len = word_count;
+    spirv->cur_op = (uint32_t *) words;
     spirv->end_op = spirv->cur_op + spirv->word_len;
 
     // read header
@@ -129,15 +138,16 @@ void spirv_bin_opcode_add(SPIRV_binary *spirv, uint16_t opcode, uint32_t *extra,
     
     spirv->cur_op = ((uint32_t *) spirv->binary_data) + 5;
     spirv->fst_op = spirv->cur_op;
-    spirv->end_op = ((uint32_t *) spirv->binary_data) + spirv->word_len;
 
     /* initialize the new opcode */
-    SPIRV_opcode *new_op = spirv_bin_opcode_end(spirv);
+    SPIRV_opcode *new_op = (SPIRV_opcode *) (((uint32_t *) spirv->binary_data) + spirv->word_len);
     new_op->op.kind = opcode;
     new_op->op.length = count_extra + 1;
     memcpy(new_op->optional, extra, count_extra * sizeof(uint32_t));
     
+    /* the new opcode is part of the binary */
     spirv->word_len = arr_len(spirv->binary_data) / 4;
+    spirv->end_op = ((uint32_t *) spirv->binary_data) + spirv->word_len;
 }
 
 const char *spriv_bin_error_msg(SPIRV_binary *spirv) {
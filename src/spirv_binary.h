@@ -29,7 +29,7 @@ typedef struct SPIRV_opcode {
 } SPIRV_opcode;
 
 typedef struct SPIRV_binary {
-    int8_t *binary_data;    // dynamic array
+    int8_t *binary_data;    // dynamic array, only for binaries built with spirv_bin_opcode_add
     size_t word_len;        // number of 32-bit words in the binary
 
     uint32_t *fst_op;       // pointer to the first opcode
@@ -44,7 +44,9 @@ typedef struct SPIRV_binary {
 // interface functions
 void spirv_bin_init(SPIRV_binary *spirv, uint8_t version_high, uint8_t version_low);
 void spirv_bin_finalize(SPIRV_binary *spirv);
-bool spirv_bin_load(SPIRV_binary *spirv, int8_t *data);
+// the binary isn't copied: the data has to stay around as long as the SPIRV_binary is used
+bool spirv_bin_load(SPIRV_binary *spirv, int8_t *data);     // data should be a dyn_array
+bool spirv_bin_load_borrowed(SPIRV_binary *spirv, const uint32_t *words, size_t word_count);
 void spirv_bin_free(SPIRV_binary *spirv);
 
 SPIRV_header *spirv_bin_header(SPIRV_binary *spirv);
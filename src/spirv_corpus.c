@@ -0,0 +1,144 @@
+// spirv_corpus.c - Johan Smet - BSD-3-Clause (see LICENSE)
+
+#include "spirv_corpus.h"
+#include "spirv_binary.h"
+#include "spirv_module.h"
+#include "spirv_text.h"
+#include "thread_pool.h"
+#include "dyn_array.h"
+#include "utils.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WORKER_ARENA_SIZE (64 * 1024)
+
+static int compare_filenames(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+static const char *worker_error(SPIRV_corpus *corpus, uint32_t worker, const char *fmt, const char *detail) {
+/* error messages are kept in the arena of the worker, no locking required */
+    size_t len = strlen(fmt) + strlen(detail) + 1;
+    char *msg = mem_arena_allocate(&corpus->worker_arenas[worker], len);
+    snprintf(msg, len, fmt, detail);
+    return msg;
+}
+
+static void corpus_load_file(void *context, uint32_t index, uint32_t worker) {
+    SPIRV_corpus *corpus = context;
+    SPIRV_corpus_file *file = &corpus->files[index];
+
+    uint64_t start = time_now_ns();
+
+    FileMapping mapping;
+    if (!file_map(file->filename, false, &mapping)) {
+        file->error_msg = "Unable to open file";
+        file->load_ns = time_now_ns() - start;
+        return;
+    }
+
+    SPIRV_binary spirv_bin;
+
+    if (mapping.size % 4 != 0) {
+        file->error_msg = "SPIR-V binary length should be a multiple of 32bit";
+    } else if (!spirv_bin_load_borrowed(&spirv_bin, mapping.data, mapping.size / 4)) {
+        file->error_msg = spirv_bin.error_msg;
+    } else {
+        SPIRV_module spirv_mod;
+        if (!spirv_module_load(&spirv_mod, &spirv_bin)) {
+            file->error_msg = spirv_mod.error_msg;
+        } else {
+            spirv_module_prepare_all_functions(&spirv_mod);
+
+            file->num_opcodes = (uint32_t) spirv_module_opcode_count(&spirv_mod);
+
+            for (EntryPoint *ep = spirv_mod.entry_points; ep != arr_end(spirv_mod.entry_points); ++ep) {
+                if (ep->function == NULL) {
+                    const char *name = spirv_module_name_by_id(&spirv_mod, ep->func_id, -1);
+                    file->error_msg = worker_error(corpus, worker, "Entry point %s doesn't refer to a function", (name) ? name : "?");
+                    break;
+                }
+            }
+
+            if (file->error_msg == NULL && corpus->disassemble) {
+                spirv_text_set_flag(&spirv_mod, SPIRV_TEXT_USE_ID_NAMES, true);
+                spirv_text_set_flag(&spirv_mod, SPIRV_TEXT_USE_TYPE_ALIAS, true);
+                spirv_text_set_flag(&spirv_mod, SPIRV_TEXT_USE_CONSTANT_ALIAS, true);
+
+                /* reuse one buffer for all lines */
+                char *line = NULL;
+                for (uint32_t idx = 0; idx < file->num_opcodes; ++idx) {
+                    arr_clear(line);
+                    line = spirv_text_opcode_append(line, spirv_module_opcode_by_index(&spirv_mod, idx), &spirv_mod, NULL);
+                    file->text_size += arr_len(line);
+                }
+                arr_free(line);
+            }
+        }
+
+        spirv_module_free(&spirv_mod);
+        spirv_bin_free(&spirv_bin);
+    }
+
+    file_unmap(&mapping);
+
+    file->success = file->error_msg == NULL;
+    file->load_ns = time_now_ns() - start;
+}
+
+bool spirv_corpus_scan(SPIRV_corpus *corpus, const char *dir) {
+    assert(corpus);
+    assert(dir);
+
+    *corpus = (SPIRV_corpus) {0};
+
+    char **filenames = NULL;
+    if (!dir_list_files(dir, ".spv", &filenames)) {
+        return false;
+    }
+
+    if (filenames) {
+        qsort(filenames, arr_len(filenames), sizeof(char *), compare_filenames);
+    }
+
+    for (char **name = filenames; name != arr_end(filenames); ++name) {
+        arr_push(corpus->files, ((SPIRV_corpus_file) {.filename = *name}));
+    }
+
+    arr_free(filenames);
+    return true;
+}
+
+void spirv_corpus_load(SPIRV_corpus *corpus, uint32_t num_workers, bool disassemble) {
+    assert(corpus);
+
+    num_workers = MAX(num_workers, 1u);
+    corpus->disassemble = disassemble;
+
+    arr_reserve(corpus->worker_arenas, num_workers);
+    for (uint32_t idx = 0; idx < num_workers; ++idx) {
+        mem_arena_init(&corpus->worker_arenas[idx], WORKER_ARENA_SIZE, ARENA_DEFAULT_ALIGN);
+    }
+
+    thread_pool_run(num_workers, (uint32_t) arr_len(corpus->files), corpus_load_file, corpus);
+
+    corpus->num_failed = 0;
+    for (SPIRV_corpus_file *file = corpus->files; file != arr_end(corpus->files); ++file) {
+        corpus->num_failed += !file->success;
+    }
+}
+
+void spirv_corpus_free(SPIRV_corpus *corpus) {
+    if (corpus) {
+        for (SPIRV_corpus_file *file = corpus->files; file != arr_end(corpus->files); ++file) {
+            arr_free(file->filename);
+        }
+        for (MemArena *arena = corpus->worker_arenas; arena != arr_end(corpus->worker_arenas); ++arena) {
+            mem_arena_free(arena);
+        }
+        arr_free(corpus->files);
+        arr_free(corpus->worker_arenas);
+    }
+}
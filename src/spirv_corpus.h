@@ -0,0 +1,35 @@
+// spirv_corpus.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Bulk loading of a directory of SPIR-V binaries, e.g. to check a regression corpus.
+//  - the files are divided over a number of worker threads (see thread_pool.h)
+//  - every file is mapped, parsed into a module and optionally disassembled
+//  - the outcome and the load time of every file is recorded
+
+#ifndef JS_SHADER_SIM_SPIRV_CORPUS_H
+#define JS_SHADER_SIM_SPIRV_CORPUS_H
+
+#include "types.h"
+#include "allocator.h"
+
+typedef struct SPIRV_corpus_file {
+    char *filename;             // dyn_array
+    bool success;
+    const char *error_msg;      // NULL on success
+    uint64_t load_ns;           // time to load (and disassemble) the file
+    uint32_t num_opcodes;
+    size_t text_size;           // size of the disassembly (in bytes)
+} SPIRV_corpus_file;
+
+typedef struct SPIRV_corpus {
+    SPIRV_corpus_file *files;   // dyn_array
+    MemArena *worker_arenas;    // dyn_array, one per worker (error messages)
+    bool disassemble;
+    uint32_t num_failed;
+} SPIRV_corpus;
+
+// interface functions
+bool spirv_corpus_scan(SPIRV_corpus *corpus, const char *dir);
+void spirv_corpus_load(SPIRV_corpus *corpus, uint32_t num_workers, bool disassemble);
+void spirv_corpus_free(SPIRV_corpus *corpus);
+
+#endif // JS_SHADER_SIM_SPIRV_CORPUS_H
@@ -10,6 +10,14 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#define VARIABLE_ALIGN      8u
+#define STACK_SIZE_UNKNOWN  UINT32_MAX
+#define STACK_SIZE_PENDING  (UINT32_MAX - 1)
+
+/* universal limits of the SPIR-V specification: anything larger comes from a malformed binary */
+#define SPIRV_MAX_ID_BOUND      0x3fffffu
+#define SPIRV_MAX_MEMBERS       16383u
+
 /* allocation / initialization functions */
 static inline Type *new_type(SPIRV_module *module, uint32_t id, TypeKind kind) {
     Type *result = mem_arena_allocate(&module->allocator, sizeof(Type));
@@ -43,50 +51,91 @@ static inline SPIRV_function *new_function(SPIRV_module *module, Type *type, uin
     SPIRV_function *result = mem_arena_allocate(&module->allocator, sizeof(SPIRV_function));
     *result = (SPIRV_function) {
         .func.id = id,
-        .func.type = type
+        .func.type = type,
+        .stack_size = STACK_SIZE_UNKNOWN
     };
     return result;
 }
 
-/* lookup functions */
-static inline uint64_t id_member_to_key(uint32_t id, int32_t member) {
-    return (uint64_t) id << 32 | (uint32_t) member;
+/* id table */
+static inline SPIRV_id *id_lookup(SPIRV_module *module, uint32_t id, IdKind kind) {
+    if (id >= module->id_bound || module->ids[id].kind != kind) {
+        return NULL;
+    }
+    return &module->ids[id];
+}
+
+static SPIRV_id *id_entry(SPIRV_module *module, uint32_t id) {
+/* the table starts at the bound in the header (or less for tiny binaries) and grows when needed.
+   Returns NULL and sets the error of the module when the id can't be valid. */
+    if (id >= module->id_bound) {
+        if (id >= SPIRV_MAX_ID_BOUND) {
+            module->error_msg = "Id exceeds the maximum id bound";
+            return NULL;
+        }
+
+        uint64_t new_bound = MIN(MAX((uint64_t) id + 1, (uint64_t) module->id_bound * 2), SPIRV_MAX_ID_BOUND);
+        SPIRV_id *new_ids = realloc(module->ids, new_bound * sizeof(SPIRV_id));
+        if (new_ids == NULL) {
+            module->error_msg = "Out of memory for the id table";
+            return NULL;
+        }
+        memset(new_ids + module->id_bound, 0, (new_bound - module->id_bound) * sizeof(SPIRV_id));
+        module->ids = new_ids;
+        module->id_bound = (uint32_t) new_bound;
+    }
+    return &module->ids[id];
 }
 
+static inline SPIRV_id *id_define(SPIRV_module *module, uint32_t id, IdKind kind) {
+    SPIRV_id *entry = id_entry(module, id);
+    if (entry == NULL) {
+        return NULL;
+    }
+    assert(entry->kind == IdNone || entry->kind == kind);
+    entry->kind = kind;
+    return entry;
+}
+
+/* lookup functions */
 Type *spirv_module_type_by_id(SPIRV_module *module, uint32_t id) {
-    return map_int_ptr_get(&module->types, id);
+    SPIRV_id *entry = id_lookup(module, id, IdType);
+    return (entry) ? entry->type : NULL;
 }
 
 const char *spirv_module_name_by_id(SPIRV_module *module, uint32_t id, int32_t member) {
-    return map_int_str_get(&module->names, id_member_to_key(id, member));
+    if (id >= module->id_bound) {
+        return NULL;
+    }
+
+    SPIRV_id *entry = &module->ids[id];
+
+    if (member < 0) {
+        return entry->name;
+    } else if (member < (int32_t) arr_len(entry->member_names)) {
+        return entry->member_names[member];
+    } else {
+        return NULL;
+    }
 }
 
 Constant *spirv_module_constant_by_id(SPIRV_module *module, uint32_t id) {
-    return map_int_ptr_get(&module->constants, id);
+    SPIRV_id *entry = id_lookup(module, id, IdConstant);
+    return (entry) ? entry->constant : NULL;
 }
 
 uint32_t spirv_module_variable_count(SPIRV_module *module) {
-	return (uint32_t) map_len(&module->variables);
+	return (uint32_t) arr_len(module->variables);
 }
 
 uint32_t spirv_module_variable_id(SPIRV_module *module, uint32_t index) {
-	assert(index < map_len(&module->variables));
-
-	uint32_t current = 0;
-
-	for (int iter = map_begin(&module->variables); iter != map_end(&module->variables); iter = map_next(&module->variables, iter)) {
-		if (current == index) {
-			return (uint32_t) map_key_int(&module->variables, iter);
-		} else {
-			++current;
-		}
-	}
-
-	return 0;
+	assert(index < arr_len(module->variables));
+	return module->variables[index]->id;
 }
 
 Variable *spirv_module_variable_by_id(SPIRV_module *module, uint32_t id) {
-    return map_int_ptr_get(&module->variables, id);
+    SPIRV_id *entry = id_lookup(module, id, IdVariable);
+    return (entry) ? entry->variable : NULL;
 }
 
 bool spirv_module_variable_by_access(
@@ -100,11 +149,11 @@ bool spirv_module_variable_by_access(
     assert(ret_var != NULL);
     assert(ret_member != NULL);
 
-    Variable **vars = map_int_ptr_get(&module->variables_sc, storage_class);
-    
-    if (!vars) {
+    if (storage_class >= STORAGE_CLASS_COUNT) {
         return false;
     }
+
+    Variable **vars = module->variables_sc[storage_class];
     
     for (Variable **var = vars; var != arr_end(vars); ++var) {
         if (memcmp(&(*var)->access, &access, sizeof(VariableAccess)) == 0) {
@@ -126,45 +175,74 @@ bool spirv_module_variable_by_access(
 }
 
 SPIRV_function *spirv_module_function_by_id(SPIRV_module *module, uint32_t id) {
-    return map_int_ptr_get(&module->functions, id);
+    SPIRV_id *entry = id_lookup(module, id, IdFunction);
+    return (entry) ? entry->function : NULL;
 }
 
-static SPIRV_opcode **decoration_ops_by_id(SPIRV_module *module, uint32_t target, int32_t member) {
-    return map_int_ptr_get(&module->decorations, id_member_to_key(target, member));
-}
+const Decorations *spirv_module_decorations(SPIRV_module *module, uint32_t id, int32_t member) {
+    static const Decorations no_decorations = {0};
 
-static bool id_has_decoration (SPIRV_module *module, uint32_t target, int32_t member, SpvDecoration wanted) {
-    
-    SPIRV_opcode **decorations = decoration_ops_by_id(module, target, member);
-    
-    for (SPIRV_opcode **op = decorations; op != arr_end(decorations); ++op) {
-        uint32_t dec_offset = ((*op)->op.kind == SpvOpDecorate) ? 1 : 2;
-        uint32_t decoration = (*op)->optional[dec_offset];
-        
-        if (decoration == wanted) {
-            return true;
-        }
+    if (id >= module->id_bound) {
+        return &no_decorations;
     }
-    
-    return false;
+
+    SPIRV_id *entry = &module->ids[id];
+
+    if (member < 0) {
+        return &entry->decorations;
+    } else if (member < (int32_t) arr_len(entry->member_decorations)) {
+        return &entry->member_decorations[member];
+    } else {
+        return &no_decorations;
+    }
+}
+
+static inline bool id_has_decoration (SPIRV_module *module, uint32_t target, int32_t member, SpvDecoration wanted) {
+    return spirv_decorations_has(spirv_module_decorations(module, target, member), wanted);
 }
 
 static void define_extinst_set(SPIRV_module *module, uint32_t id, const char *name) {
-    map_int_str_put(&module->extinst_sets, id, name);
+    SPIRV_id *entry = id_define(module, id, IdExtInstSet);
+    if (entry == NULL) {
+        return;
+    }
+    entry->extinst_set = name;
+    arr_push(module->extinst_set_ids, id);
 }
 
 static void define_name(SPIRV_module *module, uint32_t id, const char *name, int member_index) {
-    map_int_str_put(&module->names, id_member_to_key(id, member_index), name);
+    SPIRV_id *entry = id_entry(module, id);
+    if (entry == NULL) {
+        return;
+    }
+
+    if (member_index < 0) {
+        entry->name = name;
+        return;
+    }
+
+    if ((uint32_t) member_index >= SPIRV_MAX_MEMBERS) {
+        module->error_msg = "Member index exceeds the maximum number of members";
+        return;
+    }
+
+    while ((int32_t) arr_len(entry->member_names) <= member_index) {
+        arr_push(entry->member_names, NULL);
+    }
+    entry->member_names[member_index] = name;
 }
 
 static void define_sc_variable(SPIRV_module *module, Variable *var) {
-    Variable **kind_vars = map_int_ptr_get(&module->variables_sc, var->kind);
-    arr_push(kind_vars, var);
-    map_int_ptr_put(&module->variables_sc, var->kind, kind_vars);
+    if (var->kind < STORAGE_CLASS_COUNT) {
+        arr_push(module->variables_sc[var->kind], var);
+    }
 }
 
 static void define_label(SPIRV_module *module, uint32_t id, SPIRV_opcode *op) {
-    map_int_ptr_put(&module->labels, id, op);
+    SPIRV_id *entry = id_define(module, id, IdLabel);
+    if (entry != NULL) {
+        entry->label = op;
+    }
 }
 
 static inline bool is_opcode_type(SPIRV_opcode *op) {
@@ -175,6 +253,11 @@ static void handle_opcode_type(SPIRV_module *module, SPIRV_opcode *op) {
     Type *type = NULL;
     uint32_t result_id = op->optional[0];
 
+    // make sure the id is valid before the type allocates anything
+    if (id_entry(module, result_id) == NULL) {
+        return;
+    }
+
     switch (op->op.kind) {                                  // FIXME: support all types
         case SpvOpTypeVoid:
             type = new_type(module, result_id, TypeVoid);
@@ -237,7 +320,7 @@ static void handle_opcode_type(SPIRV_module *module, SPIRV_opcode *op) {
             type = new_type(module, result_id, TypePointer);
             type->pointer.storage_class = op->optional[1];
             type->base_type = spirv_module_type_by_id(module, op->optional[2]);
-            type->element_size = sizeof(uint32_t);
+            type->element_size = sizeof(uint64_t);
             type->count = 1;
             break;
 
@@ -255,6 +338,14 @@ static void handle_opcode_type(SPIRV_module *module, SPIRV_opcode *op) {
             type->count = spirv_module_constant_by_id(module, op->optional[2])->value.as_uint;
             type->element_size = type->base_type->element_size * type->base_type->count;
             break;
+
+        case SpvOpTypeRuntimeArray:
+            /* the size is only known once a buffer is bound to the variable */
+            type = new_type(module, result_id, TypeArray);
+            type->base_type = spirv_module_type_by_id(module, op->optional[1]);
+            type->count = 0;
+            type->element_size = type->base_type->element_size * type->base_type->count;
+            break;
             
         case SpvOpTypeStruct:
             type = new_type(module, result_id, TypeStructure);
@@ -268,7 +359,7 @@ static void handle_opcode_type(SPIRV_module *module, SPIRV_opcode *op) {
     }
 
     if (type) {
-        map_int_ptr_put(&module->types, op->optional[0], type);
+        id_define(module, result_id, IdType)->type = type;
     }
 }
 
@@ -301,7 +392,7 @@ static void handle_opcode_constant(SPIRV_module *module, SPIRV_opcode *op) {
             
             int8_t *dst = (int8_t *) constant->value.as_int_array;
             for (int32_t i = 2; i < op->op.length - 1; ++i) {
-                Constant *src = map_int_ptr_get(&module->constants, op->optional[i]);
+                Constant *src = spirv_module_constant_by_id(module, op->optional[i]);
                 size_t src_size = src->type->count * src->type->element_size;
                 if (src->type->count == 1) {
                     memcpy(dst, &src->value.as_int, src_size);
@@ -313,28 +404,28 @@ static void handle_opcode_constant(SPIRV_module *module, SPIRV_opcode *op) {
     }
 
     if (constant) {
-        map_int_ptr_put(&module->constants, result_id, constant);
+        SPIRV_id *entry = id_define(module, result_id, IdConstant);
+        if (entry == NULL) {
+            return;
+        }
+        entry->constant = constant;
+        arr_push(module->constant_ids, result_id);
     }
 }
 
 static void variable_check_access_decorations(SPIRV_module *module, VariableAccess *access, uint32_t id, int32_t member_id) {
 
-    SPIRV_opcode **decorations = decoration_ops_by_id(module, id, member_id);
-
-    access->kind = VarAccessNone;
-    access->index = -1;
-    
-    for (SPIRV_opcode **op = decorations; op != arr_end(decorations); ++op) {
-        uint32_t dec_offset = ((*op)->op.kind == SpvOpDecorate) ? 1 : 2;
-        uint32_t decoration = (*op)->optional[dec_offset];
-        
-        if (decoration == SpvDecorationBuiltIn) {
-            access->kind = VarAccessBuiltIn;
-            access->index = (int32_t) (*op)->optional[dec_offset+1];
-        } else if (decoration == SpvDecorationLocation) {
-            access->kind = VarAccessLocation;
-            access->index = (int32_t) (*op)->optional[dec_offset+1];
-        }
+    const Decorations *decorations = spirv_module_decorations(module, id, member_id);
+
+    if (spirv_decorations_has(decorations, SpvDecorationBuiltIn)) {
+        access->kind = VarAccessBuiltIn;
+        access->index = (int32_t) decorations->builtin;
+    } else if (spirv_decorations_has(decorations, SpvDecorationLocation)) {
+        access->kind = VarAccessLocation;
+        access->index = (int32_t) decorations->location;
+    } else {
+        access->kind = VarAccessNone;
+        access->index = -1;
     }
 }
 
@@ -376,6 +467,10 @@ static void handle_opcode_variable(SPIRV_module *module, SPIRV_opcode *op) {
     uint32_t var_type = op->optional[0];
     uint32_t var_id = op->optional[1];
     uint32_t storage_class = op->optional[2];
+
+    if (id_entry(module, var_id) == NULL) {
+        return;
+    }
     
     Type *type = spirv_module_type_by_id(module, var_type);
     assert (type->kind == TypePointer);
@@ -402,11 +497,18 @@ static void handle_opcode_variable(SPIRV_module *module, SPIRV_opcode *op) {
         }
     }
 
-    // save to global id map
-    map_int_ptr_put(&module->variables, var_id, var);
+    // global variables are placed after each other, function variables are laid out per function
+    if (var->kind != ClassFunction) {
+        var->mem_offset = module->globals_size;
+        module->globals_size += ALIGN_UP(spirv_variable_size(var), VARIABLE_ALIGN);
+    }
+
+    // save to the id table
+    id_define(module, var_id, IdVariable)->variable = var;
+    arr_push(module->variables, var);
 }
 
-static void handle_opcode_function(SPIRV_module *module, SPIRV_opcode *op) {
+static void handle_opcode_function(SPIRV_module *module, SPIRV_opcode *op, uint32_t op_index) {
     assert(module);
     assert(op);
     assert(op->op.kind == SpvOpFunction);
@@ -417,40 +519,75 @@ static void handle_opcode_function(SPIRV_module *module, SPIRV_opcode *op) {
     // uint32_t func_control = op->optional[2];
     uint32_t func_type = op->optional[3];
 
+    if (id_entry(module, func_id) == NULL) {
+        return;
+    }
+
     SPIRV_function *func = new_function(module, spirv_module_type_by_id(module, func_type), func_id);
+    func->def_index = op_index;
 
     // optional name that was defined earlier
     func->func.name = spirv_module_name_by_id(module, func_id, -1);
 
-    // scan ahead to the first real instruction of the function
-    func->fst_opcode = spirv_bin_opcode_next(module->spirv_bin);
+    id_define(module, func_id, IdFunction)->function = func;
+    arr_push(module->functions, func);
+}
 
-    while (func->fst_opcode != NULL &&
-           (func->fst_opcode->op.kind == SpvOpLabel ||
-            func->fst_opcode->op.kind == SpvOpVariable ||
-            func->fst_opcode->op.kind == SpvOpFunctionParameter)) {
+static void function_add_opcode(SPIRV_function *func, SPIRV_opcode *op) {
+/* called for each opcode between OpFunction and OpFunctionEnd, in order */
 
-        if (func->fst_opcode->op.kind == SpvOpVariable) {
-            arr_push(func->func.variable_ids, func->fst_opcode->optional[1]);
-        } else if (func->fst_opcode->op.kind == SpvOpFunctionParameter) {
-            arr_push(func->func.parameter_ids, func->fst_opcode->optional[1]);
+    // the labels, parameters and variables before the first real instruction of the function
+    if (func->fst_opcode == NULL) {
+        if (op->op.kind == SpvOpLabel) {
+            return;
+        } else if (op->op.kind == SpvOpVariable) {
+            arr_push(func->func.variable_ids, op->optional[1]);
+            return;
+        } else if (op->op.kind == SpvOpFunctionParameter) {
+            arr_push(func->func.parameter_ids, op->optional[1]);
+            return;
         }
 
-        func->fst_opcode = spirv_bin_opcode_next(module->spirv_bin);
+        func->fst_opcode = op;
     }
 
-    // scan ahead to the last real instruction of the function
-    func->lst_opcode = func->fst_opcode;
-    SPIRV_opcode *next = spirv_bin_opcode_next(module->spirv_bin);
+    func->lst_opcode = op;
 
-    while (next && next->op.kind != SpvOpFunctionEnd) {
-        func->lst_opcode = next;
-        next = spirv_bin_opcode_next(module->spirv_bin);
+    if (op->op.kind == SpvOpFunctionCall) {
+        arr_push(func->callee_ids, op->optional[2]);
     }
+}
 
-    spirv_bin_opcode_jump_to(module->spirv_bin, op);
+static void function_layout_frame(SPIRV_module *module, SPIRV_function *func) {
+    func->frame_size = 0;
 
-    map_int_ptr_put(&module->functions, func_id, func);
+    for (uint32_t idx = 0; idx < arr_len(func->func.variable_ids); ++idx) {
+        Variable *var = spirv_module_variable_by_id(module, func->func.variable_ids[idx]);
+        var->mem_offset = func->frame_size;
+        func->frame_size += ALIGN_UP(spirv_variable_size(var), VARIABLE_ALIGN);
+    }
+}
+
+static uint32_t function_stack_size(SPIRV_module *module, SPIRV_function *func) {
+/* recursion isn't allowed in SPIR-V, so the call graph is acyclic and the depth of the stack is bounded */
+    if (func->stack_size != STACK_SIZE_UNKNOWN) {
+        assert(func->stack_size != STACK_SIZE_PENDING && "recursive function call");
+        return func->stack_size;
+    }
+
+    func->stack_size = STACK_SIZE_PENDING;
+    uint32_t callee_stack = 0;
+
+    for (uint32_t idx = 0; idx < arr_len(func->callee_ids); ++idx) {
+        SPIRV_function *callee = spirv_module_function_by_id(module, func->callee_ids[idx]);
+        if (callee) {
+            uint32_t size = function_stack_size(module, callee);
+            callee_stack = MAX(callee_stack, size);
+        }
+    }
+
+    func->stack_size = func->frame_size + callee_stack;
+    return func->stack_size;
 }
 
 static void handle_opcode_entrypoint(SPIRV_module *module, SPIRV_opcode *op) {
@@ -475,31 +612,112 @@ static inline bool is_opcode_decoration(SPIRV_opcode *op) {
 }
 
 static void handle_opcode_decoration(SPIRV_module *module, SPIRV_opcode *op) {
-    uint32_t target = op->optional[0];
-    int32_t member = (op->op.kind == SpvOpMemberDecorate) ? (int32_t) op->optional[1] : -1;
-    uint64_t key = id_member_to_key(target, member);
+/* decode the decoration once into the table of the target, queries don't have to look at the opcodes again */
+    SPIRV_id *target = id_entry(module, op->optional[0]);
+    if (target == NULL) {
+        return;
+    }
+
+    Decorations *decorations = &target->decorations;
+    uint32_t dec_offset = 1;
+
+    if (op->op.kind == SpvOpMemberDecorate) {
+        uint32_t member = op->optional[1];
+        if (member >= SPIRV_MAX_MEMBERS) {
+            module->error_msg = "Member index exceeds the maximum number of members";
+            return;
+        }
+        while (arr_len(target->member_decorations) <= member) {
+            arr_push(target->member_decorations, (Decorations) {0});
+        }
+        decorations = &target->member_decorations[member];
+        dec_offset = 2;
+    }
+
+    uint32_t decoration = op->optional[dec_offset];
+    uint32_t operand = (op->op.length > dec_offset + 2) ? op->optional[dec_offset + 1] : 0;
 
-    SPIRV_opcode **id_decs = map_int_ptr_get(&module->decorations, key);
-    arr_push(id_decs, op);
-    map_int_ptr_put(&module->decorations, key, id_decs);
+    if (decoration < DECORATION_MAX_BIT) {
+        decorations->present |= UINT64_C(1) << decoration;
+    }
+
+    switch (decoration) {
+        case SpvDecorationLocation:
+            decorations->location = operand;
+            break;
+        case SpvDecorationBuiltIn:
+            decorations->builtin = operand;
+            break;
+        case SpvDecorationOffset:
+            decorations->offset = operand;
+            break;
+        case SpvDecorationArrayStride:
+            decorations->array_stride = operand;
+            break;
+        case SpvDecorationBinding:
+            decorations->binding = operand;
+            break;
+        case SpvDecorationDescriptorSet:
+            decorations->descriptor_set = operand;
+            break;
+        default:
+            break;
+    }
 }
 
-void spirv_module_load(SPIRV_module *module, SPIRV_binary *binary) {
+bool spirv_module_load(SPIRV_module *module, SPIRV_binary *binary) {
     assert(module);
     assert(binary);
 
     *module = (SPIRV_module) {
         .spirv_bin = binary
     };
+    MemTag prev_tag = mem_stats_set_tag(MemTagModule);
     
     mem_arena_init(&module->allocator, ARENA_DEFAULT_SIZE, 4);
+    module->allocator.tag = MemTagModule;
     module->text = (SPIRV_text *) mem_arena_allocate(&module->allocator, sizeof(SPIRV_text));
     memset(module->text, 0, sizeof(SPIRV_text));
 
+    /* all ids are smaller than the bound: the id table is usually allocated once. The bound comes from
+       the binary, a small binary can't define more ids than it has words. */
+    size_t word_count = binary->end_op - binary->fst_op;
+
+    if (binary->header.bound_ids > SPIRV_MAX_ID_BOUND) {
+        module->error_msg = "Id bound in the header exceeds the maximum id bound";
+        mem_stats_set_tag(prev_tag);
+        return false;
+    }
+
+    module->id_bound = (uint32_t) MIN(binary->header.bound_ids, word_count + 1);
+    module->ids = calloc(MAX(module->id_bound, 1u), sizeof(SPIRV_id));
+    if (module->ids == NULL) {
+        module->id_bound = 0;
+        module->error_msg = "Out of memory for the id table";
+        mem_stats_set_tag(prev_tag);
+        return false;
+    }
+
+    /* opcodes are mapped back to their index through their offset in the binary */
+    if (word_count > 0) {
+        arr_reserve(module->opcode_index, word_count);
+        memset(module->opcode_index, 0, word_count * sizeof(uint32_t));
+    }
+
+    /* single pass over the binary */
+    bool in_function = false;
+
     for (SPIRV_opcode *op = spirv_bin_opcode_rewind(binary); op != spirv_bin_opcode_end(binary); op = spirv_bin_opcode_next(binary)) {
 	
+	    module->opcode_index[(uint32_t *) op - binary->fst_op] = (uint32_t) arr_len(module->opcode_array);
 	    arr_push(module->opcode_array, op);
 
+        /* the body of a function is skipped, it's decoded when the function is first used */
+        if (in_function) {
+            in_function = op->op.kind != SpvOpFunctionEnd;
+            continue;
+        }
+
         if (op->op.kind == SpvOpExtInstImport) {
             define_extinst_set(module, op->optional[0], (const char *) &op->optional[1]);
         } else if (op->op.kind == SpvOpName) {
@@ -520,59 +738,121 @@ void spirv_module_load(SPIRV_module *module, SPIRV_binary *binary) {
         } else if (op->op.kind == SpvOpVariable) {
             handle_opcode_variable(module, op);
         } else if (op->op.kind == SpvOpFunction) {
-            handle_opcode_function(module, op);
+            handle_opcode_function(module, op, (uint32_t) arr_len(module->opcode_array) - 1);
+            in_function = true;
         } else if (op->op.kind == SpvOpEntryPoint) {
             handle_opcode_entrypoint(module, op);
         } else if (is_opcode_decoration(op)) {
             handle_opcode_decoration(module, op);
         }
+
+        if (module->error_msg != NULL) {
+            break;
+        }
     }
 
     for (EntryPoint *ep = module->entry_points; ep != arr_end(module->entry_points); ++ep) {
         ep->function = spirv_module_function_by_id(module, ep->func_id);
     }
+
+    mem_stats_set_tag(prev_tag);
+    return module->error_msg == NULL;
 }
 
-void spirv_module_free(SPIRV_module *module) {
-    if (module) {
-        for (int iter = map_begin(&module->functions); iter != map_end(&module->functions); iter = map_next(&module->functions, iter)) {
-            SPIRV_function *func = map_val(&module->functions, iter);
-            arr_free(func->func.parameter_ids);
-            arr_free(func->func.variable_ids);
+void spirv_module_function_prepare(SPIRV_module *module, SPIRV_function *func) {
+/* decode the body of the function: labels, local variables, calls and the memory layout of the stack frame.
+   The stack size includes the deepest chain of calls, so the callees are prepared as well. */
+    assert(module);
+    assert(func);
+
+    if (func->prepared) {
+        return;
+    }
+
+    func->prepared = true;
+
+    for (uint32_t idx = func->def_index + 1; idx < arr_len(module->opcode_array); ++idx) {
+        SPIRV_opcode *op = module->opcode_array[idx];
+
+        if (op->op.kind == SpvOpFunctionEnd) {
+            break;
+        } else if (op->op.kind == SpvOpLabel) {
+            define_label(module, op->optional[0], op);
+        } else if (op->op.kind == SpvOpVariable) {
+            handle_opcode_variable(module, op);
         }
-        for (int iter = map_begin(&module->variables_sc); iter != map_end(&module->variables_sc); iter = map_next(&module->variables_sc, iter)) {
-            Variable **var_array = map_val(&module->variables_sc, iter);
-            arr_free(var_array);
+
+        function_add_opcode(func, op);
+    }
+
+    function_layout_frame(module, func);
+
+    for (uint32_t idx = 0; idx < arr_len(func->callee_ids); ++idx) {
+        SPIRV_function *callee = spirv_module_function_by_id(module, func->callee_ids[idx]);
+        if (callee) {
+            spirv_module_function_prepare(module, callee);
         }
-        for (int iter = map_begin(&module->variables); iter != map_end(&module->variables); iter = map_next(&module->variables, iter)) {
-            Variable *var = map_val(&module->variables, iter);
-            arr_free(var->member_access);
-            arr_free(var->member_name);
+    }
+
+    function_stack_size(module, func);
+}
+
+void spirv_module_prepare_all_functions(SPIRV_module *module) {
+    assert(module);
+
+    for (uint32_t idx = 0; idx < arr_len(module->functions); ++idx) {
+        spirv_module_function_prepare(module, module->functions[idx]);
+    }
+}
+
+static void module_free_text(SPIRV_text *text) {
+    arr_free(text->writer.scratch_buf);
+    arr_free(text->writer.spans);
+    alias_map_free(&text->id_aliases);
+    intern_free(&text->alias_names);
+}
+
+void spirv_module_free(SPIRV_module *module) {
+    if (module && module->text) {
+        module_free_text(module->text);
+    }
+
+    if (module && module->image.data) {
+        /* the tables of a cached module are part of its image */
+        mem_arena_free(&module->allocator);
+        file_unmap(&module->image);
+    } else if (module) {
+        for (SPIRV_function **f = module->functions; f != arr_end(module->functions); ++f) {
+            arr_free((*f)->func.parameter_ids);
+            arr_free((*f)->func.variable_ids);
+            arr_free((*f)->callee_ids);
         }
-        for (int iter = map_begin(&module->decorations); iter != map_end(&module->decorations); iter = map_next(&module->decorations, iter)) {
-            SPIRV_opcode **arr = map_val(&module->decorations, iter);
-            arr_free(arr);
+        for (int sc = 0; sc < STORAGE_CLASS_COUNT; ++sc) {
+            arr_free(module->variables_sc[sc]);
         }
-        for (int iter = map_begin(&module->types); iter != map_end(&module->types); iter = map_next(&module->types, iter)) {
-            Type *type = map_val(&module->types, iter);
-            if (type->kind == TypeStructure) {
-                arr_free(type->structure.members);
-            } else if (type->kind == TypeFunction) {
-                arr_free(type->function.parameter_types);
+        for (Variable **var = module->variables; var != arr_end(module->variables); ++var) {
+            arr_free((*var)->member_access);
+            arr_free((*var)->member_name);
+        }
+        for (SPIRV_id *entry = module->ids; entry != module->ids + module->id_bound; ++entry) {
+            arr_free(entry->member_names);
+            arr_free(entry->member_decorations);
+
+            if (entry->kind == IdType && entry->type->kind == TypeStructure) {
+                arr_free(entry->type->structure.members);
+            } else if (entry->kind == IdType && entry->type->kind == TypeFunction) {
+                arr_free(entry->type->function.parameter_types);
             }
         }
 
         mem_arena_free(&module->allocator);
         arr_free(module->opcode_array);
-        map_free(&module->extinst_sets);
-        map_free(&module->names);
-        map_free(&module->decorations);
-        map_free(&module->types);
-        map_free(&module->constants);
-        map_free(&module->variables);
-        map_free(&module->variables_sc);
-        map_free(&module->functions);
-        map_free(&module->labels);
+        arr_free(module->opcode_index);
+        free(module->ids);
+        arr_free(module->extinst_set_ids);
+        arr_free(module->constant_ids);
+        arr_free(module->variables);
+        arr_free(module->functions);
         arr_free(module->entry_points);
     }
 }
@@ -592,15 +872,17 @@ uint32_t spirv_module_index_for_opcode(SPIRV_module *module, struct SPIRV_opcode
 	assert(module);
 	assert(op);
 
-	/* linear search, baby! */
-	uint32_t index = 0; 
-	while (module->opcode_array[index] < op && index < arr_len(module->opcode_array))
-		++index;
+	/* opcodes outside of the module (e.g. the end of the binary) map to the number of opcodes */
+	size_t offset = (uint32_t *) op - module->spirv_bin->fst_op;
+	if ((uint32_t *) op < module->spirv_bin->fst_op || offset >= arr_len(module->opcode_index)) {
+		return (uint32_t) arr_len(module->opcode_array);
+	}
 
-	return index;
+	return module->opcode_index[offset];
 }
 
 SPIRV_opcode *spirv_module_opcode_by_label(SPIRV_module *module, uint32_t label_id) {
     assert(module);
-    return map_int_ptr_get(&module->labels, label_id);
+    SPIRV_id *entry = id_lookup(module, label_id, IdLabel);
+    return (entry) ? entry->label : NULL;
 }
@@ -6,6 +6,7 @@
 #include "hash_map.h"
 #include "types.h"
 #include "allocator.h"
+#include "utils.h"
 
 // required  forward declarations
 struct SPIRV_binary;
@@ -48,6 +49,8 @@ typedef enum StorageClass {
     ClassStorageBuffer,
 } StorageClass;
 
+#define STORAGE_CLASS_COUNT (ClassStorageBuffer + 1)
+
 typedef struct Type {
     uint32_t id;
     TypeKind kind;
@@ -117,6 +120,7 @@ typedef struct Variable {
     };
     StorageClass kind; // spirv: storage class
     VariableAccess access;
+    uint32_t mem_offset;        // offset in global memory, relative to the stackframe for ClassFunction
 
     VariableAccess *member_access;  // dyn_array
     const char **member_name;       // dyn_array
@@ -137,12 +141,58 @@ typedef enum ProgramKind {
     ComputeProgram
 } ProgramKind;
 
+// the body of a function is decoded the first time it's needed (see spirv_module_function_prepare),
+// until then only func.id, func.type, func.name and def_index are valid
 typedef struct SPIRV_function {
     Function func;
+    uint32_t def_index;             // index of OpFunction in the opcode array
+    bool prepared;
+    bool validated;                 // passed spirv_validate_function
     struct SPIRV_opcode *fst_opcode;
     struct SPIRV_opcode *lst_opcode;
+    uint32_t *callee_ids;           // dyn_array
+    uint32_t frame_size;            // memory required for the local variables (in bytes)
+    uint32_t stack_size;            // memory required for the deepest chain of calls starting at this function
 } SPIRV_function;
 
+typedef struct Decorations {
+    uint64_t present;           // bitset of the decorations (SpvDecoration < 64) applied to the id/member
+    uint32_t location;
+    uint32_t builtin;
+    uint32_t offset;
+    uint32_t array_stride;
+    uint32_t binding;
+    uint32_t descriptor_set;
+} Decorations;
+
+#define DECORATION_MAX_BIT 64
+
+typedef enum IdKind {
+    IdNone = 0,
+    IdExtInstSet,
+    IdType,
+    IdConstant,
+    IdVariable,
+    IdFunction,
+    IdLabel
+} IdKind;
+
+typedef struct SPIRV_id {
+    IdKind kind;
+    union {
+        const char *extinst_set;
+        Type *type;
+        Constant *constant;
+        Variable *variable;
+        SPIRV_function *function;
+        struct SPIRV_opcode *label;
+    };
+    const char *name;                       // optional
+    const char **member_names;              // dyn_array
+    Decorations decorations;
+    Decorations *member_decorations;        // dyn_array
+} SPIRV_id;
+
 typedef struct EntryPoint {
     uint32_t func_id;
     SPIRV_function *function;
@@ -155,22 +205,28 @@ typedef struct SPIRV_module {
 
     struct SPIRV_text   *text;
     struct SPIRV_opcode **opcode_array;	// dyn_array
+    uint32_t *opcode_index;         // dyn_array - word offset of an opcode (relative to the first opcode) -> index in opcode_array
+
+    SPIRV_id *ids;                  // indexed by id, sized from the bound in the header (capped by the size of the binary)
+    uint32_t id_bound;
+
+    const char *error_msg;          // NULL if no error, static string otherwise
 
-    HashMap extinst_sets;   // id (int) -> const char *
-    HashMap names;          // id (int) -> const char *
-    HashMap decorations;    // id (int) -> SPIRV_opcode ** (dyn_array)
-    HashMap types;          // id (int) -> Type *
-    HashMap constants;      // id (int) -> Constant *
-    HashMap variables;      // id (int) -> Variable *
-    HashMap variables_sc;   // kind (StorageClass) -> Variable ** (dyn_array)
-    HashMap functions;      // id (int) -> SPIRV_function *
-    HashMap labels;         // id (int) -> SPIRV_opcode *
+    // definitions in the order they appear in the binary
+    uint32_t *extinst_set_ids;      // dyn_array
+    uint32_t *constant_ids;         // dyn_array
+    Variable **variables;           // dyn_array
+    Variable **variables_sc[STORAGE_CLASS_COUNT];   // dyn_array per storage class
+    SPIRV_function **functions;     // dyn_array
 
     EntryPoint *entry_points;       // dyn_array
+    uint32_t globals_size;          // memory required for all non-function variables (in bytes)
+
+    FileMapping image;              // only for modules loaded from the module cache (owns all of the above)
 } SPIRV_module;
 
 // interface functions
-void spirv_module_load(SPIRV_module *module, struct SPIRV_binary *binary);
+bool spirv_module_load(SPIRV_module *module, struct SPIRV_binary *binary);
 void spirv_module_free(SPIRV_module *module);
 
 Type *spirv_module_type_by_id(SPIRV_module *module, uint32_t id);
@@ -187,6 +243,8 @@ bool spirv_module_variable_by_access(
     int32_t *ret_member); 
 
 SPIRV_function *spirv_module_function_by_id(SPIRV_module *module, uint32_t id);
+void spirv_module_function_prepare(SPIRV_module *module, SPIRV_function *func);
+void spirv_module_prepare_all_functions(SPIRV_module *module);
 
 size_t spirv_module_opcode_count(SPIRV_module *module);
 struct SPIRV_opcode *spirv_module_opcode_by_index(SPIRV_module *module, uint32_t index);
@@ -194,6 +252,16 @@ uint32_t spirv_module_index_for_opcode(SPIRV_module *module, struct SPIRV_opcode
 
 struct SPIRV_opcode *spirv_module_opcode_by_label(SPIRV_module *module, uint32_t label_id);
 
+const Decorations *spirv_module_decorations(SPIRV_module *module, uint32_t id, int32_t member);
+
+static inline bool spirv_decorations_has(const Decorations *decorations, uint32_t decoration) {
+    return decoration < DECORATION_MAX_BIT && (decorations->present & (UINT64_C(1) << decoration)) != 0;
+}
+
+static inline uint32_t spirv_variable_size(Variable *var) {
+    return var->array_elements * var->type->base_type->element_size * var->type->base_type->count;
+}
+
 static inline bool spirv_type_is_integer(Type *type) {
     return type->kind == TypeInteger ||
            type->kind == TypeVectorInteger ||
@@ -0,0 +1,458 @@
+// spirv_module_cache.c - Johan Smet - BSD-3-Clause (see LICENSE)
+
+#include "spirv_module_cache.h"
+#include "spirv_module.h"
+#include "spirv_binary.h"
+#include "spirv_text.h"
+#include "hash_map.h"
+#include "dyn_array.h"
+#include "utils.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+    #include <unistd.h>
+    #define CACHE_PROCESS_ID()  ((unsigned long) getpid())
+#else
+    #define CACHE_PROCESS_ID()  0ul
+#endif
+
+#define MODULE_IMAGE_MAGIC      0x4353534d      // 'MSSC'
+#define MODULE_IMAGE_VERSION    5               // bump when the layout of the module tables changes
+#define MODULE_IMAGE_ALIGN      8u
+#define MODULE_IMAGE_EXTENSION  ".ssm"
+
+// relocations are stored as the offset of the pointer in the image, the lowest bit selects the base
+#define RELOC_BASE_IMAGE        0u              // pointer into the image itself
+#define RELOC_BASE_BINARY       1u              // pointer into the SPIR-V binary (opcodes, names)
+
+typedef struct ModuleImageHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pointer_size;
+    uint32_t module_size;           // sizeof(SPIRV_module), a cheap check on the layout
+    uint64_t key;                   // hash of the SPIR-V binary
+    uint64_t binary_size;           // in bytes
+    uint64_t image_size;            // in bytes, including this header
+    uint64_t module_offset;
+    uint64_t reloc_offset;
+    uint64_t reloc_count;
+} ModuleImageHeader;
+
+typedef struct ImageBuilder {
+    int8_t *data;                   // dyn_array
+    uint64_t *relocs;               // dyn_array
+    HashMap objects;                // address of the original object -> offset in the image
+    const uint8_t *bin_start;
+    const uint8_t *bin_end;
+    bool failed;
+} ImageBuilder;
+
+/* helper functions */
+static inline const uint8_t *binary_start(SPIRV_binary *binary) {
+/* the opcodes follow the 5 words of the header */
+    return (const uint8_t *) (binary->fst_op - 5);
+}
+
+static inline const uint8_t *binary_end(SPIRV_binary *binary) {
+    return binary_start(binary) + binary->word_len * sizeof(uint32_t);
+}
+
+static void cache_path(char *path, const char *cache_dir, uint64_t key) {
+    char filename[32];
+    snprintf(filename, sizeof(filename), "%016" PRIx64 MODULE_IMAGE_EXTENSION, key);
+    strcpy(path, cache_dir);
+    path_append(path, filename);
+}
+
+/* image construction */
+static uint64_t image_alloc(ImageBuilder *b, size_t size) {
+    uint64_t offset = ALIGN_UP(arr_len(b->data), MODULE_IMAGE_ALIGN);
+    size_t grow = (offset - arr_len(b->data)) + ALIGN_UP(size, MODULE_IMAGE_ALIGN);
+    size_t old_len = arr_len(b->data);
+
+    if (grow > 0) {
+        arr_reserve(b->data, grow);
+        memset(b->data + old_len, 0, grow);
+    }
+    return offset;
+}
+
+static uint64_t image_write(ImageBuilder *b, const void *src, size_t size) {
+/* copy an object into the image and remember where it went */
+    if (src == NULL) {
+        return 0;
+    }
+
+    uint64_t offset = image_alloc(b, size);
+    memcpy(b->data + offset, src, size);
+    map_int_int_put(&b->objects, (uintptr_t) src, offset);
+    return offset;
+}
+
+static uint64_t image_write_array(ImageBuilder *b, const void *array, size_t elem_size) {
+/* dyn_arrays keep their header so arr_len keeps working on the loaded image */
+    if (array == NULL) {
+        return 0;
+    }
+
+    size_t len = arr_len(array);
+    ArrayHeader hdr = {.len = len, .cap = len};
+
+    uint64_t offset = image_alloc(b, offsetof(ArrayHeader, data) + len * elem_size);
+    memcpy(b->data + offset, &hdr, offsetof(ArrayHeader, data));
+    offset += offsetof(ArrayHeader, data);
+    memcpy(b->data + offset, array, len * elem_size);
+    map_int_int_put(&b->objects, (uintptr_t) array, offset);
+    return offset;
+}
+
+static inline uint64_t image_offset(ImageBuilder *b, const void *src) {
+    assert(map_int_int_has(&b->objects, (uintptr_t) src));
+    return map_int_int_get(&b->objects, (uintptr_t) src);
+}
+
+static void image_fixup(ImageBuilder *b, uint64_t field, const void *ptr) {
+/* replace the pointer stored at field by an offset and record the relocation */
+    uintptr_t value = 0;
+
+    if (ptr == NULL) {
+        value = 0;
+    } else if ((const uint8_t *) ptr >= b->bin_start && (const uint8_t *) ptr <= b->bin_end) {
+        value = (uintptr_t) ((const uint8_t *) ptr - b->bin_start);
+        arr_push(b->relocs, field | RELOC_BASE_BINARY);
+    } else if (map_int_int_has(&b->objects, (uintptr_t) ptr)) {
+        value = (uintptr_t) map_int_int_get(&b->objects, (uintptr_t) ptr);
+        arr_push(b->relocs, field | RELOC_BASE_IMAGE);
+    } else {
+        b->failed = true;
+    }
+
+    memcpy(b->data + field, &value, sizeof(value));
+}
+
+static void image_fixup_array(ImageBuilder *b, void *const *array) {
+/* fixup the elements of a dyn_array of pointers */
+    if (array == NULL) {
+        return;
+    }
+
+    uint64_t offset = image_offset(b, array);
+
+    for (size_t idx = 0; idx < arr_len(array); ++idx) {
+        image_fixup(b, offset + idx * sizeof(void *), array[idx]);
+    }
+}
+
+static void image_collect(ImageBuilder *b, SPIRV_module *module) {
+/* first pass: copy all the tables of the module into the image */
+    image_write(b, module, sizeof(SPIRV_module));
+    image_write(b, module->ids, module->id_bound * sizeof(SPIRV_id));
+    image_write_array(b, module->opcode_array, sizeof(SPIRV_opcode *));
+    image_write_array(b, module->opcode_index, sizeof(uint32_t));
+    image_write_array(b, module->extinst_set_ids, sizeof(uint32_t));
+    image_write_array(b, module->constant_ids, sizeof(uint32_t));
+    image_write_array(b, module->variables, sizeof(Variable *));
+    image_write_array(b, module->functions, sizeof(SPIRV_function *));
+    image_write_array(b, module->entry_points, sizeof(EntryPoint));
+
+    for (int sc = 0; sc < STORAGE_CLASS_COUNT; ++sc) {
+        image_write_array(b, module->variables_sc[sc], sizeof(Variable *));
+    }
+
+    for (SPIRV_id *entry = module->ids; entry != module->ids + module->id_bound; ++entry) {
+        image_write_array(b, entry->member_names, sizeof(const char *));
+        image_write_array(b, entry->member_decorations, sizeof(Decorations));
+
+        if (entry->kind == IdType) {
+            Type *type = entry->type;
+            image_write(b, type, sizeof(Type));
+            if (type->kind == TypeFunction) {
+                image_write_array(b, type->function.parameter_types, sizeof(Type *));
+            } else if (type->kind == TypeStructure) {
+                image_write_array(b, type->structure.members, sizeof(Type *));
+            }
+        } else if (entry->kind == IdConstant) {
+            Constant *constant = entry->constant;
+            image_write(b, constant, sizeof(Constant));
+            if (constant->type->count > 1) {
+                image_write(b, constant->value.as_int_array, constant->type->count * constant->type->element_size);
+            }
+        } else if (entry->kind == IdVariable) {
+            Variable *var = entry->variable;
+            image_write(b, var, sizeof(Variable));
+            image_write_array(b, var->member_access, sizeof(VariableAccess));
+            image_write_array(b, var->member_name, sizeof(const char *));
+        } else if (entry->kind == IdFunction) {
+            SPIRV_function *func = entry->function;
+            image_write(b, func, sizeof(SPIRV_function));
+            image_write_array(b, func->func.parameter_ids, sizeof(uint32_t));
+            image_write_array(b, func->func.variable_ids, sizeof(uint32_t));
+            image_write_array(b, func->callee_ids, sizeof(uint32_t));
+        }
+    }
+}
+
+#define FIXUP(b, base, type, field, ptr)    image_fixup((b), (base) + offsetof(type, field), (ptr))
+
+static void image_fixup_all(ImageBuilder *b, SPIRV_module *module) {
+/* second pass: turn all pointers into offsets now that the location of every object is known */
+    uint64_t mod = image_offset(b, module);
+
+    // the runtime state of the module is recreated when the image is loaded
+    memset(b->data + mod + offsetof(SPIRV_module, spirv_bin), 0, sizeof(module->spirv_bin));
+    memset(b->data + mod + offsetof(SPIRV_module, allocator), 0, sizeof(module->allocator));
+    memset(b->data + mod + offsetof(SPIRV_module, text), 0, sizeof(module->text));
+    memset(b->data + mod + offsetof(SPIRV_module, image), 0, sizeof(module->image));
+
+    FIXUP(b, mod, SPIRV_module, ids, module->ids);
+    FIXUP(b, mod, SPIRV_module, opcode_array, module->opcode_array);
+    FIXUP(b, mod, SPIRV_module, opcode_index, module->opcode_index);
+    FIXUP(b, mod, SPIRV_module, extinst_set_ids, module->extinst_set_ids);
+    FIXUP(b, mod, SPIRV_module, constant_ids, module->constant_ids);
+    FIXUP(b, mod, SPIRV_module, variables, module->variables);
+    FIXUP(b, mod, SPIRV_module, functions, module->functions);
+    FIXUP(b, mod, SPIRV_module, entry_points, module->entry_points);
+
+    for (int sc = 0; sc < STORAGE_CLASS_COUNT; ++sc) {
+        image_fixup(b, mod + offsetof(SPIRV_module, variables_sc) + sc * sizeof(Variable **), module->variables_sc[sc]);
+        image_fixup_array(b, (void *const *) module->variables_sc[sc]);
+    }
+
+    image_fixup_array(b, (void *const *) module->opcode_array);
+    image_fixup_array(b, (void *const *) module->variables);
+    image_fixup_array(b, (void *const *) module->functions);
+
+    if (module->entry_points) {
+        uint64_t eps = image_offset(b, module->entry_points);
+        for (size_t idx = 0; idx < arr_len(module->entry_points); ++idx) {
+            FIXUP(b, eps + idx * sizeof(EntryPoint), EntryPoint, function, module->entry_points[idx].function);
+        }
+    }
+
+    uint64_t ids = image_offset(b, module->ids);
+
+    for (uint32_t id = 0; id < module->id_bound; ++id) {
+        SPIRV_id *entry = &module->ids[id];
+        uint64_t dst = ids + id * sizeof(SPIRV_id);
+
+        FIXUP(b, dst, SPIRV_id, type, entry->type);     // all members of the union are pointers
+        FIXUP(b, dst, SPIRV_id, name, entry->name);
+        FIXUP(b, dst, SPIRV_id, member_names, entry->member_names);
+        FIXUP(b, dst, SPIRV_id, member_decorations, entry->member_decorations);
+        image_fixup_array(b, (void *const *) entry->member_names);
+
+        if (entry->kind == IdType) {
+            Type *type = entry->type;
+            uint64_t obj = image_offset(b, type);
+            FIXUP(b, obj, Type, base_type, type->base_type);
+            if (type->kind == TypeFunction) {
+                FIXUP(b, obj, Type, function.return_type, type->function.return_type);
+                FIXUP(b, obj, Type, function.parameter_types, type->function.parameter_types);
+                image_fixup_array(b, (void *const *) type->function.parameter_types);
+            } else if (type->kind == TypeStructure) {
+                FIXUP(b, obj, Type, structure.members, type->structure.members);
+                image_fixup_array(b, (void *const *) type->structure.members);
+            }
+        } else if (entry->kind == IdConstant) {
+            Constant *constant = entry->constant;
+            uint64_t obj = image_offset(b, constant);
+            FIXUP(b, obj, Constant, type, constant->type);
+            if (constant->type->count > 1) {
+                FIXUP(b, obj, Constant, value.as_int_array, constant->value.as_int_array);
+            }
+        } else if (entry->kind == IdVariable) {
+            Variable *var = entry->variable;
+            uint64_t obj = image_offset(b, var);
+            FIXUP(b, obj, Variable, type, var->type);
+            FIXUP(b, obj, Variable, name, var->name);
+            FIXUP(b, obj, Variable, member_access, var->member_access);
+            FIXUP(b, obj, Variable, member_name, var->member_name);
+            image_fixup_array(b, (void *const *) var->member_name);
+            if (var->initializer_kind == InitializerConstant) {
+                FIXUP(b, obj, Variable, initializer_constant, var->initializer_constant);
+            } else if (var->initializer_kind == InitializerVariable) {
+                FIXUP(b, obj, Variable, initializer_variable, var->initializer_variable);
+            }
+        } else if (entry->kind == IdFunction) {
+            SPIRV_function *func = entry->function;
+            uint64_t obj = image_offset(b, func);
+            FIXUP(b, obj, SPIRV_function, func.type, func->func.type);
+            FIXUP(b, obj, SPIRV_function, func.name, func->func.name);
+            FIXUP(b, obj, SPIRV_function, func.parameter_ids, func->func.parameter_ids);
+            FIXUP(b, obj, SPIRV_function, func.variable_ids, func->func.variable_ids);
+            FIXUP(b, obj, SPIRV_function, fst_opcode, func->fst_opcode);
+            FIXUP(b, obj, SPIRV_function, lst_opcode, func->lst_opcode);
+            FIXUP(b, obj, SPIRV_function, callee_ids, func->callee_ids);
+        }
+    }
+}
+
+#undef FIXUP
+
+/* interface functions */
+uint64_t spirv_module_cache_key(SPIRV_binary *binary) {
+/* 64-bit FNV-1a of the complete binary */
+    assert(binary);
+
+    const uint8_t *data = binary_start(binary);
+    size_t size = binary->word_len * sizeof(uint32_t);
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+    for (size_t idx = 0; idx < size; ++idx) {
+        hash ^= data[idx];
+        hash *= UINT64_C(0x100000001b3);
+    }
+
+    return hash;
+}
+
+bool spirv_module_cache_store(const char *cache_dir, SPIRV_module *module) {
+    assert(cache_dir);
+    assert(module);
+    assert(module->image.data == NULL);
+
+    /* the image can't be extended after loading, store all functions decoded */
+    spirv_module_prepare_all_functions(module);
+
+    ImageBuilder builder = {
+        .bin_start = binary_start(module->spirv_bin),
+        .bin_end = binary_end(module->spirv_bin)
+    };
+
+    ModuleImageHeader header = {
+        .magic = MODULE_IMAGE_MAGIC,
+        .version = MODULE_IMAGE_VERSION,
+        .pointer_size = sizeof(void *),
+        .module_size = sizeof(SPIRV_module),
+        .key = spirv_module_cache_key(module->spirv_bin),
+        .binary_size = module->spirv_bin->word_len * sizeof(uint32_t)
+    };
+
+    image_alloc(&builder, sizeof(ModuleImageHeader));
+    image_collect(&builder, module);
+    image_fixup_all(&builder, module);
+
+    header.module_offset = image_offset(&builder, module);
+    header.reloc_offset = image_alloc(&builder, arr_len(builder.relocs) * sizeof(uint64_t));
+    header.reloc_count = arr_len(builder.relocs);
+    header.image_size = arr_len(builder.data);
+    if (builder.relocs) {
+        memcpy(builder.data + header.reloc_offset, builder.relocs, header.reloc_count * sizeof(uint64_t));
+    }
+    memcpy(builder.data, &header, sizeof(ModuleImageHeader));
+
+    // write to a temporary file first: other processes never see a partial image
+    char path[2048];
+    char tmp_path[2048 + 32];
+    cache_path(path, cache_dir, header.key);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%lu.tmp", path, CACHE_PROCESS_ID());
+
+    bool success = !builder.failed;
+
+    if (success) {
+        FILE *fp = fopen(tmp_path, "wb");
+        success = fp != NULL && fwrite(builder.data, 1, header.image_size, fp) == header.image_size;
+        success = (fp != NULL && fclose(fp) == 0) && success;
+        success = success && rename(tmp_path, path) == 0;
+
+        if (!success) {
+            remove(tmp_path);
+        }
+    }
+
+    arr_free(builder.data);
+    arr_free(builder.relocs);
+    map_free(&builder.objects);
+
+    return success;
+}
+
+bool spirv_module_cache_load(const char *cache_dir, SPIRV_module *module, SPIRV_binary *binary) {
+    assert(cache_dir);
+    assert(module);
+    assert(binary);
+
+    uint64_t key = spirv_module_cache_key(binary);
+
+    char path[2048];
+    cache_path(path, cache_dir, key);
+
+    FileMapping image;
+    if (!file_map(path, true, &image)) {
+        return false;
+    }
+
+    // validate the image before trusting any of the offsets in it
+    ModuleImageHeader *header = image.data;
+    bool valid = image.size >= sizeof(ModuleImageHeader) + sizeof(SPIRV_module) &&
+                 header->magic == MODULE_IMAGE_MAGIC &&
+                 header->version == MODULE_IMAGE_VERSION &&
+                 header->pointer_size == sizeof(void *) &&
+                 header->module_size == sizeof(SPIRV_module) &&
+                 header->key == key &&
+                 header->binary_size == binary->word_len * sizeof(uint32_t) &&
+                 header->image_size == image.size &&
+                 header->module_offset <= image.size - sizeof(SPIRV_module) &&
+                 header->reloc_offset <= image.size &&
+                 header->reloc_count <= (image.size - header->reloc_offset) / sizeof(uint64_t);
+
+    if (!valid) {
+        file_unmap(&image);
+        return false;
+    }
+
+    // turn the offsets back into pointers
+    uint8_t *base = image.data;
+    uintptr_t reloc_bases[2] = {
+        [RELOC_BASE_IMAGE] = (uintptr_t) base,
+        [RELOC_BASE_BINARY] = (uintptr_t) binary_start(binary)
+    };
+    const uint64_t *relocs = (const uint64_t *) (base + header->reloc_offset);
+
+    for (uint64_t idx = 0; idx < header->reloc_count; ++idx) {
+        uint64_t field = relocs[idx] & ~UINT64_C(1);
+        if (field > image.size - sizeof(uintptr_t)) {
+            file_unmap(&image);
+            return false;
+        }
+
+        uintptr_t value;
+        memcpy(&value, base + field, sizeof(value));
+        value += reloc_bases[relocs[idx] & 1];
+        memcpy(base + field, &value, sizeof(value));
+    }
+
+    // the runtime state of the module
+    *module = *(SPIRV_module *) (base + header->module_offset);
+    module->spirv_bin = binary;
+    module->image = image;
+
+    mem_arena_init(&module->allocator, ARENA_DEFAULT_SIZE, 4);
+    module->allocator.tag = MemTagModule;
+    module->text = (SPIRV_text *) mem_arena_allocate(&module->allocator, sizeof(SPIRV_text));
+    memset(module->text, 0, sizeof(SPIRV_text));
+
+    return true;
+}
+
+bool spirv_module_load_cached(const char *cache_dir, SPIRV_module *module, SPIRV_binary *binary) {
+    assert(module);
+    assert(binary);
+
+    if (cache_dir != NULL && spirv_module_cache_load(cache_dir, module, binary)) {
+        return true;
+    }
+
+    if (!spirv_module_load(module, binary)) {
+        return false;
+    }
+
+    if (cache_dir != NULL) {
+        spirv_module_cache_store(cache_dir, module);
+    }
+
+    return true;
+}
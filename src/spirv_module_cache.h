@@ -0,0 +1,28 @@
+// spirv_module_cache.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Persistent cache of loaded modules.
+//  - a module is stored as a single image: the tables of the module with all pointers replaced by offsets
+//    and a relocation table to turn them back into pointers
+//  - images are keyed on a hash of the SPIR-V binary, the binary itself isn't part of the image
+//  - loading an image maps the file and patches the relocations, the binary isn't parsed again
+//  - an image is only valid for the build of the simulator that created it (pointer size, layout version)
+
+#ifndef JS_SHADER_SIM_SPIRV_MODULE_CACHE_H
+#define JS_SHADER_SIM_SPIRV_MODULE_CACHE_H
+
+#include "types.h"
+
+// required forward declarations
+struct SPIRV_binary;
+struct SPIRV_module;
+
+// interface functions
+uint64_t spirv_module_cache_key(struct SPIRV_binary *binary);
+
+bool spirv_module_cache_store(const char *cache_dir, struct SPIRV_module *module);
+bool spirv_module_cache_load(const char *cache_dir, struct SPIRV_module *module, struct SPIRV_binary *binary);
+
+// load the module from the cache, or load it from the binary and add it to the cache
+bool spirv_module_load_cached(const char *cache_dir, struct SPIRV_module *module, struct SPIRV_binary *binary);
+
+#endif // JS_SHADER_SIM_SPIRV_MODULE_CACHE_H
@@ -3,6 +3,7 @@
 #include "spirv/spirv.h"
 #include "spirv/GLSL.std.450.h"
 #include "dyn_array.h"
+#include "fast_math.h"
 
 #include <assert.h>
 #include <math.h>
@@ -28,8 +29,8 @@ EXTINST_RES_1OP(GLSLstd450Round) {
 /* Result is the value equal to the nearest whole number to x.
    The fraction 0.5 will round in a direction chosen by the implementation, 
    presumably the direction that is fastest */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = roundf(op_reg->vec[i]);
@@ -40,8 +41,8 @@ EXTINST_RES_1OP(GLSLstd450Round) {
 EXTINST_RES_1OP(GLSLstd450RoundEven) {
 /* Result is the value equal to the nearest whole number to x. 
    A fractional part of 0.5 will round toward the nearest even whole number. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         int integer = (int) op_reg->vec[i];
@@ -64,8 +65,8 @@ EXTINST_RES_1OP(GLSLstd450RoundEven) {
 EXTINST_RES_1OP(GLSLstd450Trunc) {
 /* Result is the value equal to the nearest whole number to x whose absolute value 
    is not larger than the absolute value of x. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = truncf(op_reg->vec[i]);
@@ -75,8 +76,8 @@ EXTINST_RES_1OP(GLSLstd450Trunc) {
 
 EXTINST_RES_1OP(GLSLstd450FAbs) {
 /* Result is x if x ≥ 0; otherwise result is -x. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = fabsf(op_reg->vec[i]);
@@ -86,8 +87,8 @@ EXTINST_RES_1OP(GLSLstd450FAbs) {
 
 EXTINST_RES_1OP(GLSLstd450SAbs) {
 /* Result is x if x ≥ 0; otherwise result is -x, where x is interpreted as a signed integer. */
-    assert(spirv_type_is_signed_integer(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_signed_integer(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->svec[i] = abs(op_reg->svec[i]);
@@ -97,8 +98,8 @@ EXTINST_RES_1OP(GLSLstd450SAbs) {
 
 EXTINST_RES_1OP(GLSLstd450FSign) {
 /* Result is 1.0 if x > 0, 0.0 if x = 0, or -1.0 if x < 0. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = (op_reg->vec[i] > 0.0f) ? 1.0f : 
@@ -109,8 +110,8 @@ EXTINST_RES_1OP(GLSLstd450FSign) {
 
 EXTINST_RES_1OP(GLSLstd450SSign) {
 /* Result is 1 if x > 0, 0 if x = 0, or -1 if x < 0, where x is interpreted as a signed integer. */
-    assert(spirv_type_is_signed_integer(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_signed_integer(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->svec[i] = (op_reg->svec[i] > 0) ? 1 : 
@@ -121,8 +122,8 @@ EXTINST_RES_1OP(GLSLstd450SSign) {
 
 EXTINST_RES_1OP(GLSLstd450Floor) {
 /* Result is the value equal to the nearest whole number that is less than or equal to x. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = floorf(op_reg->vec[i]);
@@ -132,8 +133,8 @@ EXTINST_RES_1OP(GLSLstd450Floor) {
 
 EXTINST_RES_1OP(GLSLstd450Ceil) {
 /* Result is the value equal to the nearest whole number that is greater than or equal to x. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = ceilf(op_reg->vec[i]);
@@ -143,8 +144,8 @@ EXTINST_RES_1OP(GLSLstd450Ceil) {
 
 EXTINST_RES_1OP(GLSLstd450Fract) {
 /* Result is x - floor x. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = op_reg->vec[i] - floorf(op_reg->vec[i]);
@@ -158,8 +159,8 @@ EXTINST_RES_1OP(GLSLstd450Fract) {
 
 EXTINST_RES_1OP(GLSLstd450Radians) {
 /* Converts degrees to radians */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = (op_reg->vec[i] * PI_F) / 180.0f;
@@ -169,8 +170,8 @@ EXTINST_RES_1OP(GLSLstd450Radians) {
 
 EXTINST_RES_1OP(GLSLstd450Degrees) {
 /* Converts radians to degrees */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = (op_reg->vec[i] * 180.0f) /  PI_F;
@@ -180,74 +181,98 @@ EXTINST_RES_1OP(GLSLstd450Degrees) {
 
 EXTINST_RES_1OP(GLSLstd450Sin) {
 /* The standard trigonometric sine of x radians. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < op_reg->type->count; ++i) {
-        res_reg->vec[i] = sinf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_sin(res_reg->vec, op_reg->vec, op_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < op_reg->type->count; ++i) {
+            res_reg->vec[i] = sinf(op_reg->vec[i]);
+        }
     }
 
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Cos) {
 /* The standard trigonometric cosine of x radians. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < op_reg->type->count; ++i) {
-        res_reg->vec[i] = cosf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_cos(res_reg->vec, op_reg->vec, op_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < op_reg->type->count; ++i) {
+            res_reg->vec[i] = cosf(op_reg->vec[i]);
+        }
     }
     
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Tan) {
 /* The standard trigonometric tangent of x radians. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < op_reg->type->count; ++i) {
-        res_reg->vec[i] = tanf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_tan(res_reg->vec, op_reg->vec, op_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < op_reg->type->count; ++i) {
+            res_reg->vec[i] = tanf(op_reg->vec[i]);
+        }
     }
     
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Asin) {
 /* Arc sine. Result is an angle, in radians, whose sine is x. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < op_reg->type->count; ++i) {
-        res_reg->vec[i] = asinf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_asin(res_reg->vec, op_reg->vec, op_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < op_reg->type->count; ++i) {
+            res_reg->vec[i] = asinf(op_reg->vec[i]);
+        }
     }
     
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Acos) {
 /* Arc cosine. Result is an angle, in radians, whose cosine is x.     */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < op_reg->type->count; ++i) {
-        res_reg->vec[i] = acosf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_acos(res_reg->vec, op_reg->vec, op_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < op_reg->type->count; ++i) {
+            res_reg->vec[i] = acosf(op_reg->vec[i]);
+        }
     }
     
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Atan) {
 /* Arc tangent. Result is an angle, in radians, whose tangent is y_over_x. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < op_reg->type->count; ++i) {
-        res_reg->vec[i] = atanf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_atan(res_reg->vec, op_reg->vec, op_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < op_reg->type->count; ++i) {
+            res_reg->vec[i] = atanf(op_reg->vec[i]);
+        }
     }
     
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Sinh) {
 /* Hyperbolic sine of x radians. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = sinhf(op_reg->vec[i]);
@@ -257,8 +282,8 @@ EXTINST_RES_1OP(GLSLstd450Sinh) {
 
 EXTINST_RES_1OP(GLSLstd450Cosh) {
 /* Hyperbolic cosine of x radians. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = coshf(op_reg->vec[i]);
@@ -268,8 +293,8 @@ EXTINST_RES_1OP(GLSLstd450Cosh) {
 
 EXTINST_RES_1OP(GLSLstd450Tanh) {
 /* Hyperbolic tangent of x radians. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = tanhf(op_reg->vec[i]);
@@ -279,8 +304,8 @@ EXTINST_RES_1OP(GLSLstd450Tanh) {
 
 EXTINST_RES_1OP(GLSLstd450Asinh) {
 /* Arc hyperbolic sine; result is the inverse of sinh. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = asinhf(op_reg->vec[i]);
@@ -290,8 +315,8 @@ EXTINST_RES_1OP(GLSLstd450Asinh) {
 
 EXTINST_RES_1OP(GLSLstd450Acosh) {
 /* Arc hyperbolic cosine; Result is the non-negative inverse of cosh. */    
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = acoshf(op_reg->vec[i]);
@@ -301,8 +326,8 @@ EXTINST_RES_1OP(GLSLstd450Acosh) {
 
 EXTINST_RES_1OP(GLSLstd450Atanh) {
 /* Arc hyperbolic tangent; result is the inverse of tanh. Result is undefined if abs x ≥ 1. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < op_reg->type->count; ++i) {
         res_reg->vec[i] = atanhf(op_reg->vec[i]);
@@ -312,12 +337,16 @@ EXTINST_RES_1OP(GLSLstd450Atanh) {
 
 EXTINST_RES_2OP(GLSLstd450Atan2) {
 /* Arc tangent. Result is an angle, in radians, whose tangent is y / x. */
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op2_reg->type == op1_reg->type);
-    assert(res_reg->type == op1_reg->type);
-
-    for (uint32_t i = 0; i < res_reg->type->count; ++i) {
-        res_reg->vec[i] = atan2f(op1_reg->vec[i], op2_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op1_reg->type));
+    EXTINST_ASSERT(op2_reg->type == op1_reg->type);
+    EXTINST_ASSERT(res_reg->type == op1_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_atan2(res_reg->vec, op1_reg->vec, op2_reg->vec, res_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < res_reg->type->count; ++i) {
+            res_reg->vec[i] = atan2f(op1_reg->vec[i], op2_reg->vec[i]);
+        }
     }
 
 } EXTINST_END
@@ -328,9 +357,9 @@ EXTINST_RES_2OP(GLSLstd450Atan2) {
 
 EXTINST_RES_2OP(GLSLstd450Pow) {
 /* Result is x raised to the y power */
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op2_reg->type == op1_reg->type);
-    assert(res_reg->type == op1_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op1_reg->type));
+    EXTINST_ASSERT(op2_reg->type == op1_reg->type);
+    EXTINST_ASSERT(res_reg->type == op1_reg->type);
 
     for (uint32_t i = 0; i < res_reg->type->count; ++i) {
         res_reg->vec[i] = powf(op1_reg->vec[i], op2_reg->vec[i]);
@@ -340,41 +369,53 @@ EXTINST_RES_2OP(GLSLstd450Pow) {
 
 EXTINST_RES_1OP(GLSLstd450Exp) {
 /* Result is the natural exponentiation of x */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < res_reg->type->count; ++i) {
-        res_reg->vec[i] = expf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_exp(res_reg->vec, op_reg->vec, res_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < res_reg->type->count; ++i) {
+            res_reg->vec[i] = expf(op_reg->vec[i]);
+        }
     }
 
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Log) {
 /* Result is the natural logarithm of x */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < res_reg->type->count; ++i) {
-        res_reg->vec[i] = logf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_log(res_reg->vec, op_reg->vec, res_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < res_reg->type->count; ++i) {
+            res_reg->vec[i] = logf(op_reg->vec[i]);
+        }
     }
     
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Exp2) {
 /* Result is 2 raised to the x power */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < res_reg->type->count; ++i) {
-        res_reg->vec[i] = exp2f(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_exp2(res_reg->vec, op_reg->vec, res_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < res_reg->type->count; ++i) {
+            res_reg->vec[i] = exp2f(op_reg->vec[i]);
+        }
     }
     
 } EXTINST_END
 
 EXTINST_RES_1OP(GLSLstd450Log2) {
 /* Result is the base-2 logarithm of x */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < res_reg->type->count; ++i) {
         res_reg->vec[i] = log2f(op_reg->vec[i]);
@@ -384,8 +425,8 @@ EXTINST_RES_1OP(GLSLstd450Log2) {
 
 EXTINST_RES_1OP(GLSLstd450Sqrt) {
 /* Result is the square root of x */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
 
     for (uint32_t i = 0; i < res_reg->type->count; ++i) {
         res_reg->vec[i] = sqrtf(op_reg->vec[i]);
@@ -395,11 +436,15 @@ EXTINST_RES_1OP(GLSLstd450Sqrt) {
 
 EXTINST_RES_1OP(GLSLstd450InverseSqrt) {
 /* Result is the reciprocal of sqrt x */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(res_reg->type == op_reg->type);
-
-    for (uint32_t i = 0; i < res_reg->type->count; ++i) {
-        res_reg->vec[i] = 1.0f / sqrtf(op_reg->vec[i]);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+
+    if (sim->precision == SimPrecisionFast) {
+        fast_math_inverse_sqrt(res_reg->vec, op_reg->vec, res_reg->type->count);
+    } else {
+        for (uint32_t i = 0; i < res_reg->type->count; ++i) {
+            res_reg->vec[i] = 1.0f / sqrtf(op_reg->vec[i]);
+        }
     }
     
 } EXTINST_END
@@ -410,8 +455,8 @@ EXTINST_RES_1OP(GLSLstd450InverseSqrt) {
 
 EXTINST_RES_1OP(GLSLstd450Length) {
 /* Result is the length of vector */ 
-    assert(spirv_type_is_float(op_reg->type));
-    assert(op_reg->type->base_type == res_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(op_reg->type->base_type == res_reg->type);
 
     res_reg->vec[0] = vec_length(op_reg->vec, op_reg->type->count);
 
@@ -419,9 +464,9 @@ EXTINST_RES_1OP(GLSLstd450Length) {
 
 EXTINST_RES_2OP(GLSLstd450Distance) {
 /* Result is the distance between p0 and p1, i.e., length(p0 - p1). */
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
-    assert(op1_reg->type->base_type == res_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op1_reg->type));
+    EXTINST_ASSERT(op1_reg->type == op2_reg->type);
+    EXTINST_ASSERT(op1_reg->type->base_type == res_reg->type);
 
     float dist2 = 0.0f;
 
@@ -436,8 +481,8 @@ EXTINST_RES_2OP(GLSLstd450Distance) {
 
 EXTINST_RES_1OP(GLSLstd450Normalize) {
 /* Result is the vector in the same direction as x but with a length of 1. */
-    assert(res_reg->type == op_reg->type);
-    assert(spirv_type_is_float(op_reg->type));
+    EXTINST_ASSERT(res_reg->type == op_reg->type);
+    EXTINST_ASSERT(spirv_type_is_float(op_reg->type));
 
     float len = vec_length(op_reg->vec, op_reg->type->count);
 
@@ -451,7 +496,7 @@ EXTINST_RES_1OP(GLSLstd450Normalize) {
 void spirv_sim_extension_GLSL_std_450(SPIRV_simulator *sim, SPIRV_opcode *op) {
     assert(sim);
     assert(op);
-    assert(op->op.kind == SpvOpExtInst);
+    EXTINST_ASSERT(op->op.kind == SpvOpExtInst);
 
 #define OP(kind)                             \
     case kind:                               \
@@ -3,21 +3,15 @@
 #include "spirv_simulator.h"
 #include "spirv_binary.h"
 #include "spirv_sim_ext.h"
+#include "guarded_memory.h"
+#include "spirv_validate.h"
 #include "spirv/spirv_names.h"
 #include "dyn_array.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <math.h>
-
-static SimPointer *new_sim_pointer(SPIRV_simulator *sim, Type *type, uint32_t pointer) {
-    SimPointer *result = (SimPointer *) mem_arena_allocate(&sim->current_frame->memory, sizeof(SimPointer));
-    *result = (SimPointer){
-        .type = type,
-        .pointer = pointer
-    };
-    return result;
-}
+#include <inttypes.h>
 
 static inline SimRegister *spirv_sim_assign_register(SPIRV_simulator *sim, uint32_t id, Type *type) {
     assert(sim);
@@ -27,7 +21,8 @@ static inline SimRegister *spirv_sim_assign_register(SPIRV_simulator *sim, uint3
     reg->vec = mem_arena_allocate(&sim->current_frame->memory, type->element_size * type->count);
     reg->id = id;
     reg->type = type;
-    map_int_ptr_put(&sim->current_frame->regs, id, reg);
+    reg->alias = -1;
+    reg_map_put(&sim->current_frame->regs, id, reg);
 
     return reg;
 }
@@ -43,8 +38,74 @@ static inline SimRegister *spirv_sim_clone_register(SPIRV_simulator *sim, SPIRV_
     memcpy(reg->vec, src->vec, src->type->element_size * src->type->count);
     reg->id = id;
     reg->type = src->type;
+    reg->alias = -1;
+
+    reg_map_put(&frame->regs, id, reg);
+    return reg;
+}
+
+/* aliasing registers: the register points directly into simulated memory instead of keeping a copy.
+   Registers are never modified after they're created, so the data only has to be copied (materialized)
+   when the aliased memory is written to. */
+
+static inline void alias_remove(SPIRV_stackframe *frame, SimRegister *reg) {
+    SimRegister *last = arr_pop(frame->aliases);
+    if (last != reg) {
+        frame->aliases[reg->alias] = last;
+        last->alias = reg->alias;
+    }
+    reg->alias = -1;
+}
+
+static void alias_materialize(SPIRV_stackframe *frame, SimRegister *reg) {
+    size_t size = reg->type->element_size * reg->type->count;
+    uint8_t *data = mem_arena_allocate(&frame->memory, size);
+    memcpy(data, reg->raw, size);
+    reg->raw = data;
+    alias_remove(frame, reg);
+}
+
+static void alias_materialize_frame_range(SPIRV_stackframe *frame, uint64_t start, uint64_t end) {
+    /* iterate backwards: removing an alias moves the last entry into its slot */
+    for (int32_t idx = (int32_t) arr_len(frame->aliases) - 1; idx >= 0; --idx) {
+        SimRegister *reg = frame->aliases[idx];
+        uint64_t reg_start = reg->alias_ptr;
+        uint64_t reg_end = reg_start + reg->type->element_size * reg->type->count;
+
+        if (reg_start < end && start < reg_end) {
+            alias_materialize(frame, reg);
+        }
+    }
+}
+
+static void alias_materialize_range(SPIRV_simulator *sim, uint64_t pointer, uint64_t size) {
+    alias_materialize_frame_range(&sim->global_frame, pointer, pointer + size);
+    for (SPIRV_stackframe *frame = sim->func_frames; frame != arr_end(sim->func_frames); ++frame) {
+        alias_materialize_frame_range(frame, pointer, pointer + size);
+    }
+}
+
+static inline SimRegister *spirv_sim_alias_register(SPIRV_simulator *sim, uint32_t id, Type *type, uint64_t pointer) {
+    assert(sim);
+    assert(sim->current_frame);
+
+    SPIRV_stackframe *frame = sim->current_frame;
+
+    /* stop tracking the register of a previous execution of the same instruction (e.g. in a loop) */
+    SimRegister *prev = reg_map_get(&frame->regs, id);
+    if (prev != NULL && prev->alias >= 0) {
+        alias_remove(frame, prev);
+    }
+
+    SimRegister *reg = mem_arena_allocate(&frame->memory, sizeof(SimRegister));
+    reg->raw = spirv_sim_memory_ptr(sim, pointer);
+    reg->id = id;
+    reg->type = type;
+    reg->alias = (int32_t) arr_len(frame->aliases);
+    reg->alias_ptr = pointer;
+    arr_push(frame->aliases, reg);
+    reg_map_put(&frame->regs, id, reg);
 
-    map_int_ptr_put(&frame->regs, id, reg);
     return reg;
 }
 
@@ -52,15 +113,23 @@ static inline uint64_t var_data_key(StorageClass storage_class, VariableAccess *
    return (uint64_t) storage_class << 48 | (uint64_t) access->kind << 32 | (uint32_t) access->index;
 }
 
-static void spirv_add_interface_pointers(SPIRV_simulator *sim, Variable *var_desc, uint32_t pointer) {
+static void spirv_add_interface(SPIRV_simulator *sim, Variable *var, int32_t member, VariableAccess *access, Type *type, uint64_t pointer) {
+    arr_push(sim->interfaces, ((SimInterface) {
+        .ptr = {.type = type, .pointer = pointer},
+        .size = type->element_size * type->count,
+        .var = var,
+        .member = member
+    }));
+
+    SimInterfaceHandle handle = arr_len(sim->interfaces);
+    map_int_int_put(&sim->intf_pointers, var_data_key(var->kind, access), handle);
+}
+
+static void spirv_add_interface_pointers(SPIRV_simulator *sim, Variable *var_desc, uint64_t pointer) {
 
     // interface pointer to the entire type
     if (var_desc->access.kind != VarAccessNone) {
-        map_int_ptr_put(
-            &sim->intf_pointers,
-            var_data_key(var_desc->kind, &var_desc->access),
-            new_sim_pointer(sim, var_desc->type->base_type, pointer)
-        );
+        spirv_add_interface(sim, var_desc, -1, &var_desc->access, var_desc->type->base_type, pointer);
     }
     
     // interface pointer to members
@@ -78,10 +147,7 @@ static void spirv_add_interface_pointers(SPIRV_simulator *sim, Variable *var_des
             Type *member_type = aggregate_type->structure.members[member]; 
 
             if (var_desc->member_access[member].kind != VarAccessNone) {
-                map_int_ptr_put(
-                    &sim->intf_pointers,
-                    var_data_key(var_desc->kind, &var_desc->member_access[member]),
-                    new_sim_pointer(sim, member_type, pointer + offset));
+                spirv_add_interface(sim, var_desc, (int32_t) member, &var_desc->member_access[member], member_type, pointer + offset);
             }
 
             offset += member_type->element_size * member_type->count;
@@ -91,36 +157,49 @@ static void spirv_add_interface_pointers(SPIRV_simulator *sim, Variable *var_des
 
 static void stackframe_init(SPIRV_stackframe *frame) {
     memset(frame, 0, sizeof(SPIRV_stackframe));
-    mem_arena_init(&frame->memory, 256 * 16, ARENA_DEFAULT_ALIGN);
+    mem_arena_init(&frame->memory, 256 * 16, ARENA_SIMD_ALIGN);
+    frame->memory.tag = MemTagFrame;
 }
 
 static SPIRV_stackframe *stackframe_new(SPIRV_simulator *sim, SPIRV_function *func) {
     arr_reserve(sim->func_frames, 1);
     sim->current_frame = sim->func_frames + (arr_len(sim->func_frames) - 2);
     SPIRV_stackframe *new_frame = sim->func_frames + (arr_len(sim->func_frames) - 1);
-    stackframe_init(new_frame);
+
+    /* the register map, alias list and arena of a previous frame are reused, they keep their memory */
+    if (arr_len(sim->free_frames) > 0) {
+        *new_frame = arr_pop(sim->free_frames);
+    } else {
+        stackframe_init(new_frame);
+    }
+
     new_frame->func = func;
     return new_frame;
 }
 
 static void stackframe_free(SPIRV_stackframe *frame) {
-    map_free(&frame->regs);
+    reg_map_free(&frame->regs);
+    arr_free(frame->aliases);
     mem_arena_free(&frame->memory);
 }
 
-static uint32_t allocate_variable(SPIRV_simulator *sim, Variable *var) {
+static void stackframe_release(SPIRV_simulator *sim, SPIRV_stackframe *frame) {
+/* keep the frame of a function that returned around for the next call */
+    reg_map_clear(&frame->regs);
+    arr_clear(frame->aliases);
+    mem_arena_reset(&frame->memory);
+    arr_push(sim->free_frames, *frame);
+}
 
-    /* allocate memory */
-    size_t total_size = var->array_elements * var->type->base_type->element_size * var->type->base_type->count;
-    size_t alloc_size = ALIGN_UP(total_size, 8u);
+static uint64_t allocate_variable(SPIRV_simulator *sim, Variable *var, uint32_t base) {
 
-    arr_reserve(sim->memory, alloc_size);
-    uint32_t mem_ptr = sim->memory_free_start;
-    sim->memory_free_start += alloc_size;
+    /* the module determined the location of the variable */
+    uint64_t mem_ptr = SIM_POINTER(SIM_SEGMENT_MEMORY, base + var->mem_offset);
+    assert(mem_ptr + spirv_variable_size(var) <= sim->memory_size);
         
     /* store pointer in a register */
     SimRegister *reg = spirv_sim_assign_register(sim, var->id, var->type);
-    reg->uvec[0] = mem_ptr;
+    reg->addr[0] = mem_ptr;
 
     return mem_ptr;
 }
@@ -135,6 +214,10 @@ static void setup_function_call(SPIRV_simulator *sim, SPIRV_function *func, uint
     new_frame->return_id   = result_id;
     new_frame->heap_start  = sim->memory_free_start;
 
+    /* reserve stack space for the local variables */
+    sim->memory_free_start += func->frame_size;
+    assert(sim->memory_free_start <= sim->memory_size);
+
     /* push parameters */
     for (uint32_t idx = 0; idx < arr_len(func->func.parameter_ids); ++idx) {
         SimRegister *arg_reg = spirv_sim_register_by_id(sim, param_ids[idx]);
@@ -147,16 +230,16 @@ static void setup_function_call(SPIRV_simulator *sim, SPIRV_function *func, uint
     /* allocate local variables */
     for (uint32_t idx = 0; idx < arr_len(func->func.variable_ids); ++idx) {
         Variable *var = spirv_module_variable_by_id(sim->module, func->func.variable_ids[idx]);
-        allocate_variable(sim, var);
+        allocate_variable(sim, var, new_frame->heap_start);
     }
 }
 
-static void variable_member_pointer(SimPointer *ptr, int32_t field_offset) {
+static void variable_member_pointer(SimPointer *ptr, uint32_t field_offset) {
     assert (ptr);
 
     switch (ptr->type->kind) {
         case TypeStructure:
-            for (int32_t i = 0; i < field_offset; ++i) {
+            for (uint32_t i = 0; i < field_offset; ++i) {
                 ptr->pointer += ptr->type->structure.members[i]->element_size * ptr->type->structure.members[i]->count;
             }
             ptr->type = ptr->type->structure.members[field_offset];
@@ -167,7 +250,7 @@ static void variable_member_pointer(SimPointer *ptr, int32_t field_offset) {
         case TypeVectorInteger:
         case TypeMatrixFloat:
         case TypeMatrixInteger:
-            ptr->pointer += ptr->type->element_size * field_offset;
+            ptr->pointer += (uint64_t) ptr->type->element_size * field_offset;
             ptr->type = ptr->type->base_type;
             break;
                 
@@ -184,7 +267,7 @@ static uint32_t aggregate_indices_offset(Type *type, uint32_t num_indices, uint3
         variable_member_pointer(&ptr, indices[idx]);
     }
     
-    return ptr.pointer;
+    return (uint32_t) ptr.pointer;
 }
 
 
@@ -196,11 +279,12 @@ void spirv_sim_init(SPIRV_simulator *sim, SPIRV_module *module, uint32_t entrypo
     *sim = (SPIRV_simulator) {
         .module = module
     };
+    MemTag prev_tag = mem_stats_set_tag(MemTagSimulator);
 
     /* load imported extension instructions */
-    for (int iter = map_begin(&module->extinst_sets); iter != map_end(&module->extinst_sets); iter = map_next(&module->extinst_sets, iter)) {
-        uint32_t id = map_key_int(&module->extinst_sets, iter);
-        const char *ext = map_val_str(&module->extinst_sets, iter);
+    for (uint32_t *id_ptr = module->extinst_set_ids; id_ptr != arr_end(module->extinst_set_ids); ++id_ptr) {
+        uint32_t id = *id_ptr;
+        const char *ext = module->ids[id].extinst_set;
 
         if (!strcmp(ext, "GLSL.std.450")) {
             map_int_ptr_put(&sim->extinst_funcs, id, &spirv_sim_extension_GLSL_std_450);
@@ -209,14 +293,29 @@ void spirv_sim_init(SPIRV_simulator *sim, SPIRV_module *module, uint32_t entrypo
         }
     }
 
+    /* decode the functions reachable from the entry point */
+    sim->entry_point = &sim->module->entry_points[entrypoint];
+    spirv_module_function_prepare(module, sim->entry_point->function);
+
+    /* all memory is allocated up front: the global variables followed by the stack */
+    sim->memory_size = module->globals_size + sim->entry_point->function->stack_size;
+    assert(sim->memory_size <= SIM_OFFSET_MASK);
+    sim->memory = calloc(MAX(sim->memory_size, 1u), 1);
+    mem_stats_track_alloc(MemTagSimulator, sim->memory_size);
+    sim->memory_free_start = module->globals_size;
+
+    /* the first segment of the address space is the simulator's own memory */
+    arr_push(sim->segments, ((SimSegment) {sim->memory, sim->memory_size}));
+
     /* setup stackframe for globals */
     stackframe_init(&sim->global_frame);
+    reg_map_reserve(&sim->global_frame.regs, arr_len(module->constant_ids) + arr_len(module->variables));
     sim->current_frame = &sim->global_frame;
 
     /* setup access to constants */
-    for (int iter = map_begin(&module->constants); iter != map_end(&module->constants); iter = map_next(&module->constants, iter)) {
-        uint32_t id = (uint32_t) map_key_int(&module->constants, iter);
-        Constant *constant = map_val(&module->constants, iter);
+    for (uint32_t *id_ptr = module->constant_ids; id_ptr != arr_end(module->constant_ids); ++id_ptr) {
+        uint32_t id = *id_ptr;
+        Constant *constant = module->ids[id].constant;
         
         SimRegister *reg = spirv_sim_assign_register(sim, id, constant->type);
         if (constant->type->count == 1) {
@@ -227,24 +326,23 @@ void spirv_sim_init(SPIRV_simulator *sim, SPIRV_module *module, uint32_t entrypo
     }
     
     /* allocate memory for global / pipeline variables */
-    for (int iter = map_begin(&module->variables); iter != map_end(&module->variables); iter = map_next(&module->variables, iter)) {
-        uint32_t id = (int32_t) map_key_int(&module->variables, iter);
-        Variable *var = map_val(&module->variables, iter);
+    for (Variable **var_ptr = module->variables; var_ptr != arr_end(module->variables); ++var_ptr) {
+        Variable *var = *var_ptr;
 
         if (var->kind == ClassFunction) {
             continue;
         }
         
-        /* allocate memory */
-        uint32_t mem_ptr = allocate_variable(sim, var);
+        uint64_t mem_ptr = allocate_variable(sim, var, 0);
         spirv_add_interface_pointers(sim, var, mem_ptr);
     }
 
     /* setup entrypoint */
-    sim->entry_point = &sim->module->entry_points[entrypoint];
     SPIRV_function *func = sim->entry_point->function;
     setup_function_call(sim, sim->entry_point->function, 0, NULL, NULL);
     spirv_bin_opcode_jump_to(sim->module->spirv_bin, func->fst_opcode);
+
+    mem_stats_set_tag(prev_tag);
 }
 
 void spirv_sim_shutdown(SPIRV_simulator *sim) {
@@ -253,10 +351,17 @@ void spirv_sim_shutdown(SPIRV_simulator *sim) {
     /* extensions */
     map_free(&sim->extinst_funcs);
 
-    /* heap */
-    arr_free(sim->memory);
+    /* memory */
+    if (sim->guard_pages) {
+        guarded_memory_free(sim->memory, sim->memory_size);
+    } else {
+        free(sim->memory);
+    }
+    mem_stats_track_free(MemTagSimulator, sim->memory_size);
+    arr_free(sim->segments);
 
     /* interface pointers */
+    arr_free(sim->interfaces);
     map_free(&sim->intf_pointers);
 
     /* stackframes */
@@ -265,11 +370,147 @@ void spirv_sim_shutdown(SPIRV_simulator *sim) {
         stackframe_free(frame);
     }
     arr_free(sim->func_frames);
+    for (SPIRV_stackframe *frame = sim->free_frames; frame != arr_end(sim->free_frames); ++frame) {
+        stackframe_free(frame);
+    }
+    arr_free(sim->free_frames);
 
     /* error message */
     arr_free(sim->error_msg);
 }
 
+void spirv_sim_memory_write(SPIRV_simulator *sim, uint64_t pointer, const void *data, size_t data_size) {
+    assert(sim);
+    assert(data);
+
+    alias_materialize_range(sim, pointer, data_size);
+    memcpy(spirv_sim_memory_ptr(sim, pointer), data, data_size);
+}
+
+bool spirv_sim_use_guard_pages(SPIRV_simulator *sim) {
+/* move the memory of the simulator to a block that is surrounded by guard pages.
+   Out of bounds accesses past the end of the memory are reported as errors, without checking each access.
+   An underflow is only caught when it reaches back past the unused start of the first page. Buffers bound to variables are owned by the caller and aren't guarded. */
+    assert(sim);
+
+    if (sim->guard_pages) {
+        return true;
+    }
+
+    if (!guarded_memory_supported()) {
+        return false;
+    }
+
+    uint8_t *memory = guarded_memory_alloc(sim->memory_size);
+    if (memory == NULL) {
+        return false;
+    }
+
+    alias_materialize_range(sim, SIM_POINTER(SIM_SEGMENT_MEMORY, 0), sim->memory_size);
+    memcpy(memory, sim->memory, sim->memory_size);
+    free(sim->memory);
+
+    sim->memory = memory;
+    sim->segments[SIM_SEGMENT_MEMORY].base = memory;
+    sim->guard_pages = true;
+    return true;
+}
+
+bool spirv_sim_use_validation(SPIRV_simulator *sim) {
+/* validate the entry point and the functions it calls once, up front.
+   The instruction handlers trust a validated module and skip their own checks of the operands. */
+    assert(sim);
+
+    if (!sim->validated) {
+        sim->validated = spirv_validate_function(sim->module, sim->entry_point->function, &sim->error_msg);
+    }
+
+    return sim->validated;
+}
+
+SimInterfaceHandle spirv_sim_resolve_interface(SPIRV_simulator *sim, StorageClass storage_class, VariableAccess access) {
+    assert(sim);
+
+    return (SimInterfaceHandle) map_int_int_get(&sim->intf_pointers, var_data_key(storage_class, &access));
+}
+
+void spirv_sim_interface_write(SPIRV_simulator *sim, SimInterfaceHandle handle, const void *data, size_t data_size) {
+    assert(sim);
+    assert(data);
+    assert(handle != SIM_INTERFACE_INVALID && handle <= arr_len(sim->interfaces));
+
+    SimInterface *intf = spirv_sim_interface(sim, handle);
+    assert(data_size <= intf->size);
+
+    spirv_sim_memory_write(sim, intf->ptr.pointer, data, data_size);
+}
+
+void spirv_sim_interface_read(SPIRV_simulator *sim, SimInterfaceHandle handle, void *data, size_t data_size) {
+    assert(sim);
+    assert(data);
+    assert(handle != SIM_INTERFACE_INVALID && handle <= arr_len(sim->interfaces));
+
+    SimInterface *intf = spirv_sim_interface(sim, handle);
+    assert(data_size <= intf->size);
+
+    memcpy(data, spirv_sim_memory_ptr(sim, intf->ptr.pointer), data_size);
+}
+
+bool spirv_sim_interface_bind(SPIRV_simulator *sim, SimInterfaceHandle handle, uint8_t *data, size_t data_size) {
+    assert(sim);
+    assert(data);
+    assert(handle != SIM_INTERFACE_INVALID && handle <= arr_len(sim->interfaces));
+
+    SimInterface *intf = spirv_sim_interface(sim, handle);
+    Variable *var = intf->var;
+
+    if (var->kind != ClassInput && var->kind != ClassOutput &&
+        var->kind != ClassUniform && var->kind != ClassStorageBuffer) {
+        return false;
+    }
+
+    /* only entire variables can be bound, not individual members of a structure */
+    if (intf->member >= 0) {
+        return false;
+    }
+
+    size_t var_size = var->array_elements * intf->size;
+    if (data_size < var_size) {
+        return false;
+    }
+
+    uint64_t old_base = intf->ptr.pointer;
+    uint32_t segment = (uint32_t) (old_base >> SIM_SEGMENT_SHIFT);
+
+    /* binding the variable again only has to swap the buffer of its segment */
+    if (segment != SIM_SEGMENT_MEMORY) {
+        alias_materialize_range(sim, SIM_POINTER(segment, 0), (uint64_t) SIM_OFFSET_MASK + 1);
+        sim->segments[segment] = (SimSegment) {data, data_size};
+        return true;
+    }
+
+    if (arr_len(sim->segments) >= SIM_MAX_SEGMENTS) {
+        return false;
+    }
+    segment = arr_len(sim->segments);
+    arr_push(sim->segments, ((SimSegment) {data, data_size}));
+
+    /* redirect the variable (and its interface pointers) to the new segment */
+    uint64_t new_base = SIM_POINTER(segment, 0);
+
+    SimRegister *reg = reg_map_get(&sim->global_frame.regs, var->id);
+    assert(reg);
+    reg->addr[0] = new_base;
+
+    for (SimInterface *iter = sim->interfaces; iter != arr_end(sim->interfaces); ++iter) {
+        if (iter->var == var) {
+            iter->ptr.pointer = new_base + (iter->ptr.pointer - old_base);
+        }
+    }
+
+    return true;
+}
+
 void spirv_sim_variable_associate_data(
     SPIRV_simulator *sim, 
     StorageClass storage_class,
@@ -280,11 +521,28 @@ void spirv_sim_variable_associate_data(
     assert(sim);
     assert(data);
 
-    SimPointer *ptr = map_int_ptr_get(&sim->intf_pointers, var_data_key(storage_class, &access));
-    assert(ptr);
-    assert(data_size <= (ptr->type->element_size * ptr->type->count));
-    
-    memcpy(sim->memory + ptr->pointer, data, data_size);
+    SimInterfaceHandle handle = spirv_sim_resolve_interface(sim, storage_class, access);
+    assert(handle != SIM_INTERFACE_INVALID);
+
+    spirv_sim_interface_write(sim, handle, data, data_size);
+}
+
+bool spirv_sim_variable_bind_data(
+    SPIRV_simulator *sim, 
+    StorageClass storage_class,
+    VariableAccess access, 
+    uint8_t *data,
+    size_t data_size
+) {
+    assert(sim);
+    assert(data);
+
+    SimInterfaceHandle handle = spirv_sim_resolve_interface(sim, storage_class, access);
+    if (handle == SIM_INTERFACE_INVALID) {
+        return false;
+    }
+
+    return spirv_sim_interface_bind(sim, handle, data, data_size);
 }
 
 SimRegister *spirv_sim_register_by_id(SPIRV_simulator *sim, uint32_t id) {
@@ -292,21 +550,21 @@ SimRegister *spirv_sim_register_by_id(SPIRV_simulator *sim, uint32_t id) {
 
     /* check the stack frame of the current function */
     if (sim->current_frame) {
-        SimRegister *reg = map_int_ptr_get(&sim->current_frame->regs, id);
+        SimRegister *reg = reg_map_get(&sim->current_frame->regs, id);
         if (reg != NULL) {
             return reg;
         }
     }
 
     /* if not found: check the global frame */
-    return map_int_ptr_get(&sim->global_frame.regs, id);
+    return reg_map_get(&sim->global_frame.regs, id);
 }
 
 SimPointer *spirv_sim_retrieve_intf_pointer(SPIRV_simulator *sim, StorageClass storage_class, VariableAccess access) {
     assert(sim);
     
-    SimPointer *result = map_int_ptr_get(&sim->intf_pointers, var_data_key(storage_class, &access));
-    return result;
+    SimInterfaceHandle handle = spirv_sim_resolve_interface(sim, storage_class, access);
+    return (handle != SIM_INTERFACE_INVALID) ? &spirv_sim_interface(sim, handle)->ptr : NULL;
 }
 
 void spirv_sim_variable_pointer(SPIRV_simulator *sim, uint32_t id, int32_t member, SimPointer *pointer) {
@@ -319,7 +577,7 @@ void spirv_sim_variable_pointer(SPIRV_simulator *sim, uint32_t id, int32_t membe
     }
 
     pointer->type = reg_for_var->type->base_type;
-    pointer->pointer = reg_for_var->uvec[0];
+    pointer->pointer = reg_for_var->addr[0];
 
     if (member >= 0) {
         variable_member_pointer(pointer, member);
@@ -330,19 +588,24 @@ void spirv_register_to_string(SPIRV_simulator *sim, SimRegister *reg, char **out
     assert(sim);
     assert(reg);
 
-    arr_printf(*out_str, "reg %%%d:", reg->id);
+    arr_append_str(*out_str, "reg %");
+    arr_append_uint(*out_str, reg->id);
+    arr_append_char(*out_str, ':');
     
     for (uint32_t i = 0; i < reg->type->count; ++i) {
         if (spirv_type_is_float(reg->type)) {
-            arr_printf(*out_str, " %.4f", reg->vec[i]);
+            arr_append_char(*out_str, ' ');
+            arr_append_float(*out_str, reg->vec[i], 4);
         } else if (spirv_type_is_integer(reg->type)) {
             if (reg->type->is_signed) {
-                arr_printf(*out_str, " %d", reg->svec[i]);
+                arr_append_char(*out_str, ' ');
+                arr_append_int(*out_str, reg->svec[i]);
             } else {
-                arr_printf(*out_str, " %d", reg->uvec[i]);
+                arr_append_char(*out_str, ' ');
+                arr_append_int(*out_str, (int32_t) reg->uvec[i]);
             }
         } else if (reg->type->kind == TypePointer) {
-            arr_printf(*out_str, " ptr(%x)", reg->uvec[i]);
+            arr_printf(*out_str, " ptr(%" PRIx64 ")", reg->addr[i]);
         }
     }
 }
@@ -372,9 +635,12 @@ static inline uint32_t count_set_bits(uint32_t data) {
 }
 
 
+/* the handlers don't check the operands of instructions that passed validation (see spirv_sim_use_validation) */
+#define OP_ASSERT(cond) assert(sim->validated || (cond))
+
 #define OP_REGISTER(reg, idx)                                            \
     SimRegister *reg = spirv_sim_register_by_id(sim, op->optional[idx]); \
-    assert(reg != NULL);
+    OP_ASSERT(reg != NULL);
 
 #define OP_REGISTER_ASSIGN(reg, type, result_id) \
     SimRegister *res_reg = spirv_sim_assign_register(sim, result_id, type);  
@@ -419,7 +685,7 @@ OP_FUNC_BEGIN (SpvOpExtInst) {
     uint32_t set_id = op->optional[2];
 
     SPIRV_SIM_EXTINST_FUNC extinst_func = (SPIRV_SIM_EXTINST_FUNC) map_int_ptr_get(&sim->extinst_funcs, set_id);
-    assert(extinst_func);
+    OP_ASSERT(extinst_func);
 
     extinst_func(sim, op);
 
@@ -427,18 +693,23 @@ OP_FUNC_BEGIN (SpvOpExtInst) {
 
 OP_FUNC_BEGIN(SpvOpLoad)
     Type *res_type = spirv_module_type_by_id(sim->module, op->optional[0]);
-    OP_REGISTER_ASSIGN(res_reg, res_type, op->optional[1]);
     OP_REGISTER(pointer, 2);
 
     // validate type
-    if (res_type != pointer->type->base_type) {
+    if (!sim->validated && res_type != pointer->type->base_type) {
         arr_printf(sim->error_msg, "Type mismatch in SpvOpLoad");
         return;
     }
 
-    // copy data
+    // large aggregates alias the memory, smaller types are copied
     size_t var_size = res_type->count * res_type->element_size;
-    memcpy(res_reg->raw, sim->memory + pointer->uvec[0], var_size);
+
+    if (var_size >= SIM_ALIAS_MIN_SIZE) {
+        spirv_sim_alias_register(sim, op->optional[1], res_type, pointer->addr[0]);
+    } else {
+        OP_REGISTER_ASSIGN(res_reg, res_type, op->optional[1]);
+        memcpy(res_reg->raw, spirv_sim_memory_ptr(sim, pointer->addr[0]), var_size);
+    }
 
 OP_FUNC_END
 
@@ -447,14 +718,14 @@ OP_FUNC_BEGIN(SpvOpStore)
     OP_REGISTER(object, 1);
 
     // validate type
-    if (object->type != pointer->type->base_type) {
+    if (!sim->validated && object->type != pointer->type->base_type) {
         arr_printf(sim->error_msg, "Type mismatch in SpvOpStore");
         return;
     }
 
     // copy data
     size_t var_size = object->type->count * object->type->element_size;
-    memcpy(sim->memory + pointer->uvec[0], object->raw, var_size);
+    spirv_sim_memory_write(sim, pointer->addr[0], object->raw, var_size);
 
 OP_FUNC_END
 
@@ -463,14 +734,15 @@ OP_FUNC_BEGIN(SpvOpAccessChain) {
     OP_REGISTER_ASSIGN(res_reg, res_type, op->optional[1]);
     OP_REGISTER(base, 2);
 
-    SimPointer ptr = {base->type->base_type, base->uvec[0]};
+    SimPointer ptr = {base->type->base_type, base->addr[0]};
     
+    /* indices into structures are constants, indices into arrays can be any integer (register) */
     for (uint32_t idx = 3; idx < op->op.length - 1; ++idx) {
-        uint32_t field_offset = spirv_module_constant_by_id(sim->module, op->optional[idx])->value.as_uint;
-        variable_member_pointer(&ptr, field_offset);
+        OP_REGISTER(index, idx);
+        variable_member_pointer(&ptr, index->uvec[0]);
     }
     
-    res_reg->uvec[0] = ptr.pointer;
+    res_reg->addr[0] = ptr.pointer;
 
 } OP_FUNC_END
 
@@ -491,7 +763,7 @@ OP_FUNC_BEGIN(SpvOpFunctionCall) {
         return;
     }
 
-    assert(arr_len(func->func.parameter_ids) == op->op.length - 4);
+    OP_ASSERT(arr_len(func->func.parameter_ids) == op->op.length - 4);
 
     /* get pointer to the parameter ids */
     uint32_t *params = NULL;
@@ -517,13 +789,10 @@ OP_FUNC_BEGIN(SpvOpReturn) {
     if (!sim->finished) {
         /* remove current stackframe */
         SPIRV_stackframe *old = &arr_pop(sim->func_frames);
-        stackframe_free(old);
+        stackframe_release(sim, old);
 
-        /* free memory allocated for function variables */
-        if (sim->memory) {
-            arr_remove_back(sim->memory, sim->memory_free_start - old->heap_start);
-            sim->memory_free_start = old->heap_start;
-        }
+        /* release the stack space of the function variables */
+        sim->memory_free_start = old->heap_start;
 
         /* return to previous stackframe */
         sim->current_frame = sim->func_frames + (arr_len(sim->func_frames) - 1);
@@ -551,8 +820,8 @@ OP_FUNC_BEGIN(SpvOpReturnValue) {
 
 OP_FUNC_RES_1OP(SpvOpConvertFToU) {
     /* Convert (value preserving) from floating point to unsigned integer, with round toward 0.0. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(spirv_type_is_unsigned_integer(res_type));
+    OP_ASSERT(spirv_type_is_float(op_reg->type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = (uint32_t) CLAMP(op_reg->vec[i], 0, UINT32_MAX);
@@ -562,8 +831,8 @@ OP_FUNC_RES_1OP(SpvOpConvertFToU) {
 
 OP_FUNC_RES_1OP(SpvOpConvertFToS) {
     /* Convert (value preserving) from floating point to signed integer, with round toward 0.0. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(spirv_type_is_signed_integer(res_type));
+    OP_ASSERT(spirv_type_is_float(op_reg->type));
+    OP_ASSERT(spirv_type_is_signed_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = (int32_t) CLAMP(op_reg->vec[i], INT32_MIN, INT32_MAX);
@@ -573,8 +842,8 @@ OP_FUNC_RES_1OP(SpvOpConvertFToS) {
 
 OP_FUNC_RES_1OP(SpvOpConvertSToF) {
     /* Convert (value preserving) from signed integer to floating point. */
-    assert(spirv_type_is_signed_integer(op_reg->type));
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_signed_integer(op_reg->type));
+    OP_ASSERT(spirv_type_is_float(res_type));
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = (float) op_reg->svec[i];
@@ -585,8 +854,8 @@ OP_FUNC_RES_1OP(SpvOpConvertSToF) {
 
 OP_FUNC_RES_1OP(SpvOpConvertUToF) {
     /* Convert (value preserving) from unsigned integer to floating point. */
-    assert(spirv_type_is_unsigned_integer(op_reg->type));
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(op_reg->type));
+    OP_ASSERT(spirv_type_is_float(res_type));
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = (float) op_reg->uvec[i];
@@ -596,8 +865,8 @@ OP_FUNC_RES_1OP(SpvOpConvertUToF) {
 
 OP_FUNC_RES_1OP(SpvOpUConvert) {
     /* Convert (value preserving) unsigned width. This is either a truncate or a zero extend. */
-    assert(spirv_type_is_unsigned_integer(op_reg->type));
-    assert(spirv_type_is_unsigned_integer(res_type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(op_reg->type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op_reg->uvec[i];
@@ -607,8 +876,8 @@ OP_FUNC_RES_1OP(SpvOpUConvert) {
 
 OP_FUNC_RES_1OP(SpvOpSConvert) {
     /* Convert (value preserving) signed width. This is either a truncate or a sign extend. */
-    assert(spirv_type_is_signed_integer(op_reg->type));
-    assert(spirv_type_is_signed_integer(res_type));
+    OP_ASSERT(spirv_type_is_signed_integer(op_reg->type));
+    OP_ASSERT(spirv_type_is_signed_integer(res_type));
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op_reg->svec[i];
@@ -617,8 +886,8 @@ OP_FUNC_RES_1OP(SpvOpSConvert) {
 
 OP_FUNC_RES_1OP(SpvOpFConvert) {
     /* Convert (value preserving) floating-point width. */
-    assert(spirv_type_is_float(op_reg->type));
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(op_reg->type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = op_reg->vec[i];
@@ -629,16 +898,20 @@ OP_FUNC_RES_1OP(SpvOpFConvert) {
 
 OP_FUNC_RES_1OP(SpvOpConvertPtrToU) {
 /* Convert a pointer to an unsigned integer type */
-    assert(spirv_type_is_unsigned_integer(res_type));
-    assert(op_reg->type->kind == TypePointer);
+    OP_ASSERT(spirv_type_is_unsigned_integer(res_type));
+    OP_ASSERT(op_reg->type->kind == TypePointer);
 
-    res_reg->uvec[0] = op_reg->uvec[0];
+    if (res_type->element_size == sizeof(uint64_t)) {
+        memcpy(res_reg->raw, op_reg->addr, sizeof(uint64_t));
+    } else {
+        res_reg->uvec[0] = (uint32_t) op_reg->addr[0];
+    }
 } OP_FUNC_END
 
 OP_FUNC_RES_1OP(SpvOpSatConvertSToU) {
 /* Convert a signed integer to unsigned integer. */
-    assert(spirv_type_is_signed_integer(op_reg->type));
-    assert(spirv_type_is_unsigned_integer(res_type));
+    OP_ASSERT(spirv_type_is_signed_integer(op_reg->type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(res_type));
 
     uint32_t max_uint = (uint32_t) (UINT64_C(1) << (res_type->element_size * 8)) - 1;
 
@@ -650,8 +923,8 @@ OP_FUNC_RES_1OP(SpvOpSatConvertSToU) {
 
 OP_FUNC_RES_1OP(SpvOpSatConvertUToS) {
 /* Convert an unsigned integer to signed integer.  */
-    assert(spirv_type_is_unsigned_integer(op_reg->type));
-    assert(spirv_type_is_signed_integer(res_type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(op_reg->type));
+    OP_ASSERT(spirv_type_is_signed_integer(res_type));
 
     int32_t max_sint = (1 << ((res_type->element_size * 8) - 1)) - 1;
 
@@ -664,10 +937,14 @@ OP_FUNC_RES_1OP(SpvOpSatConvertUToS) {
 OP_FUNC_RES_1OP(SpvOpConvertUToPtr) {
 /* Convert an integer to pointer */
 
-    assert(spirv_type_is_unsigned_integer(op_reg->type));
-    assert(res_type->kind == TypePointer);
+    OP_ASSERT(spirv_type_is_unsigned_integer(op_reg->type));
+    OP_ASSERT(res_type->kind == TypePointer);
 
-    res_reg->uvec[0] = op_reg->uvec[0];
+    if (op_reg->type->element_size == sizeof(uint64_t)) {
+        memcpy(res_reg->addr, op_reg->raw, sizeof(uint64_t));
+    } else {
+        res_reg->addr[0] = op_reg->uvec[0];
+    }
 
 } OP_FUNC_END
 
@@ -685,10 +962,10 @@ OP_FUNC_RES_1OP(SpvOpBitcast)
 OP_FUNC_RES_2OP(SpvOpVectorExtractDynamic) {
 /* Extract a single, dynamically selected, component of a vector. */
     
-    assert(spirv_type_is_scalar(res_type));
-    assert(spirv_type_is_vector(op1_reg->type));
-    assert(op1_reg->type->base_type == res_type);
-    assert(op2_reg->type->kind == TypeInteger);
+    OP_ASSERT(spirv_type_is_scalar(res_type));
+    OP_ASSERT(spirv_type_is_vector(op1_reg->type));
+    OP_ASSERT(op1_reg->type->base_type == res_type);
+    OP_ASSERT(op2_reg->type->kind == TypeInteger);
     
     res_reg->uvec[0] = op1_reg->uvec[op2_reg->uvec[0]];
 
@@ -703,10 +980,10 @@ OP_FUNC_BEGIN(SpvOpVectorInsertDynamic) {
     OP_REGISTER(component, 3);
     OP_REGISTER(index, 4);
     
-    assert(spirv_type_is_vector(res_type));
-    assert(vector->type == res_type);
-    assert(component->type == res_type->base_type);
-    assert(index->type->kind == TypeInteger);
+    OP_ASSERT(spirv_type_is_vector(res_type));
+    OP_ASSERT(vector->type == res_type);
+    OP_ASSERT(component->type == res_type->base_type);
+    OP_ASSERT(index->type->kind == TypeInteger);
     
     memcpy(res_reg->uvec, vector->uvec, res_reg->type->element_size * res_reg->type->count);
     res_reg->uvec[index->uvec[0]] = component->uvec[0];
@@ -723,12 +1000,12 @@ OP_FUNC_BEGIN(SpvOpVectorShuffle) {
     uint32_t num_components = op->op.length - 5;
     uint32_t *components = &op->optional[4];
     
-    assert(spirv_type_is_vector(res_type));
-    assert(res_type->count == num_components);
-    assert(spirv_type_is_vector(vector_1->type));
-    assert(vector_1->type->base_type == res_type->base_type);
-    assert(spirv_type_is_vector(vector_2->type));
-    assert(vector_2->type->base_type == res_type->base_type);
+    OP_ASSERT(spirv_type_is_vector(res_type));
+    OP_ASSERT(res_type->count == num_components);
+    OP_ASSERT(spirv_type_is_vector(vector_1->type));
+    OP_ASSERT(vector_1->type->base_type == res_type->base_type);
+    OP_ASSERT(spirv_type_is_vector(vector_2->type));
+    OP_ASSERT(vector_2->type->base_type == res_type->base_type);
     
     for (uint32_t c = 0; c < num_components; ++c) {
         if (components[c] == 0xFFFFFFFF) {
@@ -754,21 +1031,21 @@ OP_FUNC_BEGIN(SpvOpCompositeConstruct) {
     OP_REGISTER_ASSIGN(res_reg, res_type, result_id);
     
     if (res_type->kind == TypeStructure) {
-        assert(arr_len(res_type->structure.members) == num_constituents);
+        OP_ASSERT(arr_len(res_type->structure.members) == num_constituents);
         
         for (uint32_t c = 0, offset = 0; c < num_constituents; ++c) {
             SimRegister *c_reg = spirv_sim_register_by_id(sim, constituents[c]);
-            assert(res_type->structure.members[c] == c_reg->type);
+            OP_ASSERT(res_type->structure.members[c] == c_reg->type);
             
             memcpy(res_reg->raw + offset, c_reg->raw, c_reg->type->count * c_reg->type->element_size);
             offset += c_reg->type->count * c_reg->type->element_size;
         }
     } else if (res_type->kind == TypeArray) {
-        assert(res_type->count == num_constituents);
+        OP_ASSERT(res_type->count == num_constituents);
        
         for (uint32_t c = 0, offset = 0; c < num_constituents; ++c) {
             SimRegister *c_reg = spirv_sim_register_by_id(sim, constituents[c]);
-            assert(res_type->base_type == c_reg->type);
+            OP_ASSERT(res_type->base_type == c_reg->type);
             
             memcpy(res_reg->raw + offset, c_reg->raw, c_reg->type->element_size * c_reg->type->count);
             offset += c_reg->type->element_size * c_reg->type->count;
@@ -780,27 +1057,27 @@ OP_FUNC_BEGIN(SpvOpCompositeConstruct) {
         
         for (uint32_t c = 0; c < num_constituents; ++c) {
             SimRegister *c_reg = spirv_sim_register_by_id(sim, constituents[c]);
-            assert(c_reg->type == res_type->base_type || c_reg->type->base_type == res_type->base_type);
+            OP_ASSERT(c_reg->type == res_type->base_type || c_reg->type->base_type == res_type->base_type);
             
             for (uint32_t c_idx = 0; c_idx < c_reg->type->count; ++c_idx) {
                 res_reg->uvec[res_idx++] = c_reg->uvec[c_idx];
             }
         }
         
-        assert(res_idx == res_type->count);
+        OP_ASSERT(res_idx == res_type->count);
         
     } else if (spirv_type_is_matrix(res_type)) {
-        assert(res_type->matrix.num_cols == num_constituents);
+        OP_ASSERT(res_type->matrix.num_cols == num_constituents);
         
         for (uint32_t c = 0, offset = 0; c < num_constituents; ++c) {
             SimRegister *c_reg = spirv_sim_register_by_id(sim, constituents[c]);
-            assert(res_type->base_type == c_reg->type);
+            OP_ASSERT(res_type->base_type == c_reg->type);
             
             memcpy(res_reg->raw + offset, c_reg->raw, c_reg->type->count * c_reg->type->element_size);
             offset += c_reg->type->count * c_reg->type->element_size;
         }
     } else {
-        assert(0 && "Unsupported type in SpvOpCompositeConstruct");
+        OP_ASSERT(0 && "Unsupported type in SpvOpCompositeConstruct");
         return;
     }
     
@@ -810,11 +1087,28 @@ OP_FUNC_BEGIN(SpvOpCompositeExtract) {
 /* Extract a part of a composite object. */
 
     Type *res_type = spirv_module_type_by_id(sim->module, op->optional[0]);
-    OP_REGISTER_ASSIGN(res_reg, res_type, op->optional[1]);
     OP_REGISTER(composite, 2);
     
     uint32_t offset = aggregate_indices_offset(composite->type, op->op.length - 4, &op->optional[3]);
-    memcpy(res_reg->raw, composite->raw + offset, res_reg->type->count * res_reg->type->element_size);
+    size_t res_size = res_type->count * res_type->element_size;
+
+    if (res_size < SIM_ALIAS_MIN_SIZE) {
+        OP_REGISTER_ASSIGN(res_reg, res_type, op->optional[1]);
+        memcpy(res_reg->raw, composite->raw + offset, res_size);
+    } else if (composite->alias >= 0) {
+        /* part of an aliased composite: alias the same memory */
+        spirv_sim_alias_register(sim, op->optional[1], res_type, composite->alias_ptr + offset);
+    } else {
+        /* registers are immutable: share the data of the composite (which lives at least as long) */
+        SimRegister *res_reg = mem_arena_allocate(&sim->current_frame->memory, sizeof(SimRegister));
+        *res_reg = (SimRegister) {
+            .raw = composite->raw + offset,
+            .id = op->optional[1],
+            .type = res_type,
+            .alias = -1
+        };
+        reg_map_put(&sim->current_frame->regs, res_reg->id, res_reg);
+    }
 
 } OP_FUNC_END
 
@@ -826,7 +1120,7 @@ OP_FUNC_BEGIN(SpvOpCompositeInsert) {
     OP_REGISTER(object, 2);
     OP_REGISTER(composite, 3);
     
-    assert(res_type == composite->type);
+    OP_ASSERT(res_type == composite->type);
     
     uint32_t offset = aggregate_indices_offset(composite->type, op->op.length - 5, &op->optional[4]);
     memcpy(res_reg->raw, composite->raw, res_reg->type->count * res_reg->type->element_size);
@@ -837,7 +1131,7 @@ OP_FUNC_BEGIN(SpvOpCompositeInsert) {
 OP_FUNC_RES_1OP(SpvOpCopyObject) {
 /* Make a copy of Operand. There are no dereferences involved. */
     
-    assert(res_reg->type == op_reg->type);
+    OP_ASSERT(res_reg->type == op_reg->type);
     memcpy(res_reg->raw, op_reg->raw, res_reg->type->count * res_reg->type->element_size);
     
 } OP_FUNC_END
@@ -845,11 +1139,11 @@ OP_FUNC_RES_1OP(SpvOpCopyObject) {
 OP_FUNC_RES_1OP(SpvOpTranspose) {
 /* Transpose a matrix. */
     
-    assert(spirv_type_is_matrix(res_reg->type));
-    assert(spirv_type_is_matrix(op_reg->type));
-    assert(res_reg->type->base_type == op_reg->type->base_type);
-    assert(res_reg->type->matrix.num_cols == op_reg->type->matrix.num_rows);
-    assert(res_reg->type->matrix.num_rows == op_reg->type->matrix.num_cols);
+    OP_ASSERT(spirv_type_is_matrix(res_reg->type));
+    OP_ASSERT(spirv_type_is_matrix(op_reg->type));
+    OP_ASSERT(res_reg->type->base_type == op_reg->type->base_type);
+    OP_ASSERT(res_reg->type->matrix.num_cols == op_reg->type->matrix.num_rows);
+    OP_ASSERT(res_reg->type->matrix.num_rows == op_reg->type->matrix.num_cols);
     
     for (uint32_t s_row = 0; s_row < op_reg->type->matrix.num_rows; ++s_row) {
         for (uint32_t s_col = 0; s_col < op_reg->type->matrix.num_rows; ++s_col) {
@@ -866,7 +1160,7 @@ OP_FUNC_RES_1OP(SpvOpTranspose) {
 
 OP_FUNC_RES_1OP(SpvOpSNegate)
 
-    assert(spirv_type_is_integer(res_type));
+    OP_ASSERT(spirv_type_is_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = -op_reg->svec[i];
@@ -876,7 +1170,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_1OP(SpvOpFNegate)
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = -op_reg->vec[i];
@@ -886,7 +1180,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpIAdd)
 
-    assert(spirv_type_is_integer(res_type));
+    OP_ASSERT(spirv_type_is_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op1_reg->svec[i] + op2_reg->svec[i];
@@ -896,7 +1190,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpFAdd)
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = op1_reg->vec[i] + op2_reg->vec[i];
@@ -906,7 +1200,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpISub)
 
-    assert(spirv_type_is_integer(res_type));
+    OP_ASSERT(spirv_type_is_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op1_reg->svec[i] - op2_reg->svec[i];
@@ -916,7 +1210,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpFSub)
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = op1_reg->vec[i] - op2_reg->vec[i];
@@ -926,7 +1220,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpIMul)
 
-    assert(spirv_type_is_integer(res_type));
+    OP_ASSERT(spirv_type_is_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op1_reg->svec[i] * op2_reg->svec[i];
@@ -936,7 +1230,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpFMul)
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = op1_reg->vec[i] * op2_reg->vec[i];
@@ -946,7 +1240,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpUDiv)
 
-    assert(spirv_type_is_unsigned_integer(res_type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] / op2_reg->uvec[i];
@@ -956,7 +1250,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpSDiv)
 
-    assert(spirv_type_is_signed_integer(res_type));
+    OP_ASSERT(spirv_type_is_signed_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op1_reg->svec[i] / op2_reg->svec[i];
@@ -966,7 +1260,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpFDiv)
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = op1_reg->vec[i] / op2_reg->vec[i];
@@ -976,7 +1270,7 @@ OP_FUNC_END
 
 OP_FUNC_RES_2OP(SpvOpUMod)
 
-    assert(spirv_type_is_unsigned_integer(res_type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] % op2_reg->uvec[i];
@@ -987,7 +1281,7 @@ OP_FUNC_END
 OP_FUNC_RES_2OP(SpvOpSRem)
 /* Signed remainder operation of Operand 1 divided by Operand 2. The sign of a non-0 result comes from Operand 1. */
 
-    assert(spirv_type_is_signed_integer(res_type));
+    OP_ASSERT(spirv_type_is_signed_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         int32_t v1 = op1_reg->svec[i];
@@ -1000,7 +1294,7 @@ OP_FUNC_END
 OP_FUNC_RES_2OP(SpvOpSMod)
 /* Signed modulo operation of Operand 1 modulo Operand 2. The sign of a non-0 result comes from Operand 2. */
 
-    assert(spirv_type_is_signed_integer(res_type));
+    OP_ASSERT(spirv_type_is_signed_integer(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         int32_t v1 = op1_reg->svec[i];
@@ -1013,7 +1307,7 @@ OP_FUNC_END
 OP_FUNC_RES_2OP(SpvOpFRem)
 /* Floating-point remainder operation of Operand 1 divided by Operand 2. The sign of a non-0 result comes from Operand 1. */
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         float v1 = op1_reg->vec[i];
@@ -1026,7 +1320,7 @@ OP_FUNC_END
 OP_FUNC_RES_2OP(SpvOpFMod)
 /* Floating-point modulo operation of Operand 1 divided by Operand 2. The sign of a non-0 result comes from Operand 2. */
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         float v1 = op1_reg->vec[i];
@@ -1039,7 +1333,7 @@ OP_FUNC_END
 OP_FUNC_RES_2OP(SpvOpVectorTimesScalar)
 /* Scale a floating-point vector. */
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = op1_reg->vec[i] * op2_reg->vec[0];
@@ -1050,7 +1344,7 @@ OP_FUNC_END
 OP_FUNC_RES_2OP(SpvOpMatrixTimesScalar)
 /* Scale a floating-point matrix. */
 
-    assert(spirv_type_is_float(res_type));
+    OP_ASSERT(spirv_type_is_float(res_type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->vec[i] = op1_reg->vec[i] * op2_reg->vec[0];
@@ -1177,9 +1471,9 @@ OP_FUNC_RES_2OP(SpvOpShiftLeftLogical) {
 
 OP_FUNC_RES_2OP(SpvOpBitwiseOr) {
     
-    assert(spirv_type_is_integer(res_type));
-    assert(spirv_type_is_integer(op1_reg->type));
-    assert(spirv_type_is_integer(op2_reg->type));
+    OP_ASSERT(spirv_type_is_integer(res_type));
+    OP_ASSERT(spirv_type_is_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_integer(op2_reg->type));
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] | op2_reg->uvec[i];
@@ -1189,9 +1483,9 @@ OP_FUNC_RES_2OP(SpvOpBitwiseOr) {
 
 OP_FUNC_RES_2OP(SpvOpBitwiseXor) {
     
-    assert(spirv_type_is_integer(res_type));
-    assert(spirv_type_is_integer(op1_reg->type));
-    assert(spirv_type_is_integer(op2_reg->type));
+    OP_ASSERT(spirv_type_is_integer(res_type));
+    OP_ASSERT(spirv_type_is_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_integer(op2_reg->type));
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] ^ op2_reg->uvec[i];
@@ -1201,9 +1495,9 @@ OP_FUNC_RES_2OP(SpvOpBitwiseXor) {
 
 OP_FUNC_RES_2OP(SpvOpBitwiseAnd) {
     
-    assert(spirv_type_is_integer(res_type));
-    assert(spirv_type_is_integer(op1_reg->type));
-    assert(spirv_type_is_integer(op2_reg->type));
+    OP_ASSERT(spirv_type_is_integer(res_type));
+    OP_ASSERT(spirv_type_is_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_integer(op2_reg->type));
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] & op2_reg->uvec[i];
@@ -1213,8 +1507,8 @@ OP_FUNC_RES_2OP(SpvOpBitwiseAnd) {
 
 OP_FUNC_RES_1OP(SpvOpNot) {
     
-    assert(spirv_type_is_integer(res_type));
-    assert(spirv_type_is_integer(op_reg->type));
+    OP_ASSERT(spirv_type_is_integer(res_type));
+    OP_ASSERT(spirv_type_is_integer(op_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = ~ op_reg->uvec[i];
@@ -1231,8 +1525,8 @@ OP_FUNC_BEGIN(SpvOpBitFieldInsert) {
     OP_REGISTER(offset_reg, 4);
     OP_REGISTER(count_reg, 5);
 
-    assert(spirv_type_is_integer(offset_reg->type));
-    assert(spirv_type_is_integer(count_reg->type));
+    OP_ASSERT(spirv_type_is_integer(offset_reg->type));
+    OP_ASSERT(spirv_type_is_integer(count_reg->type));
     
     uint32_t base_mask = ((1 << count_reg->uvec[0]) - 1) << offset_reg->uvec[0];
     uint32_t insert_mask = ~base_mask;
@@ -1298,9 +1592,9 @@ OP_FUNC_RES_1OP(SpvOpBitCount) {
 OP_FUNC_RES_1OP(SpvOpAny) {
 /* Result is true if any component of Vector is true, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(res_type->count == 1);
-    assert(op_reg->type->kind == TypeBool);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(res_type->count == 1);
+    OP_ASSERT(op_reg->type->kind == TypeBool);
     
     res_reg->uvec[0] = false;
     
@@ -1313,9 +1607,9 @@ OP_FUNC_RES_1OP(SpvOpAny) {
 OP_FUNC_RES_1OP(SpvOpAll) {
 /* Result is true if all components of Vector are true, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(res_type->count == 1);
-    assert(op_reg->type->kind == TypeBool);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(res_type->count == 1);
+    OP_ASSERT(op_reg->type->kind == TypeBool);
     
     res_reg->uvec[0] = true;
     
@@ -1328,8 +1622,8 @@ OP_FUNC_RES_1OP(SpvOpAll) {
 OP_FUNC_RES_1OP(SpvOpIsNan) {
 /* Result is true if x is an IEEE NaN, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = isnan(op_reg->vec[i]);
@@ -1340,8 +1634,8 @@ OP_FUNC_RES_1OP(SpvOpIsNan) {
 OP_FUNC_RES_1OP(SpvOpIsInf) {
 /* Result is true if x is an IEEE Inf, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = isinf(op_reg->vec[i]);
@@ -1352,8 +1646,8 @@ OP_FUNC_RES_1OP(SpvOpIsInf) {
 OP_FUNC_RES_1OP(SpvOpIsFinite) {
 /* Result is true if x is an IEEE finite number, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = isfinite(op_reg->vec[i]);
@@ -1364,8 +1658,8 @@ OP_FUNC_RES_1OP(SpvOpIsFinite) {
 OP_FUNC_RES_1OP(SpvOpIsNormal) {
 /* Result is true if x is an IEEE normal number, otherwise result is false. */
 
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = isnormal(op_reg->vec[i]);
@@ -1376,8 +1670,8 @@ OP_FUNC_RES_1OP(SpvOpIsNormal) {
 OP_FUNC_RES_1OP(SpvOpSignBitSet) {
 /* Result is true if x has its sign bit set, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = signbit(op_reg->vec[i]);
@@ -1388,9 +1682,9 @@ OP_FUNC_RES_1OP(SpvOpSignBitSet) {
 OP_FUNC_RES_2OP(SpvOpLessOrGreater) {
 /* Result is true if x < y or x > y, where IEEE comparisons are used, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(spirv_type_is_float(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(spirv_type_is_float(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = islessgreater(op1_reg->vec[i], op2_reg->vec[i]);
@@ -1401,9 +1695,9 @@ OP_FUNC_RES_2OP(SpvOpLessOrGreater) {
 OP_FUNC_RES_2OP(SpvOpOrdered) {
 /* Result is true if both x == x and y == y are true, where IEEE comparison is used, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(spirv_type_is_float(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(spirv_type_is_float(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = !isunordered(op1_reg->vec[i], op2_reg->vec[i]);
@@ -1414,9 +1708,9 @@ OP_FUNC_RES_2OP(SpvOpOrdered) {
 OP_FUNC_RES_2OP(SpvOpUnordered) {
 /* Result is true if either x or y is an IEEE NaN, otherwise result is false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(spirv_type_is_float(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(spirv_type_is_float(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = isunordered(op1_reg->vec[i], op2_reg->vec[i]);
@@ -1427,9 +1721,9 @@ OP_FUNC_RES_2OP(SpvOpUnordered) {
 OP_FUNC_RES_2OP(SpvOpLogicalEqual) {
 /* Result is true if Operand 1 and Operand 2 have the same value. Result is false if Operand 1 and Operand 2 have different values. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(spirv_type_is_float(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(op1_reg->type->kind == TypeBool);
+    OP_ASSERT(op2_reg->type->kind == TypeBool);
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] == op2_reg->uvec[i];
@@ -1440,9 +1734,9 @@ OP_FUNC_RES_2OP(SpvOpLogicalEqual) {
 OP_FUNC_RES_2OP(SpvOpLogicalNotEqual) {
 /* Result is true if Operand 1 and Operand 2 have different values. Result is false if Operand 1 and Operand 2 have the same value. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(spirv_type_is_float(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(op1_reg->type->kind == TypeBool);
+    OP_ASSERT(op2_reg->type->kind == TypeBool);
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] != op2_reg->uvec[i];
@@ -1453,9 +1747,9 @@ OP_FUNC_RES_2OP(SpvOpLogicalNotEqual) {
 OP_FUNC_RES_2OP(SpvOpLogicalOr) {
 /* Result is true if either Operand 1 or Operand 2 is true. Result is false if both Operand 1 and Operand 2 are false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(spirv_type_is_float(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(op1_reg->type->kind == TypeBool);
+    OP_ASSERT(op2_reg->type->kind == TypeBool);
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] || op2_reg->uvec[i];
@@ -1466,9 +1760,9 @@ OP_FUNC_RES_2OP(SpvOpLogicalOr) {
 OP_FUNC_RES_2OP(SpvOpLogicalAnd) {
 /* Result is true if both Operand 1 and Operand 2 are true. Result is false if either Operand 1 or Operand 2 are false. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(spirv_type_is_float(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(op1_reg->type->kind == TypeBool);
+    OP_ASSERT(op2_reg->type->kind == TypeBool);
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] && op2_reg->uvec[i];
@@ -1479,8 +1773,8 @@ OP_FUNC_RES_2OP(SpvOpLogicalAnd) {
 OP_FUNC_RES_1OP(SpvOpLogicalNot) {
 /* Result is true if Operand is false. Result is false if Operand is true. */
     
-    assert(res_type->kind == TypeBool);
-    assert(op_reg->type == res_type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(op_reg->type == res_type);
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = !op_reg->uvec[i];
@@ -1497,8 +1791,8 @@ OP_FUNC_BEGIN(SpvOpSelect) {
     OP_REGISTER(obj1_reg, 3);
     OP_REGISTER(obj2_reg, 4);
 
-    assert(obj1_reg->type == res_reg->type);
-    assert(obj2_reg->type == res_reg->type);
+    OP_ASSERT(obj1_reg->type == res_reg->type);
+    OP_ASSERT(obj2_reg->type == res_reg->type);
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = (cond_reg->uvec[i]) ? obj1_reg->uvec[i] : obj2_reg->uvec[i];
@@ -1509,9 +1803,9 @@ OP_FUNC_BEGIN(SpvOpSelect) {
 OP_FUNC_RES_2OP(SpvOpIEqual) {
 /* Integer comparison for equality. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_integer(op1_reg->type));
-    assert(spirv_type_is_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_integer(op2_reg->type));
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] == op2_reg->uvec[i];
@@ -1522,9 +1816,9 @@ OP_FUNC_RES_2OP(SpvOpIEqual) {
 OP_FUNC_RES_2OP(SpvOpINotEqual) {
 /* Integer comparison for inequality. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_integer(op1_reg->type));
-    assert(spirv_type_is_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_integer(op2_reg->type));
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] != op2_reg->uvec[i];
@@ -1535,9 +1829,9 @@ OP_FUNC_RES_2OP(SpvOpINotEqual) {
 OP_FUNC_RES_2OP(SpvOpUGreaterThan) {
 /* Unsigned-integer comparison if Operand 1 is greater than Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_unsigned_integer(op1_reg->type));
-    assert(spirv_type_is_unsigned_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_unsigned_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] > op2_reg->uvec[i];
@@ -1548,9 +1842,9 @@ OP_FUNC_RES_2OP(SpvOpUGreaterThan) {
 OP_FUNC_RES_2OP(SpvOpSGreaterThan) {
 /* Signed-integer comparison if Operand 1 is greater than Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_signed_integer(op1_reg->type));
-    assert(spirv_type_is_signed_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_signed_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_signed_integer(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op1_reg->svec[i] > op2_reg->svec[i];
@@ -1561,9 +1855,9 @@ OP_FUNC_RES_2OP(SpvOpSGreaterThan) {
 OP_FUNC_RES_2OP(SpvOpUGreaterThanEqual) {
 /* Unsigned-integer comparison if Operand 1 is greater than or equal to Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_unsigned_integer(op1_reg->type));
-    assert(spirv_type_is_unsigned_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_unsigned_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] >= op2_reg->uvec[i];
@@ -1574,9 +1868,9 @@ OP_FUNC_RES_2OP(SpvOpUGreaterThanEqual) {
 OP_FUNC_RES_2OP(SpvOpSGreaterThanEqual) {
 /* Signed-integer comparison if Operand 1 is greater than or equal to Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_signed_integer(op1_reg->type));
-    assert(spirv_type_is_signed_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_signed_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_signed_integer(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op1_reg->svec[i] >= op2_reg->svec[i];
@@ -1587,9 +1881,9 @@ OP_FUNC_RES_2OP(SpvOpSGreaterThanEqual) {
 OP_FUNC_RES_2OP(SpvOpULessThan) {
 /* Unsigned-integer comparison if Operand 1 is less than Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_unsigned_integer(op1_reg->type));
-    assert(spirv_type_is_unsigned_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_unsigned_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] < op2_reg->uvec[i];
@@ -1600,9 +1894,9 @@ OP_FUNC_RES_2OP(SpvOpULessThan) {
 OP_FUNC_RES_2OP(SpvOpSLessThan) {
 /* Signed-integer comparison if Operand 1 is less than Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_signed_integer(op1_reg->type));
-    assert(spirv_type_is_signed_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_signed_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_signed_integer(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op1_reg->svec[i] < op2_reg->svec[i];
@@ -1613,9 +1907,9 @@ OP_FUNC_RES_2OP(SpvOpSLessThan) {
 OP_FUNC_RES_2OP(SpvOpULessThanEqual) {
 /* Unsigned-integer comparison if Operand 1 is less than or equal to Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_unsigned_integer(op1_reg->type));
-    assert(spirv_type_is_unsigned_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_unsigned_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_unsigned_integer(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] = op1_reg->uvec[i] <= op2_reg->uvec[i];
@@ -1626,9 +1920,9 @@ OP_FUNC_RES_2OP(SpvOpULessThanEqual) {
 OP_FUNC_RES_2OP(SpvOpSLessThanEqual) {
 /* Signed-integer comparison if Operand 1 is less than or equal to Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_signed_integer(op1_reg->type));
-    assert(spirv_type_is_signed_integer(op2_reg->type));
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_signed_integer(op1_reg->type));
+    OP_ASSERT(spirv_type_is_signed_integer(op2_reg->type));
 
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->svec[i] = op1_reg->svec[i] <= op2_reg->svec[i];
@@ -1639,9 +1933,9 @@ OP_FUNC_RES_2OP(SpvOpSLessThanEqual) {
 OP_FUNC_RES_2OP(SpvOpFOrdEqual) {
 /* Floating-point comparison for being ordered and equal. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1654,9 +1948,9 @@ OP_FUNC_RES_2OP(SpvOpFOrdEqual) {
 OP_FUNC_RES_2OP(SpvOpFUnordEqual) {
 /* Floating-point comparison for being unordered or equal. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1669,9 +1963,9 @@ OP_FUNC_RES_2OP(SpvOpFUnordEqual) {
 OP_FUNC_RES_2OP(SpvOpFOrdNotEqual) {
 /* Floating-point comparison for being ordered and not equal. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1684,9 +1978,9 @@ OP_FUNC_RES_2OP(SpvOpFOrdNotEqual) {
 OP_FUNC_RES_2OP(SpvOpFUnordNotEqual) {
 /* Floating-point comparison for being unordered or not equal. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1699,9 +1993,9 @@ OP_FUNC_RES_2OP(SpvOpFUnordNotEqual) {
 OP_FUNC_RES_2OP(SpvOpFOrdLessThan) {
 /* Floating-point comparison if operands are ordered and Operand 1 is less than Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1714,9 +2008,9 @@ OP_FUNC_RES_2OP(SpvOpFOrdLessThan) {
 OP_FUNC_RES_2OP(SpvOpFUnordLessThan) {
 /* Floating-point comparison if operands are unordered or Operand 1 is less than Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1729,9 +2023,9 @@ OP_FUNC_RES_2OP(SpvOpFUnordLessThan) {
 OP_FUNC_RES_2OP(SpvOpFOrdGreaterThan) {
 /* Floating-point comparison if operands are ordered and Operand 1 is greater than Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1744,9 +2038,9 @@ OP_FUNC_RES_2OP(SpvOpFOrdGreaterThan) {
 OP_FUNC_RES_2OP(SpvOpFUnordGreaterThan) {
 /* Floating-point comparison if operands are unordered or Operand 1 is greater than Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1760,9 +2054,9 @@ OP_FUNC_RES_2OP(SpvOpFUnordGreaterThan) {
 OP_FUNC_RES_2OP(SpvOpFOrdLessThanEqual) {
 /* Floating-point comparison if operands are ordered and Operand 1 is less than or equal to Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (int32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1775,9 +2069,9 @@ OP_FUNC_RES_2OP(SpvOpFOrdLessThanEqual) {
 OP_FUNC_RES_2OP(SpvOpFUnordLessThanEqual) {
 /* Floating-point comparison if operands are unordered or Operand 1 is less than or equal to Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (uint32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1790,9 +2084,9 @@ OP_FUNC_RES_2OP(SpvOpFUnordLessThanEqual) {
 OP_FUNC_RES_2OP(SpvOpFOrdGreaterThanEqual) {
 /* Floating-point comparison if operands are ordered and Operand 1 is greater than or equal to Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (uint32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1805,9 +2099,9 @@ OP_FUNC_RES_2OP(SpvOpFOrdGreaterThanEqual) {
 OP_FUNC_RES_2OP(SpvOpFUnordGreaterThanEqual) {
 /* Floating-point comparison if operands are unordered or Operand 1 is greater than or equal to Operand 2. */
     
-    assert(res_type->kind == TypeBool);
-    assert(spirv_type_is_float(op1_reg->type));
-    assert(op1_reg->type == op2_reg->type);
+    OP_ASSERT(res_type->kind == TypeBool);
+    OP_ASSERT(spirv_type_is_float(op1_reg->type));
+    OP_ASSERT(op1_reg->type == op2_reg->type);
     
     for (uint32_t i = 0; i < res_type->count; ++i) {
         res_reg->uvec[i] =
@@ -1827,7 +2121,7 @@ OP_FUNC_BEGIN(SpvOpBranch) {
     uint32_t label_id = op->optional[0];   
 
     sim->jump_to_op = spirv_module_opcode_by_label(sim->module, label_id);
-    assert(sim->jump_to_op);
+    OP_ASSERT(sim->jump_to_op);
 
 } OP_FUNC_END
 
@@ -1841,7 +2135,7 @@ OP_FUNC_BEGIN(SpvOpBranchConditional) {
     sim->jump_to_op = spirv_module_opcode_by_label(
                             sim->module,
                             (cond_reg->svec[0]) ? true_label : false_label);
-    assert(sim->jump_to_op);
+    OP_ASSERT(sim->jump_to_op);
 
 } OP_FUNC_END
 
@@ -1862,7 +2156,7 @@ OP_FUNC_BEGIN(SpvOpSwitch) {
     }
 
     sim->jump_to_op = spirv_module_opcode_by_label(sim->module, target);
-    assert(sim->jump_to_op);
+    OP_ASSERT(sim->jump_to_op);
 
 } OP_FUNC_END
 
@@ -1881,6 +2175,18 @@ void spirv_sim_step(SPIRV_simulator *sim) {
     SPIRV_opcode *op = spirv_bin_opcode_current(sim->module->spirv_bin);
     sim->jump_to_op = NULL;
 
+#ifdef GUARDED_MEMORY_SUPPORTED
+    /* the instruction touched a guard page: report the error and stay at the faulting instruction */
+    sigjmp_buf fault_env;
+    if (sim->guard_pages) {
+        if (sigsetjmp(fault_env, 0) != 0) {
+            arr_printf(sim->error_msg, "Out of bounds memory access by instruction %d [%s]",
+                       spirv_module_index_for_opcode(sim->module, op), spirv_op_name(op->op.kind));
+            return;
+        }
+        guarded_memory_catch_faults(&fault_env);
+    }
+#endif
 
 #define OP_IGNORE(kind)                 \
     case kind:                          \
@@ -2051,6 +2357,12 @@ void spirv_sim_step(SPIRV_simulator *sim) {
 #undef OP
 #undef OP_DEFAULT
 
+#ifdef GUARDED_MEMORY_SUPPORTED
+    if (sim->guard_pages) {
+        guarded_memory_catch_faults(NULL);
+    }
+#endif
+
     if (sim->jump_to_op != NULL) {
         spirv_bin_opcode_jump_to(sim->module->spirv_bin, sim->jump_to_op);
     } else {
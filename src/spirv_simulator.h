@@ -7,29 +7,71 @@
 
 #include "types.h"
 #include "allocator.h"
+#include "typed_map.h"
 #include "spirv_module.h"
 
 #define SPIRV_SIM_DEFAULT_ENTRYPOINT 0
 
+// simulated pointers are 64-bit: a segment index (upper 16 bits) and an offset into that segment (lower 48 bits).
+// Segment 0 is the simulator's own memory, the other segments are caller-owned buffers that were
+// bound to a variable with spirv_sim_variable_bind_data.
+#define SIM_SEGMENT_SHIFT       48
+#define SIM_OFFSET_MASK         ((UINT64_C(1) << SIM_SEGMENT_SHIFT) - 1)
+#define SIM_MAX_SEGMENTS        (1u << (64 - SIM_SEGMENT_SHIFT))
+#define SIM_SEGMENT_MEMORY      0
+#define SIM_POINTER(seg, offset)    (((uint64_t) (seg) << SIM_SEGMENT_SHIFT) | (offset))
+
+// loads of aggregates of at least this size (in bytes) don't copy the data but alias the simulated memory.
+// The data is copied into the register when the memory is written to.
+#define SIM_ALIAS_MIN_SIZE      64
+
 // types
+typedef enum SimPrecision {
+    SimPrecisionExact = 0,      // transcendental functions use the C standard library
+    SimPrecisionFast            // polynomial approximations within the Vulkan precision bounds
+} SimPrecision;
+
+typedef struct SimSegment {
+    uint8_t *base;
+    size_t size;
+} SimSegment;
+
 typedef struct SimPointer {
     Type *type;
-    uint32_t pointer;
+    uint64_t pointer;
 } SimPointer;
 
+// handle to a resolved interface variable (or structure member), returned by spirv_sim_resolve_interface.
+// Handles remain valid for the lifetime of the simulator, 0 is never a valid handle.
+typedef uint32_t SimInterfaceHandle;
+#define SIM_INTERFACE_INVALID   0
+
+typedef struct SimInterface {
+    SimPointer ptr;             // type and current location of the data
+    uint32_t size;              // size of the data in bytes
+    Variable *var;
+    int32_t member;             // index of the structure member, -1 for the entire variable
+} SimInterface;
+
 typedef struct SimRegister {
     union {
         float *vec;
         int32_t *svec;
         uint32_t *uvec;
+        uint64_t *addr;         // pointers
         uint8_t *raw;
     };
     uint32_t id;
     Type *type;
+    int32_t alias;          // index in the alias list of the stackframe, -1 if the register owns its data
+    uint64_t alias_ptr;     // simulated pointer to the aliased data
 } SimRegister;
 
+TYPED_MAP_U32(RegisterMap, reg_map, SimRegister)
+
 typedef struct SPIRV_stackframe {
-    HashMap regs;             // SPIRV id (uint32_t) -> SimRegister *
+    RegisterMap regs;         // SPIRV id (uint32_t) -> SimRegister *
+    SimRegister **aliases;    // dyn_array - registers that alias simulated memory
     SPIRV_function *func;
     struct SPIRV_opcode *return_addr;
     uint32_t return_id;
@@ -41,24 +83,33 @@ typedef struct SPIRV_simulator {
     SPIRV_module *module;
     HashMap extinst_funcs;  // id (uint32_t) -> SPIRV_SIM_EXTINST_FUNC *
     
-    uint8_t *memory;            // dyn_array
-    uint32_t memory_free_start;
+    uint8_t *memory;            // global variables followed by the stack of the entrypoint
+    uint32_t memory_size;
+    uint32_t memory_free_start; // top of the stack
+    bool guard_pages;           // memory is surrounded by guard pages (see spirv_sim_use_guard_pages)
+    bool validated;             // the functions passed validation, instructions aren't checked (see spirv_sim_use_validation)
+    SimSegment *segments;       // dyn_array - index 0 refers to memory
 
-    HashMap intf_pointers;  // uint64_t -> SimPointer *
+    SimInterface *interfaces;   // dyn_array
+    HashMap intf_pointers;      // uint64_t -> SimInterfaceHandle
     EntryPoint *entry_point;
 
     /* stackframes */
     SPIRV_stackframe global_frame;
     SPIRV_stackframe *func_frames;      // dyn_array
+    SPIRV_stackframe *free_frames;      // dyn_array - frames of functions that returned, reused by the next call
     SPIRV_stackframe *current_frame;
     struct SPIRV_opcode *jump_to_op;
 
+    SimPrecision precision;
     bool finished;
     char *error_msg;        // NULL if no error, dynamic string otherwise
 } SPIRV_simulator;
 
 void spirv_sim_init(SPIRV_simulator *sim, SPIRV_module *module, uint32_t entrypoint);
 void spirv_sim_shutdown(SPIRV_simulator *sim);
+bool spirv_sim_use_guard_pages(SPIRV_simulator *sim);
+bool spirv_sim_use_validation(SPIRV_simulator *sim);
 void spirv_sim_variable_associate_data(
     SPIRV_simulator *sim, 
     StorageClass storage_class,
@@ -66,12 +117,38 @@ void spirv_sim_variable_associate_data(
     uint8_t *data,
     size_t data_size
 );
+bool spirv_sim_variable_bind_data(
+    SPIRV_simulator *sim, 
+    StorageClass storage_class,
+    VariableAccess access, 
+    uint8_t *data,
+    size_t data_size
+);
 void spirv_sim_step(SPIRV_simulator *sim);
 
+void spirv_sim_memory_write(SPIRV_simulator *sim, uint64_t pointer, const void *data, size_t data_size);
+
+SimInterfaceHandle spirv_sim_resolve_interface(SPIRV_simulator *sim, StorageClass storage_class, VariableAccess access);
+void spirv_sim_interface_write(SPIRV_simulator *sim, SimInterfaceHandle handle, const void *data, size_t data_size);
+void spirv_sim_interface_read(SPIRV_simulator *sim, SimInterfaceHandle handle, void *data, size_t data_size);
+bool spirv_sim_interface_bind(SPIRV_simulator *sim, SimInterfaceHandle handle, uint8_t *data, size_t data_size);
+
 SimRegister *spirv_sim_register_by_id(SPIRV_simulator *sim, uint32_t id);
 SimPointer *spirv_sim_retrieve_intf_pointer(SPIRV_simulator *sim, StorageClass storage_class, VariableAccess access);
 void spirv_sim_variable_pointer(SPIRV_simulator *sim, uint32_t id, int32_t member, SimPointer *pointer);
 void spirv_register_to_string(SPIRV_simulator *sim, SimRegister *reg, char **out_str);
 
+static inline uint8_t *spirv_sim_memory_ptr(SPIRV_simulator *sim, uint64_t pointer) {
+    return sim->segments[pointer >> SIM_SEGMENT_SHIFT].base + (pointer & SIM_OFFSET_MASK);
+}
+
+static inline SimInterface *spirv_sim_interface(SPIRV_simulator *sim, SimInterfaceHandle handle) {
+    return &sim->interfaces[handle - 1];
+}
+
+static inline uint8_t *spirv_sim_interface_data(SPIRV_simulator *sim, SimInterfaceHandle handle) {
+    return spirv_sim_memory_ptr(sim, sim->interfaces[handle - 1].ptr.pointer);
+}
+
 
 #endif // JS_SHADER_SIM_SPIRV_SIMULATOR_H
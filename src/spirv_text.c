@@ -6,6 +6,7 @@
 #include "spirv_binary.h"
 #include "spirv_module.h"
 #include "dyn_array.h"
+#include "thread_pool.h"
 
 #include <stdbool.h>
 #include <ctype.h>
@@ -14,9 +15,9 @@
 #define JS_SPIRV_NAMES_IMPLEMENTATION
 #include "spirv/spirv_names.h"
 
-static inline void spirv_text_create_type_alias(SPIRV_module *spirv_mod, Type *type) {
+static inline void spirv_text_create_type_alias(SPIRV_text_writer *writer, Type *type) {
     if (spirv_type_is_vector(type)) {
-        arr_printf(spirv_mod->text->scratch_buf, "%%vec%d%s",
+        arr_printf(writer->scratch_buf, "%%vec%d%s",
             type->count,
             (spirv_type_is_float(type)) ? "f" : 
                 (spirv_type_is_signed_integer(type)) ? "i" : "u"
@@ -24,7 +25,7 @@ static inline void spirv_text_create_type_alias(SPIRV_module *spirv_mod, Type *t
     }
 
     if (spirv_type_is_matrix(type)) {
-        arr_printf(spirv_mod->text->scratch_buf, "%%mat%dx%d%s",
+        arr_printf(writer->scratch_buf, "%%mat%dx%d%s",
             type->matrix.num_rows,
             type->matrix.num_cols,
             (spirv_type_is_float(type)) ? "f" : 
@@ -33,135 +34,136 @@ static inline void spirv_text_create_type_alias(SPIRV_module *spirv_mod, Type *t
     }
 
     if (spirv_type_is_float(type) && type->count == 1) {
-        arr_printf(spirv_mod->text->scratch_buf, "%%float");
+        arr_printf(writer->scratch_buf, "%%float");
     }
 
     if (spirv_type_is_integer(type) && type->count == 1) {
-        arr_printf(spirv_mod->text->scratch_buf, "%%%s",
+        arr_printf(writer->scratch_buf, "%%%s",
             (spirv_type_is_signed_integer(type)) ? "int" : "uint"
         );
     }
 
     if (type->kind == TypeBool && type->count == 1) {
-        arr_strcat(spirv_mod->text->scratch_buf, "%bool");
+        arr_strcat(writer->scratch_buf, "%bool");
     }
 
     if (type->kind == TypeVoid) {
-        arr_strcat(spirv_mod->text->scratch_buf, "%void");
+        arr_strcat(writer->scratch_buf, "%void");
     }
 
     if (type->kind == TypePointer) {
-        arr_printf(spirv_mod->text->scratch_buf, "%%ptr_%s_",
+        arr_printf(writer->scratch_buf, "%%ptr_%s_",
             spirv_storage_class_name((SpvStorageClass) type->pointer.storage_class)
         );
-        for (char *s = spirv_mod->text->scratch_buf; *s; ++s) {
+        for (char *s = writer->scratch_buf; *s; ++s) {
             *s = (char) tolower(*s);
         }
-        spirv_text_create_type_alias(spirv_mod, type->base_type);
+        spirv_text_create_type_alias(writer, type->base_type);
     }
 }
 
-static inline const char *spirv_text_format_id(SPIRV_module *spirv_mod, uint32_t id) {
-    arr_clear(spirv_mod->text->scratch_buf);
+static inline const char *spirv_text_format_id(SPIRV_text_writer *writer, uint32_t id) {
+    SPIRV_text *text = writer->module->text;
+    arr_clear(writer->scratch_buf);
 
     bool done = false;
 
-    if (!done && spirv_mod->text->use_id_names) {
-        const char *name = spirv_module_name_by_id(spirv_mod, id, -1);
+    if (!done && text->use_id_names) {
+        const char *name = spirv_module_name_by_id(writer->module, id, -1);
         if (name) {
-            arr_printf(spirv_mod->text->scratch_buf, "%%%s", name);
+            arr_append_char(writer->scratch_buf, '%');
+            arr_append_str(writer->scratch_buf, name);
             done = true;
         }
     } 
 
     /* if it's a constant: try to use / generate an alias */
-    if (!done && spirv_mod->text->use_constant_alias) {
-        Constant *constant = spirv_module_constant_by_id(spirv_mod, id);
+    if (!done && text->use_constant_alias) {
+        Constant *constant = spirv_module_constant_by_id(writer->module, id);
 
         if (!done && constant && spirv_type_is_scalar(constant->type)) {
-            const char *alias = map_int_str_get(&spirv_mod->text->id_aliases, id);
+            const char *alias = alias_map_get(&text->id_aliases, id);
             if (alias) {
-                arr_printf(spirv_mod->text->scratch_buf, "%s", alias);
+                arr_append_str(writer->scratch_buf, alias);
                 done = true;
             }
         }
 
-        if (!done && constant && spirv_type_is_scalar(constant->type)) {
+        if (!done && !writer->read_only && constant && spirv_type_is_scalar(constant->type)) {
             if (spirv_type_is_integer(constant->type)) {
-                arr_printf(spirv_mod->text->scratch_buf, "%%c%d", constant->value.as_int);
+                arr_append_str(writer->scratch_buf, "%c");
+                arr_append_int(writer->scratch_buf, constant->value.as_int);
                 done = true;
             } else if (spirv_type_is_float(constant->type)) {
-                arr_printf(spirv_mod->text->scratch_buf, "%%c%gf", constant->value.as_float);
+                arr_printf(writer->scratch_buf, "%%c%gf", constant->value.as_float);
                 done = true;
             } else if (constant->type->kind == TypeBool) {
-                arr_printf(spirv_mod->text->scratch_buf, "%%c%s", (constant->value.as_int)? "True" : "False");
+                arr_printf(writer->scratch_buf, "%%c%s", (constant->value.as_int)? "True" : "False");
                 done = true;
             }
 
-            if (done && !map_str_int_has(&spirv_mod->text->id_aliases_rev, spirv_mod->text->scratch_buf)) {
-                char *alias = mem_arena_allocate(&spirv_mod->allocator, arr_len(spirv_mod->text->scratch_buf) + 1);
-                strncpy(alias, spirv_mod->text->scratch_buf, arr_len(spirv_mod->text->scratch_buf) + 1);
-
-                map_int_str_put(&spirv_mod->text->id_aliases, id, alias);
-                map_str_int_put(&spirv_mod->text->id_aliases_rev, alias, id);
+            if (done && !intern_find(&text->alias_names, writer->scratch_buf)) {
+                const char *alias = intern_str(&text->alias_names, writer->scratch_buf);
+                alias_map_put(&text->id_aliases, id, alias);
             } else {
-                arr_clear(spirv_mod->text->scratch_buf);
+                arr_clear(writer->scratch_buf);
                 done = false;
             }
         }
     }
 
     if (!done) {
-       arr_printf(spirv_mod->text->scratch_buf, "%%%d", id);
+       arr_append_char(writer->scratch_buf, '%');
+       arr_append_uint(writer->scratch_buf, id);
        done = true;
     }
 
-    return spirv_mod->text->scratch_buf;
+    return writer->scratch_buf;
 }
 
-static inline const char *spirv_text_format_type_id(SPIRV_module *spirv_mod, uint32_t id) {
-    arr_clear(spirv_mod->text->scratch_buf);
+static inline const char *spirv_text_format_type_id(SPIRV_text_writer *writer, uint32_t id) {
+    SPIRV_text *text = writer->module->text;
+    arr_clear(writer->scratch_buf);
 
     /* prefer manually defined name */
-    if (spirv_mod->text->use_id_names && arr_len(spirv_mod->text->scratch_buf) == 0) {
-        const char *name = spirv_module_name_by_id(spirv_mod, id, -1);
+    if (text->use_id_names && arr_len(writer->scratch_buf) == 0) {
+        const char *name = spirv_module_name_by_id(writer->module, id, -1);
         if (name) {
-            arr_printf(spirv_mod->text->scratch_buf, "%%%s", name);
+            arr_append_char(writer->scratch_buf, '%');
+            arr_append_str(writer->scratch_buf, name);
         }
     } 
 
     /* check if there's already an alias for this id */
-    if (spirv_mod->text->use_type_alias && arr_len(spirv_mod->text->scratch_buf) == 0) {
-        const char *alias = map_int_str_get(&spirv_mod->text->id_aliases, id);
+    if (text->use_type_alias && arr_len(writer->scratch_buf) == 0) {
+        const char *alias = alias_map_get(&text->id_aliases, id);
         if (alias) {
-            arr_printf(spirv_mod->text->scratch_buf, "%s", alias);
+            arr_append_str(writer->scratch_buf, alias);
         }
     }
 
     /* try to generate an alias */
-    if (spirv_mod->text->use_type_alias && arr_len(spirv_mod->text->scratch_buf) == 0) {
-        Type *type = spirv_module_type_by_id(spirv_mod, id);
-        spirv_text_create_type_alias(spirv_mod, type);
+    if (text->use_type_alias && !writer->read_only && arr_len(writer->scratch_buf) == 0) {
+        Type *type = spirv_module_type_by_id(writer->module, id);
+        spirv_text_create_type_alias(writer, type);
 
         /* check for duplicates */
-        if (arr_len(spirv_mod->text->scratch_buf) > 0 && 
-            !map_str_int_has(&spirv_mod->text->id_aliases_rev, spirv_mod->text->scratch_buf)) {
-            char *alias = mem_arena_allocate(&spirv_mod->allocator, arr_len(spirv_mod->text->scratch_buf) + 1);
-            strncpy(alias, spirv_mod->text->scratch_buf, arr_len(spirv_mod->text->scratch_buf) + 1);
-
-            map_int_str_put(&spirv_mod->text->id_aliases, id, alias);
-            map_str_int_put(&spirv_mod->text->id_aliases_rev, alias, id);
+        if (arr_len(writer->scratch_buf) > 0 && 
+            !intern_find(&text->alias_names, writer->scratch_buf)) {
+            const char *alias = intern_str(&text->alias_names, writer->scratch_buf);
+            alias_map_put(&text->id_aliases, id, alias);
         } else {
-            arr_clear(&spirv_mod->text->scratch_buf);
+            arr_clear(writer->scratch_buf);
         }
     }
 
     /* fallback to numerical id */
-    if (arr_len(spirv_mod->text->scratch_buf) == 0) {
-       arr_printf(spirv_mod->text->scratch_buf, "%%%d", id);
+    if (arr_len(writer->scratch_buf) == 0) {
+       arr_append_char(writer->scratch_buf, '%');
+       arr_append_uint(writer->scratch_buf, id);
     }
 
-    return spirv_mod->text->scratch_buf;
+    return writer->scratch_buf;
 }
 
 static inline void spirv_text_append(char **result, const char **strings, size_t count) {
@@ -170,17 +172,23 @@ static inline void spirv_text_append(char **result, const char **strings, size_t
     }
 }
 
-static inline void spirv_text_start_tag(SPIRV_module *module, char *result, SPIRV_text_kind kind, uint32_t id) {
+static inline void spirv_text_start_tag(SPIRV_text_writer *writer, char *result, SPIRV_text_kind kind, uint32_t id) {
+    if (!writer->record_spans) {
+        return;
+    }
     SPIRV_text_span span = (SPIRV_text_span) {
         .start = arr_len(result),
         .kind = kind,
         .id = id
     };
-    arr_push(module->text->spans, span);
+    arr_push(writer->spans, span);
 }
 
-static inline void spirv_text_end_tag(SPIRV_module *module, char *result) {
-    module->text->spans[arr_len(module->text->spans)-1].end = (uint32_t) arr_len(result) - 1u;
+static inline void spirv_text_end_tag(SPIRV_text_writer *writer, char *result) {
+    if (!writer->record_spans) {
+        return;
+    }
+    writer->spans[arr_len(writer->spans)-1].end = (uint32_t) arr_len(result) - 1u;
 }
 
 /*
@@ -189,37 +197,34 @@ static inline void spirv_text_end_tag(SPIRV_module *module, char *result) {
 
 
 #define APPEND_STR(...)         spirv_text_append(&result, (const char *[]){__VA_ARGS__}, sizeof((const char *[]) {__VA_ARGS__})/sizeof(const char *))
-#define APPEND_FMT(fmt,...)     arr_printf(result, fmt, __VA_ARGS__)
-#define SPACER                  arr_printf(result, " ")
-#define STAG(x)                 spirv_text_start_tag(module, result, SPAN_##x, 0)
-#define STAG_ID(x,id)           spirv_text_start_tag(module, result, SPAN_##x, id)
-#define ETAG                    spirv_text_end_tag(module, result)
+#define SPACER                  arr_append_char(result, ' ')
+#define STAG(x)                 spirv_text_start_tag(writer, result, SPAN_##x, 0)
+#define STAG_ID(x,id)           spirv_text_start_tag(writer, result, SPAN_##x, id)
+#define ETAG                    spirv_text_end_tag(writer, result)
 
 #define OP(op)                  (STAG(OP), APPEND_STR(spirv_op_name((op))), ETAG)
 #define KEYWORD(x)              (SPACER, STAG(KEYWORD), APPEND_STR((x)), ETAG)
 #define LITERAL_STRING(x)       (SPACER, STAG(LITERAL_STRING), APPEND_STR("\"", (x), "\""), ETAG)
-#define LITERAL_INTEGER(x)      (SPACER, STAG(LITERAL_INTEGER), APPEND_FMT("%d", (x)), ETAG)
-#define LITERAL_FLOAT(x)        (SPACER, STAG(LITERAL_FLOAT), APPEND_FMT("%f", (double) (x)), ETAG)
+#define LITERAL_INTEGER(x)      (SPACER, STAG(LITERAL_INTEGER), arr_append_int(result, (int32_t) (x)), ETAG)
+#define LITERAL_FLOAT(x)        (SPACER, STAG(LITERAL_FLOAT), arr_append_float(result, (double) (x), 6), ETAG)
 #define FORMATTED_ID(x,id)      (STAG_ID(ID, (id)), APPEND_STR((x)), ETAG)
-#define ID(x)                   (SPACER, STAG_ID(ID, (x)), APPEND_STR(spirv_text_format_id(module, (x))), ETAG)
+#define ID(x)                   (SPACER, STAG_ID(ID, (x)), APPEND_STR(spirv_text_format_id(writer, (x))), ETAG)
 #define FORMATTED_TYPE_ID(x,id) (STAG_ID(TYPE_ID, (id)), APPEND_STR((x)), ETAG)
-#define TYPE_ID(x)              (SPACER, STAG_ID(TYPE_ID, (x)), APPEND_STR(spirv_text_format_type_id(module, (x))), ETAG)
+#define TYPE_ID(x)              (SPACER, STAG_ID(TYPE_ID, (x)), APPEND_STR(spirv_text_format_type_id(writer, (x))), ETAG)
 
-static inline char *spirv_string_opcode_no_result(SPIRV_module *module, SpvOp op) {
-    char *result = NULL;
-    APPEND_FMT("%16s", "");
+static inline char *spirv_string_opcode_no_result(SPIRV_text_writer *writer, char *result, SpvOp op) {
+    arr_append_fill(result, ' ', 16);
     OP(op);
     return result;
 }
 
-static inline char *spirv_string_opcode_result_id(SPIRV_module *module, SpvOp op, uint32_t result_id) {
-    char *result = NULL;
-    const char *s_id = spirv_text_format_id(module, result_id);
+static inline char *spirv_string_opcode_result_id(SPIRV_text_writer *writer, char *result, SpvOp op, uint32_t result_id) {
+    const char *s_id = spirv_text_format_id(writer, result_id);
 
     /* try to right align the result-id in the first column */
     int spaces = 13 - (int) arr_len(s_id);
-    for (int i = 0; i < spaces; ++i) {
-        APPEND_STR(" ");
+    if (spaces > 0) {
+        arr_append_fill(result, ' ', (size_t) spaces);
     }
 
     FORMATTED_ID(s_id, result_id);
@@ -228,14 +233,13 @@ static inline char *spirv_string_opcode_result_id(SPIRV_module *module, SpvOp op
     return result;
 }
 
-static inline char *spirv_string_opcode_result_type_id(SPIRV_module *module, SpvOp op, uint32_t type_id) {
-    char *result = NULL;
-    const char *s_id = spirv_text_format_type_id(module, type_id);
+static inline char *spirv_string_opcode_result_type_id(SPIRV_text_writer *writer, char *result, SpvOp op, uint32_t type_id) {
+    const char *s_id = spirv_text_format_type_id(writer, type_id);
 
     /* try to right align the result-id in the first column */
     int spaces = 13 - (int) arr_len(s_id);
-    for (int i = 0; i < spaces; ++i) {
-        APPEND_STR(" ");
+    if (spaces > 0) {
+        arr_append_fill(result, ' ', (size_t) spaces);
     }
 
     FORMATTED_TYPE_ID(s_id, type_id);
@@ -247,67 +251,69 @@ static inline char *spirv_string_opcode_result_type_id(SPIRV_module *module, Spv
 static inline void spirv_string_bitmask(char **result, uint32_t bitmask, const char *names[]) {
 
     if (bitmask == 0) {
-        arr_printf(*result, " %s", names[0]);
+        arr_append_char(*result, ' ');
+        arr_append_str(*result, names[0]);
         return;
     }
 
-    const char *fmt = " %s";
+    char sep = ' ';
 
     for (int b = 0; b < 32; ++b) {
         uint32_t mask = 1 << b; 
         if ((bitmask & mask) == mask) {
-            arr_printf(*result, fmt, names[mask]);
-            fmt = "|%s";
+            arr_append_char(*result, sep);
+            arr_append_str(*result, names[mask]);
+            sep = '|';
         }
     }
 }
 
 #define TEXT_FUNC_SPECIAL_BEGIN(kind)       \
-    static inline char *spirv_text_##kind(SPIRV_module *module, SPIRV_opcode *opcode) {     \
-        assert(module);                     \
+    static inline char *spirv_text_##kind(SPIRV_text_writer *writer, SPIRV_opcode *opcode, char *output) {     \
+        assert(writer);                     \
         assert(opcode);
 
 #define TEXT_FUNC_SPECIAL_OP_NORES(kind)    \
     TEXT_FUNC_SPECIAL_BEGIN(kind)           \
-        char *result = spirv_string_opcode_no_result(module, kind);
+        char *result = spirv_string_opcode_no_result(writer, output, kind);
 
 #define TEXT_FUNC_SPECIAL_OP_RESID(kind)    \
     TEXT_FUNC_SPECIAL_BEGIN(kind)           \
-        char *result = spirv_string_opcode_result_id(module, kind, opcode->optional[1]);
+        char *result = spirv_string_opcode_result_id(writer, output, kind, opcode->optional[1]);
 
 #define TEXT_FUNC_SPECIAL_OP_RESTYPE(kind)  \
     TEXT_FUNC_SPECIAL_BEGIN(kind)           \
-        char *result = spirv_string_opcode_result_type_id(module, kind, opcode->optional[0]);
+        char *result = spirv_string_opcode_result_type_id(writer, output, kind, opcode->optional[0]);
 
 #define TEXT_FUNC_TYPE_NORES(type)          \
-    static inline char *spirv_text_##type(SPIRV_module *module, SPIRV_opcode *opcode) { \
-        assert(module);                     \
+    static inline char *spirv_text_##type(SPIRV_text_writer *writer, SPIRV_opcode *opcode, char *output) { \
+        assert(writer);                     \
         assert(opcode);                     \
-        char *result = spirv_string_opcode_no_result(module, opcode->op.kind);
+        char *result = spirv_string_opcode_no_result(writer, output, opcode->op.kind);
 
 #define TEXT_FUNC_TYPE_RESID(type)          \
-    static inline char *spirv_text_result_##type(SPIRV_module *module, SPIRV_opcode *opcode) { \
-        assert(module);                     \
+    static inline char *spirv_text_result_##type(SPIRV_text_writer *writer, SPIRV_opcode *opcode, char *output) { \
+        assert(writer);                     \
         assert(opcode);                     \
-        char *result = spirv_string_opcode_result_id(module, opcode->op.kind, opcode->optional[1]);
+        char *result = spirv_string_opcode_result_id(writer, output, opcode->op.kind, opcode->optional[1]);
 
 #define TEXT_FUNC_TYPE_RESTYPE(type)        \
-    static inline char *spirv_text_restype_##type(SPIRV_module *module, SPIRV_opcode *opcode) { \
-        assert(module);                     \
+    static inline char *spirv_text_restype_##type(SPIRV_text_writer *writer, SPIRV_opcode *opcode, char *output) { \
+        assert(writer);                     \
         assert(opcode);                     \
-        char *result = spirv_string_opcode_result_type_id(module, opcode->op.kind, opcode->optional[0]);
+        char *result = spirv_string_opcode_result_type_id(writer, output, opcode->op.kind, opcode->optional[0]);
 
 #define TEXT_FUNC_TYPE_N_RESID(type)        \
-    static inline char *spirv_text_result_##type(SPIRV_module *module, SPIRV_opcode *opcode, int n) {  \
-        assert(module);                     \
+    static inline char *spirv_text_result_##type(SPIRV_text_writer *writer, SPIRV_opcode *opcode, char *output, int n) {  \
+        assert(writer);                     \
         assert(opcode);                     \
-        char *result = spirv_string_opcode_result_id(module, opcode->op.kind, opcode->optional[0]);
+        char *result = spirv_string_opcode_result_id(writer, output, opcode->op.kind, opcode->optional[0]);
 
 #define TEXT_FUNC_TYPE_N_NORES(type)        \
-    static inline char *spirv_text_##type(SPIRV_module *module, SPIRV_opcode *opcode, int n) {  \
-        assert(module);                     \
+    static inline char *spirv_text_##type(SPIRV_text_writer *writer, SPIRV_opcode *opcode, char *output, int n) {  \
+        assert(writer);                     \
         assert(opcode);                     \
-        char *result = spirv_string_opcode_no_result(module, opcode->op.kind);
+        char *result = spirv_string_opcode_no_result(writer, output, opcode->op.kind);
 
 #define TEXT_FUNC_END   }
 
@@ -423,7 +429,7 @@ TEXT_FUNC_SPECIAL_OP_NORES(SpvOpExecutionModeId) {
 TEXT_FUNC_SPECIAL_OP_RESID(SpvOpConstant) {
     TYPE_ID(opcode->optional[0]);
 
-    Type *res_type = spirv_module_type_by_id(module, opcode->optional[0]);
+    Type *res_type = spirv_module_type_by_id(writer->module, opcode->optional[0]);
     
     if (spirv_type_is_float(res_type)) {
         for (int idx=2; idx < opcode->op.length - 1; ++idx) {
@@ -489,7 +495,7 @@ TEXT_FUNC_SPECIAL_OP_NORES(SpvOpStore) {
 } TEXT_FUNC_END
 
 TEXT_FUNC_SPECIAL_BEGIN(SpvOpCopyMemory) {
-    return spirv_text_SpvOpStore(module, opcode);
+    return spirv_text_SpvOpStore(writer, opcode, output);
 } TEXT_FUNC_END
 
 TEXT_FUNC_SPECIAL_OP_NORES(SpvOpCopyMemorySized) {
@@ -571,12 +577,12 @@ TEXT_FUNC_SPECIAL_OP_NORES(SpvOpSwitch) {
 } TEXT_FUNC_END
 
 TEXT_FUNC_SPECIAL_BEGIN(SpvOpLabel) {
-    char *result = spirv_string_opcode_result_id(module, opcode->op.kind, opcode->optional[0]);
+    char *result = spirv_string_opcode_result_id(writer, output, opcode->op.kind, opcode->optional[0]);
     return result;
 } TEXT_FUNC_END
 
 TEXT_FUNC_SPECIAL_BEGIN(SpvOpExtInstImport) {
-    char *result = spirv_string_opcode_result_id(module, opcode->op.kind, opcode->optional[0]);
+    char *result = spirv_string_opcode_result_id(writer, output, opcode->op.kind, opcode->optional[0]);
     LITERAL_STRING((const char *) &opcode->optional[1]);
     return result;
 } TEXT_FUNC_END
@@ -714,64 +720,27 @@ TEXT_FUNC_TYPE_NORES(id_groupop_id) {              /* OP %id <group-operation> %
     return result;
 } TEXT_FUNC_END
 
-///////////////////////////////////////////////////////////////////////////////
-//
-// public functions
-//
-
-int spirv_text_header_num_lines(SPIRV_header *header) {
-    return 3;
-}
-
-char *spirv_text_header_line(SPIRV_header *header, int line) {
-    char *result = NULL;
-
-    switch (line) {
-        case 0: 
-            arr_printf(result, "// Version: %d.%d", header->version_high, header->version_low);
-            break;
-        case 1: 
-            arr_printf(result, "// Generator: %d v%d", header->generator >> 16, header->generator & 0x0000ffff);
-            break;
-        case 2: 
-            arr_printf(result, "// Bound ids: %d", header->bound_ids);
-            break;
-        default:
-            assert(false);
-    }
-
-    return result;
-}
-
-void spirv_text_set_flag(struct SPIRV_module *module, SPIRV_text_flag flag, bool value) {
-    assert(module);
-
-    if (flag == SPIRV_TEXT_USE_ID_NAMES) {
-        module->text->use_id_names = value;
-    } else if (flag == SPIRV_TEXT_USE_TYPE_ALIAS) {
-        module->text->use_type_alias = value;
-    } else if (flag == SPIRV_TEXT_USE_CONSTANT_ALIAS) {
-        module->text->use_constant_alias = value;
-    }
-}
+/*
+ * dispatch an opcode to its text function
+ */
 
-char *spirv_text_opcode(SPIRV_opcode *opcode, SPIRV_module *module, SPIRV_text_span **spans) {
-#define OP_CASE_SPECIAL(op)                             \
-    case op:                                            \
-        line = spirv_text_##op(module, opcode);         \
+static char *spirv_text_writer_opcode(SPIRV_text_writer *writer, char *output, SPIRV_opcode *opcode) {
+#define OP_CASE_SPECIAL(op)                                     \
+    case op:                                                    \
+        line = spirv_text_##op(writer, opcode, output);         \
         break;
-#define OP_CASE_TYPE(op, type)                          \
-    case op:                                            \
-        line = spirv_text_##type(module, opcode);       \
+#define OP_CASE_TYPE(op, type)                                  \
+    case op:                                                    \
+        line = spirv_text_##type(writer, opcode, output);       \
         break;                      
-#define OP_CASE_TYPE_1(op, type, n)                     \
-    case op:                                            \
-        line = spirv_text_##type(module, opcode, n);    \
+#define OP_CASE_TYPE_1(op, type, n)                             \
+    case op:                                                    \
+        line = spirv_text_##type(writer, opcode, output, n);    \
         break;                      
 #define OP_DEFAULT(op)
 
-    arr_clear(module->text->spans);
-    char *line = NULL;
+    char *line = output;
+    MemTag prev_tag = mem_stats_set_tag(MemTagText);
 
     switch (opcode->op.kind) {
         // miscellaneous instructions
@@ -1127,13 +1096,10 @@ char *spirv_text_opcode(SPIRV_opcode *opcode, SPIRV_module *module, SPIRV_text_s
         OP_CASE_TYPE(SpvOpGetKernelMaxNumSubgroups, result_type_id_list)
 
         default :
-            line = spirv_string_opcode_no_result(module, opcode->op.kind);
-    }
-
-    if (spans) {
-        *spans = module->text->spans;
+            line = spirv_string_opcode_no_result(writer, output, opcode->op.kind);
     }
 
+    mem_stats_set_tag(prev_tag);
     return line;
 
 #undef OP_CASE_SPECIAL
@@ -1141,3 +1107,243 @@ char *spirv_text_opcode(SPIRV_opcode *opcode, SPIRV_module *module, SPIRV_text_s
 #undef OP_CASE_TYPE_1
 #undef OP_DEFAULT
 }
+
+static char *spirv_text_writer_range(SPIRV_text_writer *writer, char *output, uint32_t begin, uint32_t end) {
+    for (uint32_t idx = begin; idx < end; ++idx) {
+        output = spirv_text_writer_opcode(writer, output, spirv_module_opcode_by_index(writer->module, idx));
+        arr_append_char(output, '\n');
+    }
+    return output;
+}
+
+/*
+ * parallel disassembly: one task per function
+ */
+
+typedef struct TextJob {
+    uint32_t *ranges;               // dyn_array - index of the first opcode of each function + the number of opcodes
+    SPIRV_text_writer *writers;     // one per worker
+    char **outputs;                 // one per function
+    SPIRV_text_span **spans;        // one per function
+} TextJob;
+
+static void text_function_task(void *context, uint32_t index, uint32_t worker) {
+    TextJob *job = (TextJob *) context;
+    SPIRV_text_writer *writer = &job->writers[worker];
+
+    job->outputs[index] = spirv_text_writer_range(writer, NULL, job->ranges[index], job->ranges[index + 1]);
+
+    /* hand the spans of this function over to the job */
+    job->spans[index] = writer->spans;
+    writer->spans = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// public functions
+//
+
+int spirv_text_header_num_lines(SPIRV_header *header) {
+    return 3;
+}
+
+char *spirv_text_header_line(SPIRV_header *header, int line) {
+    return spirv_text_header_line_append(NULL, header, line);
+}
+
+char *spirv_text_header_line_append(char *result, SPIRV_header *header, int line) {
+    switch (line) {
+        case 0: 
+            arr_printf(result, "// Version: %d.%d", header->version_high, header->version_low);
+            break;
+        case 1: 
+            arr_printf(result, "// Generator: %d v%d", header->generator >> 16, header->generator & 0x0000ffff);
+            break;
+        case 2: 
+            arr_printf(result, "// Bound ids: %d", header->bound_ids);
+            break;
+        default:
+            assert(false);
+    }
+
+    return result;
+}
+
+void spirv_text_set_flag(struct SPIRV_module *module, SPIRV_text_flag flag, bool value) {
+    assert(module);
+
+    if (flag == SPIRV_TEXT_USE_ID_NAMES) {
+        module->text->use_id_names = value;
+    } else if (flag == SPIRV_TEXT_USE_TYPE_ALIAS) {
+        module->text->use_type_alias = value;
+    } else if (flag == SPIRV_TEXT_USE_CONSTANT_ALIAS) {
+        module->text->use_constant_alias = value;
+    }
+}
+
+char *spirv_text_opcode(SPIRV_opcode *opcode, SPIRV_module *module, SPIRV_text_span **spans) {
+    return spirv_text_opcode_append(NULL, opcode, module, spans);
+}
+
+char *spirv_text_opcode_append(char *output, SPIRV_opcode *opcode, SPIRV_module *module, SPIRV_text_span **spans) {
+    assert(opcode);
+    assert(module);
+
+    SPIRV_text_writer *writer = &module->text->writer;
+    writer->module = module;
+    writer->record_spans = spans != NULL;
+    arr_clear(writer->spans);
+
+    output = spirv_text_writer_opcode(writer, output, opcode);
+
+    if (spans) {
+        *spans = writer->spans;
+    }
+
+    return output;
+}
+
+
+char *spirv_text_module(char *output, SPIRV_module *module) {
+    assert(module);
+
+    SPIRV_header *header = spirv_bin_header(module->spirv_bin);
+
+    for (int idx = 0; idx < spirv_text_header_num_lines(header); ++idx) {
+        output = spirv_text_header_line_append(output, header, idx);
+        arr_append_char(output, '\n');
+    }
+
+    for (uint32_t idx = 0; idx < spirv_module_opcode_count(module); ++idx) {
+        output = spirv_text_opcode_append(output, spirv_module_opcode_by_index(module, idx), module, NULL);
+        arr_append_char(output, '\n');
+    }
+
+    return output;
+}
+
+bool spirv_text_module_to_file(SPIRV_module *module, FILE *fp) {
+    assert(module);
+    assert(fp);
+
+    /* the lines are collected in a buffer of bounded size that's written out when full,
+       memory use doesn't depend on the size of the module */
+    char *buffer = NULL;
+    bool ok = true;
+    SPIRV_header *header = spirv_bin_header(module->spirv_bin);
+
+    for (int idx = 0; idx < spirv_text_header_num_lines(header); ++idx) {
+        buffer = spirv_text_header_line_append(buffer, header, idx);
+        arr_append_char(buffer, '\n');
+    }
+
+    for (uint32_t idx = 0; ok && idx < spirv_module_opcode_count(module); ++idx) {
+        buffer = spirv_text_opcode_append(buffer, spirv_module_opcode_by_index(module, idx), module, NULL);
+        arr_append_char(buffer, '\n');
+
+        if (arr_len(buffer) >= SPIRV_TEXT_FLUSH_SIZE) {
+            ok = fwrite(buffer, 1, arr_len(buffer), fp) == arr_len(buffer);
+            arr_clear(buffer);
+        }
+    }
+
+    if (ok && arr_len(buffer) > 0) {
+        ok = fwrite(buffer, 1, arr_len(buffer), fp) == arr_len(buffer);
+    }
+
+    arr_free(buffer);
+    return ok;
+}
+
+char *spirv_text_module_parallel(char *output, SPIRV_module *module, uint32_t num_workers, SPIRV_text_span **spans) {
+    assert(module);
+    assert(num_workers > 0);
+
+    /* split the module at each OpFunction, everything before the first function is the global section */
+    uint32_t num_opcodes = (uint32_t) spirv_module_opcode_count(module);
+    uint32_t *ranges = NULL;
+
+    for (uint32_t idx = 0; idx < num_opcodes; ++idx) {
+        if (spirv_module_opcode_by_index(module, idx)->op.kind == SpvOpFunction) {
+            arr_push(ranges, idx);
+        }
+    }
+
+    uint32_t num_functions = (uint32_t) arr_len(ranges);
+    uint32_t global_end = (num_functions > 0) ? ranges[0] : num_opcodes;
+    arr_push(ranges, num_opcodes);
+
+    /* types and constants can only be declared in the global section: disassembling it first creates all the aliases
+       the functions refer to. The workers only look them up and leave the module untouched. */
+    SPIRV_text_writer *writer = &module->text->writer;
+    writer->module = module;
+    writer->record_spans = spans != NULL;
+    arr_clear(writer->spans);
+
+    SPIRV_header *header = spirv_bin_header(module->spirv_bin);
+
+    for (int idx = 0; idx < spirv_text_header_num_lines(header); ++idx) {
+        output = spirv_text_header_line_append(output, header, idx);
+        arr_append_char(output, '\n');
+    }
+
+    output = spirv_text_writer_range(writer, output, 0, global_end);
+
+    SPIRV_text_span *all_spans = NULL;
+    if (spans) {
+        arr_push_buf(all_spans, writer->spans, arr_len(writer->spans));
+    }
+
+    /* functions */
+    num_workers = MIN(num_workers, MAX(num_functions, 1u));
+
+    TextJob job = {
+        .ranges = ranges,
+        .writers = calloc(num_workers, sizeof(SPIRV_text_writer)),
+        .outputs = calloc(MAX(num_functions, 1u), sizeof(char *)),
+        .spans = calloc(MAX(num_functions, 1u), sizeof(SPIRV_text_span *))
+    };
+
+    for (uint32_t w = 0; w < num_workers; ++w) {
+        job.writers[w] = (SPIRV_text_writer) {
+            .module = module,
+            .record_spans = spans != NULL,
+            .read_only = true
+        };
+    }
+
+    thread_pool_run(num_workers, num_functions, text_function_task, &job);
+
+    /* concatenate in order */
+    for (uint32_t idx = 0; idx < num_functions; ++idx) {
+        uint32_t offset = (uint32_t) arr_len(output);
+
+        for (SPIRV_text_span *span = job.spans[idx]; span != arr_end(job.spans[idx]); ++span) {
+            SPIRV_text_span moved = *span;
+            moved.start += offset;
+            moved.end += offset;
+            arr_push(all_spans, moved);
+        }
+
+        arr_append_buf(output, job.outputs[idx], arr_len(job.outputs[idx]));
+
+        arr_free(job.outputs[idx]);
+        arr_free(job.spans[idx]);
+    }
+
+    for (uint32_t w = 0; w < num_workers; ++w) {
+        arr_free(job.writers[w].scratch_buf);
+        arr_free(job.writers[w].spans);
+    }
+
+    free(job.writers);
+    free(job.outputs);
+    free(job.spans);
+    arr_free(ranges);
+
+    if (spans) {
+        *spans = all_spans;
+    }
+
+    return output;
+}
@@ -6,14 +6,21 @@
 #define JS_SHADER_SIM_SPIRV_TEXT_H
 
 #include "types.h"
-#include "hash_map.h"
+#include <stdio.h>
+#include "intern.h"
+#include "typed_map.h"
 
 // require forward declarations
 struct SPIRV_header;
 struct SPIRV_opcode;
 struct SPIRV_module;
 
+// the streaming disassembler writes its output in chunks of (at least) this size
+#define SPIRV_TEXT_FLUSH_SIZE   (64 * 1024)
+
 // types
+TYPED_MAP_U32(AliasMap, alias_map, const char)
+
 typedef enum SPIRV_text_kind {
     SPAN_OP,
     SPAN_KEYWORD,
@@ -31,17 +38,25 @@ typedef struct SPIRV_text_span {
     uint32_t        id;
 } SPIRV_text_span;
 
-typedef struct SPIRV_text {
-    char *scratch_buf;
+// the mutable state of one disassembly thread
+typedef struct SPIRV_text_writer {
+    struct SPIRV_module *module;
+    char *scratch_buf;          // dyn_array
+
+    SPIRV_text_span *spans;     // dyn_array
+    bool record_spans;          // only when the caller asked for the spans
+    bool read_only;             // use the existing aliases but never create new ones (safe to share the module between threads)
+} SPIRV_text_writer;
 
+typedef struct SPIRV_text {
     bool use_id_names;
     bool use_type_alias;
     bool use_constant_alias;
 
-    SPIRV_text_span *spans;     // dyn_array
+    SPIRV_text_writer writer;   // used by the single-threaded interface functions
 
-    HashMap id_aliases;       // id (int) -> const char * (name)
-    HashMap id_aliases_rev;   // const char * (name) -> id (int)
+    AliasMap id_aliases;      // id (uint32_t) -> const char * (name)
+    InternTable alias_names;  // the aliases in use, an id only gets an alias that isn't in the table yet
 } SPIRV_text;
 
 typedef enum SPIRV_text_flag {
@@ -53,8 +68,20 @@ typedef enum SPIRV_text_flag {
 // interface functions
 int spirv_text_header_num_lines(struct SPIRV_header *header);
 char *spirv_text_header_line(struct SPIRV_header *header, int line);
+char *spirv_text_header_line_append(char *output, struct SPIRV_header *header, int line);
 
 void spirv_text_set_flag(struct SPIRV_module *module, SPIRV_text_flag flag, bool value);
 char *spirv_text_opcode(struct SPIRV_opcode *opcode, struct SPIRV_module *module, SPIRV_text_span **spans);
 
+// append to a dyn_array string instead of allocating a new one for each line (span offsets are relative to the start of output)
+char *spirv_text_opcode_append(char *output, struct SPIRV_opcode *opcode, struct SPIRV_module *module, SPIRV_text_span **spans);
+
+// disassemble a complete module (header + all opcodes, one line each)
+char *spirv_text_module(char *output, struct SPIRV_module *module);
+
+// disassemble the functions of a module on multiple threads, the output is identical to spirv_text_module.
+// When spans isn't NULL it receives a new dyn_array with the spans of all lines (owned by the caller).
+char *spirv_text_module_parallel(char *output, struct SPIRV_module *module, uint32_t num_workers, SPIRV_text_span **spans);
+bool spirv_text_module_to_file(struct SPIRV_module *module, FILE *fp);
+
 #endif // JS_SHADER_SIM_SPIRV_TEXT_H
\ No newline at end of file
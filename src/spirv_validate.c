@@ -0,0 +1,1307 @@
+// spirv_validate.c - Johan Smet - BSD-3-Clause (see LICENSE)
+
+#include "spirv_validate.h"
+#include "spirv_module.h"
+#include "spirv_binary.h"
+#include "spirv/spirv.h"
+#include "spirv/spirv_names.h"
+#include "spirv/GLSL.std.450.h"
+
+#include "dyn_array.h"
+#include "hash_map.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BLOCK_NONE  UINT32_MAX      // definitions that dominate the entire function (parameters, variables)
+
+typedef enum OpcodeClass {
+    OpcodeUnsupported = 0,
+    OpcodeNoResult,
+    OpcodeResult,
+    OpcodeTerminator
+} OpcodeClass;
+
+typedef enum OperandShape {
+    ShapeResult,                // the operands have the type of the result
+    ShapeCount,                 // the operands have as many components as the result
+    ShapeEqual                  // the operands have the same type, with as many components as the result
+} OperandShape;
+
+typedef bool (*TypePredicate)(Type *type);
+
+typedef struct Block {
+    uint32_t label_id;
+    uint32_t term_index;        // index of the terminator in the opcode array
+    uint32_t *succs;            // dyn_array - block indices
+    uint32_t *preds;            // dyn_array - block indices
+    uint32_t rpo;               // position in reverse post-order, BLOCK_NONE if the block can't be reached
+    uint32_t idom;              // immediate dominator
+} Block;
+
+typedef struct Definition {
+    Type *type;
+    uint32_t block;             // BLOCK_NONE for parameters and variables
+    uint32_t index;             // index of the defining instruction in the opcode array
+} Definition;
+
+typedef struct Validator {
+    SPIRV_module *module;
+    SPIRV_function *func;
+    char **error_msg;
+
+    Block *blocks;              // dyn_array - in the order of the binary, the first block is the entry
+    HashMap block_ids;          // label id -> block index + 1
+    Definition *defs;           // dyn_array
+    HashMap def_ids;            // id -> definition index + 1
+
+    SPIRV_opcode *op;           // instruction being validated
+    uint32_t op_index;
+    uint32_t block;             // block of the instruction being validated
+} Validator;
+
+/*
+ * helper functions
+ */
+
+static bool invalid(Validator *v, const char *fmt, ...) {
+    char reason[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(reason, sizeof(reason), fmt, args);
+    va_end(args);
+
+    char func_name[64];
+    const char *name = spirv_module_name_by_id(v->module, v->func->func.id, -1);
+    if (name) {
+        snprintf(func_name, sizeof(func_name), "%s", name);
+    } else {
+        snprintf(func_name, sizeof(func_name), "%%%d", v->func->func.id);
+    }
+
+    if (v->op) {
+        arr_printf(*v->error_msg, "Invalid function %s, instruction %d [%s]: %s",
+                   func_name, v->op_index, spirv_op_name(v->op->op.kind), reason);
+    } else {
+        arr_printf(*v->error_msg, "Invalid function %s: %s", func_name, reason);
+    }
+
+    return false;
+}
+
+static OpcodeClass opcode_class(SpvOp kind) {
+/* the instructions spirv_sim_step implements */
+    switch (kind) {
+        case SpvOpReturn:
+        case SpvOpReturnValue:
+        case SpvOpBranch:
+        case SpvOpBranchConditional:
+        case SpvOpSwitch:
+        case SpvOpUnreachable:
+            return OpcodeTerminator;
+
+        case SpvOpNop:
+        case SpvOpStore:
+        case SpvOpLoopMerge:
+        case SpvOpSelectionMerge:
+        case SpvOpLifetimeStart:
+        case SpvOpLifetimeStop:
+            return OpcodeNoResult;
+
+        case SpvOpExtInst:
+        case SpvOpLoad:
+        case SpvOpAccessChain:
+        case SpvOpFunctionCall:
+        case SpvOpConvertFToU:
+        case SpvOpConvertFToS:
+        case SpvOpConvertSToF:
+        case SpvOpConvertUToF:
+        case SpvOpUConvert:
+        case SpvOpSConvert:
+        case SpvOpFConvert:
+        case SpvOpConvertPtrToU:
+        case SpvOpSatConvertSToU:
+        case SpvOpSatConvertUToS:
+        case SpvOpConvertUToPtr:
+        case SpvOpVectorExtractDynamic:
+        case SpvOpVectorInsertDynamic:
+        case SpvOpVectorShuffle:
+        case SpvOpCompositeConstruct:
+        case SpvOpCompositeExtract:
+        case SpvOpCompositeInsert:
+        case SpvOpCopyObject:
+        case SpvOpTranspose:
+        case SpvOpSNegate:
+        case SpvOpFNegate:
+        case SpvOpIAdd:
+        case SpvOpFAdd:
+        case SpvOpISub:
+        case SpvOpFSub:
+        case SpvOpIMul:
+        case SpvOpFMul:
+        case SpvOpUDiv:
+        case SpvOpSDiv:
+        case SpvOpFDiv:
+        case SpvOpUMod:
+        case SpvOpSRem:
+        case SpvOpSMod:
+        case SpvOpFRem:
+        case SpvOpFMod:
+        case SpvOpVectorTimesScalar:
+        case SpvOpMatrixTimesScalar:
+        case SpvOpVectorTimesMatrix:
+        case SpvOpMatrixTimesVector:
+        case SpvOpMatrixTimesMatrix:
+        case SpvOpOuterProduct:
+        case SpvOpDot:
+        case SpvOpShiftRightLogical:
+        case SpvOpShiftRightArithmetic:
+        case SpvOpShiftLeftLogical:
+        case SpvOpBitwiseOr:
+        case SpvOpBitwiseXor:
+        case SpvOpBitwiseAnd:
+        case SpvOpNot:
+        case SpvOpBitFieldInsert:
+        case SpvOpBitFieldSExtract:
+        case SpvOpBitFieldUExtract:
+        case SpvOpBitReverse:
+        case SpvOpBitCount:
+        case SpvOpAny:
+        case SpvOpAll:
+        case SpvOpIsNan:
+        case SpvOpIsInf:
+        case SpvOpIsFinite:
+        case SpvOpIsNormal:
+        case SpvOpSignBitSet:
+        case SpvOpLessOrGreater:
+        case SpvOpOrdered:
+        case SpvOpUnordered:
+        case SpvOpLogicalEqual:
+        case SpvOpLogicalNotEqual:
+        case SpvOpLogicalOr:
+        case SpvOpLogicalAnd:
+        case SpvOpLogicalNot:
+        case SpvOpSelect:
+        case SpvOpIEqual:
+        case SpvOpINotEqual:
+        case SpvOpUGreaterThan:
+        case SpvOpSGreaterThan:
+        case SpvOpUGreaterThanEqual:
+        case SpvOpSGreaterThanEqual:
+        case SpvOpULessThan:
+        case SpvOpSLessThan:
+        case SpvOpULessThanEqual:
+        case SpvOpSLessThanEqual:
+        case SpvOpFOrdEqual:
+        case SpvOpFUnordEqual:
+        case SpvOpFOrdNotEqual:
+        case SpvOpFUnordNotEqual:
+        case SpvOpFOrdLessThan:
+        case SpvOpFUnordLessThan:
+        case SpvOpFOrdGreaterThan:
+        case SpvOpFUnordGreaterThan:
+        case SpvOpFOrdLessThanEqual:
+        case SpvOpFUnordLessThanEqual:
+        case SpvOpFOrdGreaterThanEqual:
+        case SpvOpFUnordGreaterThanEqual:
+            return OpcodeResult;
+
+        default:
+            return OpcodeUnsupported;
+    }
+}
+
+static inline bool type_is_bool(Type *type) {
+    return type->kind == TypeBool;
+}
+
+static inline bool type_is_pointer(Type *type) {
+    return type->kind == TypePointer;
+}
+
+static inline bool type_is_float_vector(Type *type) {
+    return type->kind == TypeVectorFloat;
+}
+
+static inline bool type_is_float_matrix(Type *type) {
+    return type->kind == TypeMatrixFloat;
+}
+
+static inline bool type_is_integer_scalar(Type *type) {
+    return type->kind == TypeInteger;
+}
+
+static inline bool type_is_unsigned_scalar(Type *type) {
+    return type->kind == TypeInteger && !type->is_signed;
+}
+
+static inline Type *parameter_type(SPIRV_module *module, SPIRV_function *func, uint32_t index) {
+/* the parameters directly follow OpFunction */
+    SPIRV_opcode *op = module->opcode_array[func->def_index + 1 + index];
+    return spirv_module_type_by_id(module, op->optional[0]);
+}
+
+static Type *composite_member(Validator *v, Type *type, uint32_t index, bool check_bounds) {
+/* type of a member of an aggregate, NULL if the index is out of range or the type isn't an aggregate */
+    switch (type->kind) {
+        case TypeStructure:
+            if (index < arr_len(type->structure.members)) {
+                return type->structure.members[index];
+            }
+            break;
+        case TypeArray:
+            if (!check_bounds || type->count == 0 || index < type->count) {
+                return type->base_type;
+            }
+            break;
+        case TypeVectorFloat:
+        case TypeVectorInteger:
+            if (!check_bounds || index < type->count) {
+                return type->base_type;
+            }
+            break;
+        case TypeMatrixFloat:
+        case TypeMatrixInteger:
+            if (!check_bounds || index < type->matrix.num_cols) {
+                return type->base_type;
+            }
+            break;
+        default:
+            invalid(v, "type %%%d isn't an aggregate", type->id);
+            return NULL;
+    }
+
+    invalid(v, "index %d is out of range for type %%%d", index, type->id);
+    return NULL;
+}
+
+/*
+ * dominators
+ */
+
+static bool block_dominates(Validator *v, uint32_t dominator, uint32_t block) {
+    while (block != dominator && block != 0) {
+        block = v->blocks[block].idom;
+    }
+    return block == dominator;
+}
+
+static bool definition_dominates_use(Validator *v, Definition *def) {
+    if (def->block == BLOCK_NONE) {
+        return true;
+    }
+
+    /* uses in unreachable blocks are never executed */
+    if (v->blocks[v->block].rpo == BLOCK_NONE) {
+        return true;
+    }
+
+    if (def->block == v->block) {
+        return def->index < v->op_index;
+    }
+
+    return v->blocks[def->block].rpo != BLOCK_NONE && block_dominates(v, def->block, v->block);
+}
+
+static uint32_t intersect_dominators(Validator *v, uint32_t b1, uint32_t b2) {
+    while (b1 != b2) {
+        while (v->blocks[b1].rpo > v->blocks[b2].rpo) {
+            b1 = v->blocks[b1].idom;
+        }
+        while (v->blocks[b2].rpo > v->blocks[b1].rpo) {
+            b2 = v->blocks[b2].idom;
+        }
+    }
+    return b1;
+}
+
+static void compute_dominators(Validator *v) {
+/* "A Simple, Fast Dominance Algorithm" (Cooper, Harvey & Kennedy) on the blocks in reverse post-order */
+    uint32_t num_blocks = (uint32_t) arr_len(v->blocks);
+    if (num_blocks == 0) {
+        return;     // validate_structure already rejected the function
+    }
+
+    /* depth first search from the entry block for the post-order */
+    uint32_t *post_order = NULL;
+    uint32_t *stack = NULL;
+    uint32_t *next_succ = NULL;
+    bool *visited = NULL;
+
+    arr_reserve(next_succ, num_blocks);
+    arr_reserve(visited, num_blocks);
+    memset(next_succ, 0, num_blocks * sizeof(uint32_t));
+    memset(visited, 0, num_blocks * sizeof(bool));
+
+    arr_push(stack, 0);
+    visited[0] = true;
+
+    while (arr_len(stack) > 0) {
+        uint32_t block = stack[arr_len(stack) - 1];
+
+        if (next_succ[block] < arr_len(v->blocks[block].succs)) {
+            uint32_t succ = v->blocks[block].succs[next_succ[block]++];
+            if (!visited[succ]) {
+                visited[succ] = true;
+                arr_push(stack, succ);
+            }
+        } else {
+            arr_push(post_order, block);
+            (void) arr_pop(stack);
+        }
+    }
+
+    uint32_t num_reachable = (uint32_t) arr_len(post_order);
+    for (uint32_t idx = 0; idx < num_reachable; ++idx) {
+        v->blocks[post_order[idx]].rpo = num_reachable - 1 - idx;
+    }
+
+    /* iterate until the immediate dominators are stable */
+    v->blocks[0].idom = 0;
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (uint32_t idx = num_reachable - 1; idx-- > 0; ) {
+            Block *block = &v->blocks[post_order[idx]];
+            uint32_t new_idom = BLOCK_NONE;
+
+            for (uint32_t *pred = block->preds; pred != arr_end(block->preds); ++pred) {
+                if (v->blocks[*pred].idom == BLOCK_NONE) {
+                    continue;
+                }
+                new_idom = (new_idom == BLOCK_NONE) ? *pred : intersect_dominators(v, *pred, new_idom);
+            }
+
+            if (block->idom != new_idom) {
+                block->idom = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    arr_free(post_order);
+    arr_free(stack);
+    arr_free(next_succ);
+    arr_free(visited);
+}
+
+/*
+ * validation passes
+ */
+
+static bool define_local(Validator *v, uint32_t id, Type *type, uint32_t block) {
+    if (map_int_int_has(&v->def_ids, id)) {
+        return invalid(v, "%%%d is defined more than once", id);
+    }
+
+    if (id < v->module->id_bound && v->module->ids[id].kind != IdNone &&
+        v->module->ids[id].kind != IdVariable && v->module->ids[id].kind != IdLabel) {
+        return invalid(v, "%%%d is already defined outside of the function", id);
+    }
+
+    arr_push(v->defs, ((Definition) {.type = type, .block = block, .index = v->op_index}));
+    map_int_int_put(&v->def_ids, id, arr_len(v->defs));
+    return true;
+}
+
+static bool validate_structure(Validator *v) {
+/* split the function in blocks and collect the local definitions */
+    SPIRV_module *module = v->module;
+
+    v->op_index = v->func->def_index;
+    v->op = module->opcode_array[v->op_index];
+
+    Type *func_type = v->func->func.type;
+    if (func_type == NULL || func_type->kind != TypeFunction || func_type->function.return_type == NULL) {
+        return invalid(v, "the type of the function isn't a valid function type");
+    }
+
+    bool in_block = false;
+    bool variables_allowed = true;      // variables have to be declared at the start of the first block
+    uint32_t num_params = 0;
+
+    for (v->op_index = v->func->def_index + 1; v->op_index < arr_len(module->opcode_array); ++v->op_index) {
+        v->op = module->opcode_array[v->op_index];
+        SpvOp kind = v->op->op.kind;
+
+        if (kind == SpvOpFunctionEnd) {
+            break;
+        }
+
+        if (kind == SpvOpFunctionParameter) {
+            if (arr_len(v->blocks) > 0) {
+                return invalid(v, "parameters have to precede the first block");
+            }
+            Type *type = spirv_module_type_by_id(module, v->op->optional[0]);
+            if (type == NULL) {
+                return invalid(v, "result type %%%d isn't a type", v->op->optional[0]);
+            }
+            if (!define_local(v, v->op->optional[1], type, BLOCK_NONE)) {
+                return false;
+            }
+            ++num_params;
+            continue;
+        }
+
+        if (kind == SpvOpLabel) {
+            if (in_block) {
+                return invalid(v, "the previous block doesn't end with a branch or return instruction");
+            }
+            if (map_int_int_has(&v->block_ids, v->op->optional[0])) {
+                return invalid(v, "label %%%d is defined more than once", v->op->optional[0]);
+            }
+            arr_push(v->blocks, ((Block) {.label_id = v->op->optional[0], .rpo = BLOCK_NONE, .idom = BLOCK_NONE}));
+            map_int_int_put(&v->block_ids, v->op->optional[0], arr_len(v->blocks));
+            in_block = true;
+            continue;
+        }
+
+        if (!in_block) {
+            return invalid(v, "instruction outside of a block");
+        }
+
+        uint32_t block = (uint32_t) arr_len(v->blocks) - 1;
+
+        if (kind == SpvOpVariable) {
+            if (!variables_allowed) {
+                return invalid(v, "variables have to be declared at the start of the first block");
+            }
+            Variable *var = spirv_module_variable_by_id(module, v->op->optional[1]);
+            if (var == NULL || var->kind != ClassFunction) {
+                return invalid(v, "variables of a function should have the Function storage class");
+            }
+            if (!define_local(v, v->op->optional[1], var->type, BLOCK_NONE)) {
+                return false;
+            }
+            continue;
+        }
+
+        variables_allowed = false;
+
+        switch (opcode_class(kind)) {
+            case OpcodeUnsupported:
+                return invalid(v, "the instruction isn't supported");
+            case OpcodeResult:
+                if (v->op->op.length < 3) {
+                    return invalid(v, "missing result");
+                }
+                if (!define_local(v, v->op->optional[1], spirv_module_type_by_id(module, v->op->optional[0]), block)) {
+                    return false;
+                }
+                break;
+            case OpcodeTerminator:
+                v->blocks[block].term_index = v->op_index;
+                in_block = false;
+                break;
+            case OpcodeNoResult:
+                break;
+        }
+    }
+
+    if (v->op_index >= arr_len(module->opcode_array)) {
+        v->op = NULL;
+        return invalid(v, "missing OpFunctionEnd");
+    }
+
+    if (in_block) {
+        return invalid(v, "the last block doesn't end with a branch or return instruction");
+    }
+
+    if (arr_len(v->blocks) == 0) {
+        return invalid(v, "the function doesn't have a body");
+    }
+
+    if (arr_len(v->func->func.parameter_ids) != num_params) {
+        v->op = NULL;
+        return invalid(v, "the parameters don't match the declaration of the function");
+    }
+
+    return true;
+}
+
+static bool add_branch_target(Validator *v, uint32_t block, uint32_t word) {
+    if (word >= v->op->op.length - 1u) {
+        return invalid(v, "missing branch target");
+    }
+
+    uint32_t target = (uint32_t) map_int_int_get(&v->block_ids, v->op->optional[word]);
+    if (target == 0) {
+        return invalid(v, "branch target %%%d isn't a block of the function", v->op->optional[word]);
+    }
+
+    arr_push(v->blocks[block].succs, target - 1);
+    arr_push(v->blocks[target - 1].preds, block);
+    return true;
+}
+
+static bool validate_control_flow(Validator *v) {
+/* build the control flow graph from the terminators of the blocks */
+    for (uint32_t block = 0; block < arr_len(v->blocks); ++block) {
+        v->op_index = v->blocks[block].term_index;
+        v->op = v->module->opcode_array[v->op_index];
+
+        switch (v->op->op.kind) {
+            case SpvOpBranch:
+                if (!add_branch_target(v, block, 0)) {
+                    return false;
+                }
+                break;
+            case SpvOpBranchConditional:
+                if (!add_branch_target(v, block, 1) || !add_branch_target(v, block, 2)) {
+                    return false;
+                }
+                break;
+            case SpvOpSwitch:
+                if ((v->op->op.length - 3) % 2 != 0) {
+                    return invalid(v, "the cases should be pairs of a literal and a label");
+                }
+                for (uint32_t word = 1; word < v->op->op.length - 1u; word += 2) {
+                    if (!add_branch_target(v, block, word)) {
+                        return false;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    compute_dominators(v);
+    return true;
+}
+
+/*
+ * instructions
+ */
+
+static Type *result_type(Validator *v) {
+    Type *type = spirv_module_type_by_id(v->module, v->op->optional[0]);
+    if (type == NULL) {
+        invalid(v, "result type %%%d isn't a type", v->op->optional[0]);
+    }
+    return type;
+}
+
+static Type *operand_type(Validator *v, uint32_t word) {
+/* type of the value used as an operand (word indexes op->optional), NULL when it isn't a valid operand */
+    if (word >= v->op->op.length - 1u) {
+        invalid(v, "missing operand");
+        return NULL;
+    }
+
+    uint32_t id = v->op->optional[word];
+    uint32_t def_idx = (uint32_t) map_int_int_get(&v->def_ids, id);
+
+    if (def_idx > 0) {
+        Definition *def = &v->defs[def_idx - 1];
+        if (!definition_dominates_use(v, def)) {
+            invalid(v, "the definition of %%%d doesn't dominate its use", id);
+            return NULL;
+        }
+        if (def->type == NULL) {
+            invalid(v, "%%%d doesn't have a valid type", id);
+        }
+        return def->type;
+    }
+
+    if (id < v->module->id_bound) {
+        SPIRV_id *entry = &v->module->ids[id];
+        if (entry->kind == IdConstant) {
+            return entry->constant->type;
+        } else if (entry->kind == IdVariable && entry->variable->kind != ClassFunction) {
+            return entry->variable->type;
+        }
+    }
+
+    invalid(v, "%%%d isn't defined", id);
+    return NULL;
+}
+
+static bool label_operand(Validator *v, uint32_t word) {
+    if (word >= v->op->op.length - 1u || !map_int_int_has(&v->block_ids, v->op->optional[word])) {
+        return invalid(v, "operand %d should be a block of the function", word);
+    }
+    return true;
+}
+
+#define RESULT(res)                         \
+    Type *res = result_type(v);             \
+    if (res == NULL) return false;
+
+#define OPERAND(type, word)                 \
+    Type *type = operand_type(v, (word));   \
+    if (type == NULL) return false;
+
+#define CHECK(cond, ...)                    \
+    if (!(cond)) return invalid(v, __VA_ARGS__);
+
+static bool validate_unary(Validator *v, TypePredicate res_pred, TypePredicate op_pred, OperandShape shape) {
+    RESULT(res);
+    OPERAND(op_type, 2);
+
+    CHECK(res_pred(res), "unsupported result type");
+    CHECK(op_pred(op_type), "unsupported operand type");
+    CHECK((shape == ShapeResult) ? op_type == res : op_type->count == res->count, "the operand doesn't match the result type");
+    return true;
+}
+
+static bool validate_binary(Validator *v, TypePredicate res_pred, TypePredicate op_pred, OperandShape shape) {
+    RESULT(res);
+    OPERAND(op1_type, 2);
+    OPERAND(op2_type, 3);
+
+    CHECK(res_pred(res), "unsupported result type");
+    CHECK(op_pred(op1_type) && op_pred(op2_type), "unsupported operand type");
+
+    if (shape == ShapeResult) {
+        CHECK(op1_type == res && op2_type == res, "the operands don't match the result type");
+    } else {
+        CHECK(op1_type->count == res->count && op2_type->count == res->count, "the operands don't match the result type");
+        CHECK(shape != ShapeEqual || op1_type == op2_type, "the operands should have the same type");
+    }
+    return true;
+}
+
+static bool validate_conversion(Validator *v, TypePredicate res_pred, TypePredicate op_pred) {
+    RESULT(res);
+    OPERAND(op_type, 2);
+
+    CHECK(res_pred(res) && op_pred(op_type), "unsupported conversion");
+    CHECK(res->kind == TypePointer || op_type->kind == TypePointer || op_type->count == res->count,
+          "the operand doesn't match the result type");
+    return true;
+}
+
+static bool validate_access_chain(Validator *v) {
+    RESULT(res);
+    OPERAND(base, 2);
+
+    CHECK(type_is_pointer(res) && type_is_pointer(base), "the result and the base should be pointers");
+
+    Type *type = base->base_type;
+
+    for (uint32_t word = 3; word < v->op->op.length - 1u; ++word) {
+        OPERAND(index, word);
+        CHECK(type_is_integer_scalar(index), "the indices should be integer scalars");
+
+        uint32_t member = 0;
+        if (type->kind == TypeStructure) {
+            Constant *constant = spirv_module_constant_by_id(v->module, v->op->optional[word]);
+            CHECK(constant != NULL, "indices into a structure should be constants");
+            member = constant->value.as_uint;
+        }
+
+        /* indices into arrays, vectors and matrices are only known during execution */
+        type = composite_member(v, type, member, type->kind == TypeStructure);
+        if (type == NULL) {
+            return false;
+        }
+    }
+
+    CHECK(res->base_type == type, "the result type doesn't point to the selected member");
+    return true;
+}
+
+static Type *composite_indices_type(Validator *v, Type *type, uint32_t first_word) {
+    for (uint32_t word = first_word; word < v->op->op.length - 1u && type != NULL; ++word) {
+        type = composite_member(v, type, v->op->optional[word], true);
+    }
+    return type;
+}
+
+static bool validate_composite_construct(Validator *v) {
+    RESULT(res);
+    uint32_t num_constituents = v->op->op.length - 3;
+
+    if (res->kind == TypeStructure) {
+        CHECK(arr_len(res->structure.members) == num_constituents, "wrong number of constituents");
+        for (uint32_t c = 0; c < num_constituents; ++c) {
+            OPERAND(c_type, 2 + c);
+            CHECK(c_type == res->structure.members[c], "constituent %d doesn't match the member type", c);
+        }
+    } else if (res->kind == TypeArray) {
+        CHECK(res->count == num_constituents, "wrong number of constituents");
+        for (uint32_t c = 0; c < num_constituents; ++c) {
+            OPERAND(c_type, 2 + c);
+            CHECK(c_type == res->base_type, "constituent %d doesn't match the element type", c);
+        }
+    } else if (spirv_type_is_vector(res)) {
+        uint32_t num_components = 0;
+        for (uint32_t c = 0; c < num_constituents; ++c) {
+            OPERAND(c_type, 2 + c);
+            CHECK(c_type == res->base_type || c_type->base_type == res->base_type,
+                  "constituent %d doesn't match the component type", c);
+            num_components += c_type->count;
+        }
+        CHECK(num_components == res->count, "the constituents don't have as many components as the result");
+    } else if (spirv_type_is_matrix(res)) {
+        CHECK(res->matrix.num_cols == num_constituents, "wrong number of constituents");
+        for (uint32_t c = 0; c < num_constituents; ++c) {
+            OPERAND(c_type, 2 + c);
+            CHECK(c_type == res->base_type, "constituent %d doesn't match the column type", c);
+        }
+    } else {
+        return invalid(v, "unsupported result type");
+    }
+
+    return true;
+}
+
+static bool validate_function_call(Validator *v) {
+    RESULT(res);
+    CHECK(v->op->op.length >= 4, "missing function");
+
+    SPIRV_function *callee = spirv_module_function_by_id(v->module, v->op->optional[2]);
+    CHECK(callee != NULL, "%%%d isn't a function", v->op->optional[2]);
+    CHECK(callee->func.type != NULL && callee->func.type->kind == TypeFunction &&
+          callee->func.type->function.return_type == res, "the result type doesn't match the return type of the function");
+
+    spirv_module_function_prepare(v->module, callee);
+    uint32_t num_args = v->op->op.length - 4;
+    CHECK(arr_len(callee->func.parameter_ids) == num_args, "the function expects %d arguments", (int) arr_len(callee->func.parameter_ids));
+
+    for (uint32_t arg = 0; arg < num_args; ++arg) {
+        OPERAND(arg_type, 3 + arg);
+        CHECK(arg_type == parameter_type(v->module, callee, arg), "argument %d doesn't match the parameter type", arg);
+    }
+
+    return true;
+}
+
+static bool validate_extinst(Validator *v) {
+/* only GLSL.std.450 is implemented by the simulator */
+    RESULT(res);
+    CHECK(v->op->op.length >= 5, "missing extended instruction");
+
+    uint32_t set_id = v->op->optional[2];
+    CHECK(set_id < v->module->id_bound && v->module->ids[set_id].kind == IdExtInstSet &&
+          !strcmp(v->module->ids[set_id].extinst_set, "GLSL.std.450"), "unsupported extended instruction set");
+
+    uint32_t inst = v->op->optional[3];
+
+    switch (inst) {
+        case GLSLstd450Round:
+        case GLSLstd450RoundEven:
+        case GLSLstd450Trunc:
+        case GLSLstd450FAbs:
+        case GLSLstd450FSign:
+        case GLSLstd450Floor:
+        case GLSLstd450Ceil:
+        case GLSLstd450Fract:
+        case GLSLstd450Radians:
+        case GLSLstd450Degrees:
+        case GLSLstd450Sin:
+        case GLSLstd450Cos:
+        case GLSLstd450Tan:
+        case GLSLstd450Asin:
+        case GLSLstd450Acos:
+        case GLSLstd450Atan:
+        case GLSLstd450Sinh:
+        case GLSLstd450Cosh:
+        case GLSLstd450Tanh:
+        case GLSLstd450Asinh:
+        case GLSLstd450Acosh:
+        case GLSLstd450Atanh:
+        case GLSLstd450Exp:
+        case GLSLstd450Log:
+        case GLSLstd450Exp2:
+        case GLSLstd450Log2:
+        case GLSLstd450Sqrt:
+        case GLSLstd450InverseSqrt:
+        case GLSLstd450Normalize: {
+            OPERAND(x, 4);
+            CHECK(spirv_type_is_float(x) && x == res, "the operand and the result should have the same floating point type");
+            break;
+        }
+
+        case GLSLstd450SAbs:
+        case GLSLstd450SSign: {
+            OPERAND(x, 4);
+            CHECK(spirv_type_is_signed_integer(x) && x == res, "the operand and the result should have the same signed integer type");
+            break;
+        }
+
+        case GLSLstd450Atan2:
+        case GLSLstd450Pow: {
+            OPERAND(x, 4);
+            OPERAND(y, 5);
+            CHECK(spirv_type_is_float(x) && x == res && y == res, "the operands and the result should have the same floating point type");
+            break;
+        }
+
+        case GLSLstd450Length: {
+            OPERAND(x, 4);
+            CHECK(type_is_float_vector(x) && x->base_type == res, "the operand should be a floating point vector of the result type");
+            break;
+        }
+
+        case GLSLstd450Distance: {
+            OPERAND(p0, 4);
+            OPERAND(p1, 5);
+            CHECK(type_is_float_vector(p0) && p1 == p0 && p0->base_type == res, "the operands should be floating point vectors of the result type");
+            break;
+        }
+
+        default:
+            return invalid(v, "GLSL.std.450 instruction %d isn't supported", inst);
+    }
+
+    return true;
+}
+
+static bool validate_instruction(Validator *v) {
+    SPIRV_opcode *op = v->op;
+    Type *return_type = v->func->func.type->function.return_type;
+
+    switch (op->op.kind) {
+        case SpvOpNop:
+        case SpvOpUnreachable:
+        case SpvOpLifetimeStart:
+        case SpvOpLifetimeStop:
+        case SpvOpBranch:
+            /* branch targets are checked while building the control flow graph */
+            return true;
+
+        case SpvOpLoopMerge:
+            return label_operand(v, 0) && label_operand(v, 1);
+
+        case SpvOpSelectionMerge:
+            return label_operand(v, 0);
+
+        case SpvOpBranchConditional: {
+            OPERAND(cond, 0);
+            CHECK(type_is_bool(cond), "the condition should be a boolean");
+            return true;
+        }
+
+        case SpvOpSwitch: {
+            OPERAND(selector, 0);
+            CHECK(type_is_integer_scalar(selector), "the selector should be an integer scalar");
+            return true;
+        }
+
+        case SpvOpReturn:
+            CHECK(return_type && return_type->kind == TypeVoid, "the function should return a value");
+            return true;
+
+        case SpvOpReturnValue: {
+            OPERAND(value, 0);
+            CHECK(value == return_type, "the value doesn't match the return type of the function");
+            return true;
+        }
+
+        case SpvOpExtInst:
+            return validate_extinst(v);
+
+        case SpvOpLoad: {
+            RESULT(res);
+            OPERAND(pointer, 2);
+            CHECK(type_is_pointer(pointer) && pointer->base_type == res, "the pointer doesn't point to the result type");
+            return true;
+        }
+
+        case SpvOpStore: {
+            OPERAND(pointer, 0);
+            OPERAND(object, 1);
+            CHECK(type_is_pointer(pointer) && pointer->base_type == object, "the pointer doesn't point to the type of the object");
+            return true;
+        }
+
+        case SpvOpAccessChain:
+            return validate_access_chain(v);
+
+        case SpvOpFunctionCall:
+            return validate_function_call(v);
+
+        /* conversion instructions */
+        case SpvOpConvertFToU:
+        case SpvOpSatConvertSToU:
+        case SpvOpUConvert:
+            return validate_conversion(v, spirv_type_is_unsigned_integer,
+                                       (op->op.kind == SpvOpConvertFToU) ? spirv_type_is_float :
+                                       (op->op.kind == SpvOpSatConvertSToU) ? spirv_type_is_signed_integer : spirv_type_is_unsigned_integer);
+        case SpvOpConvertFToS:
+            return validate_conversion(v, spirv_type_is_signed_integer, spirv_type_is_float);
+        case SpvOpSatConvertUToS:
+            return validate_conversion(v, spirv_type_is_signed_integer, spirv_type_is_unsigned_integer);
+        case SpvOpSConvert:
+            return validate_conversion(v, spirv_type_is_signed_integer, spirv_type_is_signed_integer);
+        case SpvOpConvertSToF:
+            return validate_conversion(v, spirv_type_is_float, spirv_type_is_signed_integer);
+        case SpvOpConvertUToF:
+            return validate_conversion(v, spirv_type_is_float, spirv_type_is_unsigned_integer);
+        case SpvOpFConvert:
+            return validate_conversion(v, spirv_type_is_float, spirv_type_is_float);
+        case SpvOpConvertPtrToU:
+            return validate_conversion(v, type_is_unsigned_scalar, type_is_pointer);
+        case SpvOpConvertUToPtr:
+            return validate_conversion(v, type_is_pointer, type_is_unsigned_scalar);
+
+        /* composite instructions */
+        case SpvOpVectorExtractDynamic: {
+            RESULT(res);
+            OPERAND(vector, 2);
+            OPERAND(index, 3);
+            CHECK(spirv_type_is_vector(vector) && vector->base_type == res, "the vector doesn't have components of the result type");
+            CHECK(type_is_integer_scalar(index), "the index should be an integer scalar");
+            return true;
+        }
+
+        case SpvOpVectorInsertDynamic: {
+            RESULT(res);
+            OPERAND(vector, 2);
+            OPERAND(component, 3);
+            OPERAND(index, 4);
+            CHECK(spirv_type_is_vector(res) && vector == res, "the vector should have the result type");
+            CHECK(component == res->base_type, "the component doesn't match the component type of the vector");
+            CHECK(type_is_integer_scalar(index), "the index should be an integer scalar");
+            return true;
+        }
+
+        case SpvOpVectorShuffle: {
+            RESULT(res);
+            OPERAND(vector_1, 2);
+            OPERAND(vector_2, 3);
+            CHECK(spirv_type_is_vector(res) && spirv_type_is_vector(vector_1) && spirv_type_is_vector(vector_2),
+                  "the operands and the result should be vectors");
+            CHECK(vector_1->base_type == res->base_type && vector_2->base_type == res->base_type,
+                  "the vectors should have the component type of the result");
+            CHECK(op->op.length - 5u == res->count, "the number of components doesn't match the result type");
+            for (uint32_t word = 4; word < op->op.length - 1u; ++word) {
+                CHECK(op->optional[word] == 0xFFFFFFFF || op->optional[word] < vector_1->count + vector_2->count,
+                      "component %d is out of range", op->optional[word]);
+            }
+            return true;
+        }
+
+        case SpvOpCompositeConstruct:
+            return validate_composite_construct(v);
+
+        case SpvOpCompositeExtract: {
+            RESULT(res);
+            OPERAND(composite, 2);
+            Type *member = composite_indices_type(v, composite, 3);
+            if (member == NULL) {
+                return false;
+            }
+            CHECK(member == res, "the selected member doesn't have the result type");
+            return true;
+        }
+
+        case SpvOpCompositeInsert: {
+            RESULT(res);
+            OPERAND(object, 2);
+            OPERAND(composite, 3);
+            CHECK(composite == res, "the composite should have the result type");
+            Type *member = composite_indices_type(v, composite, 4);
+            if (member == NULL) {
+                return false;
+            }
+            CHECK(member == object, "the object doesn't match the type of the selected member");
+            return true;
+        }
+
+        case SpvOpCopyObject: {
+            RESULT(res);
+            OPERAND(operand, 2);
+            CHECK(operand == res, "the operand should have the result type");
+            return true;
+        }
+
+        case SpvOpTranspose: {
+            RESULT(res);
+            OPERAND(matrix, 2);
+            CHECK(spirv_type_is_matrix(res) && spirv_type_is_matrix(matrix), "the operand and the result should be matrices");
+            CHECK(res->base_type->base_type == matrix->base_type->base_type &&
+                  res->matrix.num_cols == matrix->matrix.num_rows &&
+                  res->matrix.num_rows == matrix->matrix.num_cols, "the result isn't the transpose of the operand");
+            return true;
+        }
+
+        /* arithmetic instructions */
+        case SpvOpFNegate:
+            return validate_unary(v, spirv_type_is_float, spirv_type_is_float, ShapeResult);
+        case SpvOpSNegate:
+            return validate_unary(v, spirv_type_is_integer, spirv_type_is_integer, ShapeCount);
+
+        case SpvOpFAdd:
+        case SpvOpFSub:
+        case SpvOpFMul:
+        case SpvOpFDiv:
+        case SpvOpFRem:
+        case SpvOpFMod:
+            return validate_binary(v, spirv_type_is_float, spirv_type_is_float, ShapeResult);
+
+        case SpvOpIAdd:
+        case SpvOpISub:
+        case SpvOpIMul:
+            return validate_binary(v, spirv_type_is_integer, spirv_type_is_integer, ShapeCount);
+        case SpvOpUDiv:
+        case SpvOpUMod:
+            return validate_binary(v, spirv_type_is_unsigned_integer, spirv_type_is_integer, ShapeCount);
+        case SpvOpSDiv:
+        case SpvOpSRem:
+        case SpvOpSMod:
+            return validate_binary(v, spirv_type_is_signed_integer, spirv_type_is_integer, ShapeCount);
+
+        case SpvOpVectorTimesScalar: {
+            RESULT(res);
+            OPERAND(vector, 2);
+            OPERAND(scalar, 3);
+            CHECK(type_is_float_vector(res) && vector == res && scalar == res->base_type,
+                  "expected a floating point vector and a scalar of its component type");
+            return true;
+        }
+
+        case SpvOpMatrixTimesScalar: {
+            RESULT(res);
+            OPERAND(matrix, 2);
+            OPERAND(scalar, 3);
+            CHECK(type_is_float_matrix(res) && matrix == res && scalar == res->base_type->base_type,
+                  "expected a floating point matrix and a scalar of its component type");
+            return true;
+        }
+
+        case SpvOpVectorTimesMatrix: {
+            RESULT(res);
+            OPERAND(vector, 2);
+            OPERAND(matrix, 3);
+            CHECK(type_is_float_vector(res) && type_is_float_vector(vector) && type_is_float_matrix(matrix),
+                  "expected a floating point vector and matrix");
+            CHECK(vector->count == matrix->matrix.num_rows && res->count == matrix->matrix.num_cols,
+                  "the dimensions of the operands don't match");
+            return true;
+        }
+
+        case SpvOpMatrixTimesVector: {
+            RESULT(res);
+            OPERAND(matrix, 2);
+            OPERAND(vector, 3);
+            CHECK(type_is_float_vector(res) && type_is_float_matrix(matrix) && type_is_float_vector(vector),
+                  "expected a floating point matrix and vector");
+            CHECK(vector->count == matrix->matrix.num_cols && res->count == matrix->matrix.num_rows,
+                  "the dimensions of the operands don't match");
+            return true;
+        }
+
+        case SpvOpMatrixTimesMatrix: {
+            RESULT(res);
+            OPERAND(left, 2);
+            OPERAND(right, 3);
+            CHECK(type_is_float_matrix(res) && type_is_float_matrix(left) && type_is_float_matrix(right),
+                  "expected floating point matrices");
+            CHECK(left->matrix.num_cols == right->matrix.num_rows &&
+                  res->matrix.num_rows == left->matrix.num_rows &&
+                  res->matrix.num_cols == right->matrix.num_cols, "the dimensions of the operands don't match");
+            return true;
+        }
+
+        case SpvOpOuterProduct: {
+            RESULT(res);
+            OPERAND(vector_1, 2);
+            OPERAND(vector_2, 3);
+            CHECK(type_is_float_matrix(res) && type_is_float_vector(vector_1) && type_is_float_vector(vector_2),
+                  "expected floating point vectors");
+            CHECK(res->matrix.num_rows == vector_1->count && res->matrix.num_cols == vector_2->count,
+                  "the dimensions of the operands don't match");
+            return true;
+        }
+
+        case SpvOpDot: {
+            RESULT(res);
+            OPERAND(vector_1, 2);
+            OPERAND(vector_2, 3);
+            CHECK(type_is_float_vector(vector_1) && vector_2 == vector_1 && vector_1->base_type == res,
+                  "expected floating point vectors of the same type");
+            return true;
+        }
+
+        /* bit instructions */
+        case SpvOpShiftRightLogical:
+        case SpvOpShiftRightArithmetic:
+        case SpvOpShiftLeftLogical:
+        case SpvOpBitwiseOr:
+        case SpvOpBitwiseXor:
+        case SpvOpBitwiseAnd:
+            return validate_binary(v, spirv_type_is_integer, spirv_type_is_integer, ShapeCount);
+
+        case SpvOpNot:
+        case SpvOpBitReverse:
+        case SpvOpBitCount:
+            return validate_unary(v, spirv_type_is_integer, spirv_type_is_integer, ShapeCount);
+
+        case SpvOpBitFieldInsert:
+        case SpvOpBitFieldSExtract:
+        case SpvOpBitFieldUExtract: {
+            RESULT(res);
+            uint32_t word = 2;
+            OPERAND(base, word++);
+            CHECK(spirv_type_is_integer(res) && spirv_type_is_integer(base) && base->count == res->count,
+                  "the base should be an integer with as many components as the result");
+            if (op->op.kind == SpvOpBitFieldInsert) {
+                OPERAND(insert, word++);
+                CHECK(spirv_type_is_integer(insert) && insert->count == res->count,
+                      "the insert should be an integer with as many components as the result");
+            }
+            OPERAND(offset, word++);
+            OPERAND(count, word++);
+            CHECK(type_is_integer_scalar(offset) && type_is_integer_scalar(count), "offset and count should be integer scalars");
+            return true;
+        }
+
+        /* relational and logical instructions */
+        case SpvOpAny:
+        case SpvOpAll: {
+            RESULT(res);
+            OPERAND(vector, 2);
+            CHECK(type_is_bool(res) && res->count == 1 && type_is_bool(vector), "expected a boolean operand and result");
+            return true;
+        }
+
+        case SpvOpIsNan:
+        case SpvOpIsInf:
+        case SpvOpIsFinite:
+        case SpvOpIsNormal:
+        case SpvOpSignBitSet:
+            return validate_unary(v, type_is_bool, spirv_type_is_float, ShapeCount);
+
+        case SpvOpLessOrGreater:
+        case SpvOpOrdered:
+        case SpvOpUnordered:
+        case SpvOpFOrdEqual:
+        case SpvOpFUnordEqual:
+        case SpvOpFOrdNotEqual:
+        case SpvOpFUnordNotEqual:
+        case SpvOpFOrdLessThan:
+        case SpvOpFUnordLessThan:
+        case SpvOpFOrdGreaterThan:
+        case SpvOpFUnordGreaterThan:
+        case SpvOpFOrdLessThanEqual:
+        case SpvOpFUnordLessThanEqual:
+        case SpvOpFOrdGreaterThanEqual:
+        case SpvOpFUnordGreaterThanEqual:
+            return validate_binary(v, type_is_bool, spirv_type_is_float, ShapeEqual);
+
+        case SpvOpLogicalEqual:
+        case SpvOpLogicalNotEqual:
+        case SpvOpLogicalOr:
+        case SpvOpLogicalAnd:
+            return validate_binary(v, type_is_bool, type_is_bool, ShapeCount);
+
+        case SpvOpLogicalNot:
+            return validate_unary(v, type_is_bool, type_is_bool, ShapeResult);
+
+        case SpvOpIEqual:
+        case SpvOpINotEqual:
+            return validate_binary(v, type_is_bool, spirv_type_is_integer, ShapeCount);
+
+        case SpvOpUGreaterThan:
+        case SpvOpUGreaterThanEqual:
+        case SpvOpULessThan:
+        case SpvOpULessThanEqual:
+            return validate_binary(v, type_is_bool, spirv_type_is_unsigned_integer, ShapeCount);
+
+        case SpvOpSGreaterThan:
+        case SpvOpSGreaterThanEqual:
+        case SpvOpSLessThan:
+        case SpvOpSLessThanEqual:
+            return validate_binary(v, type_is_bool, spirv_type_is_signed_integer, ShapeCount);
+
+        case SpvOpSelect: {
+            RESULT(res);
+            OPERAND(cond, 2);
+            OPERAND(object_1, 3);
+            OPERAND(object_2, 4);
+            CHECK(type_is_bool(cond) && cond->count == res->count, "the condition should be a boolean with as many components as the result");
+            CHECK(object_1 == res && object_2 == res, "the objects should have the result type");
+            return true;
+        }
+
+        default:
+            assert(opcode_class(op->op.kind) == OpcodeUnsupported);
+            return invalid(v, "the instruction isn't supported");
+    }
+}
+
+#undef RESULT
+#undef OPERAND
+#undef CHECK
+
+static bool validate_instructions(Validator *v) {
+    SPIRV_module *module = v->module;
+    v->block = BLOCK_NONE;
+
+    for (v->op_index = v->func->def_index + 1; v->op_index < arr_len(module->opcode_array); ++v->op_index) {
+        v->op = module->opcode_array[v->op_index];
+        SpvOp kind = v->op->op.kind;
+
+        if (kind == SpvOpFunctionEnd) {
+            break;
+        } else if (kind == SpvOpLabel) {
+            ++v->block;
+        } else if (kind != SpvOpFunctionParameter && kind != SpvOpVariable) {
+            if (!validate_instruction(v)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void validator_free(Validator *v) {
+    for (Block *block = v->blocks; block != arr_end(v->blocks); ++block) {
+        arr_free(block->succs);
+        arr_free(block->preds);
+    }
+    arr_free(v->blocks);
+    arr_free(v->defs);
+    map_free(&v->block_ids);
+    map_free(&v->def_ids);
+}
+
+/*
+ * interface functions
+ */
+
+bool spirv_validate_function(SPIRV_module *module, SPIRV_function *func, char **error_msg) {
+    assert(module);
+    assert(func);
+    assert(error_msg);
+
+    if (func->validated) {
+        return true;
+    }
+
+    spirv_module_function_prepare(module, func);
+
+    Validator validator = {
+        .module = module,
+        .func = func,
+        .error_msg = error_msg
+    };
+
+    bool valid = validate_structure(&validator) &&
+                 validate_control_flow(&validator) &&
+                 validate_instructions(&validator);
+    validator_free(&validator);
+
+    if (!valid) {
+        return false;
+    }
+
+    func->validated = true;
+
+    for (uint32_t idx = 0; idx < arr_len(func->callee_ids); ++idx) {
+        SPIRV_function *callee = spirv_module_function_by_id(module, func->callee_ids[idx]);
+        if (callee && !spirv_validate_function(module, callee, error_msg)) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,23 @@
+// spirv_validate.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Validation of the functions of a module before they are executed.
+//  - structure: every block starts with OpLabel and ends with a single terminator, branches target blocks of the same function
+//  - ids: every operand is defined, by a global or by an instruction that dominates the use
+//  - types: operands and results have the types the instruction handlers of the simulator expect
+//  - only instructions (and extended instructions) the simulator implements are accepted
+// The simulator doesn't have to check the instructions of a valid function again (see spirv_sim_use_validation).
+
+#ifndef JS_SHADER_SIM_SPIRV_VALIDATE_H
+#define JS_SHADER_SIM_SPIRV_VALIDATE_H
+
+#include "types.h"
+
+// required forward declarations
+struct SPIRV_module;
+struct SPIRV_function;
+
+// validate the function and the functions it calls, functions that passed before aren't checked again.
+// Returns false and appends a description of the first problem to error_msg (dyn_array) when a function is invalid.
+bool spirv_validate_function(struct SPIRV_module *module, struct SPIRV_function *func, char **error_msg);
+
+#endif // JS_SHADER_SIM_SPIRV_VALIDATE_H
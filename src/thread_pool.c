@@ -0,0 +1,99 @@
+// thread_pool.c - Johan Smet - BSD-3-Clause (see LICENSE)
+
+#include "thread_pool.h"
+#include "allocator.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#ifdef THREAD_POOL_SUPPORTED
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+typedef struct ThreadPoolJob {
+    ThreadPoolTask task;
+    void *context;
+    uint32_t count;
+    atomic_uint next;
+} ThreadPoolJob;
+
+typedef struct ThreadPoolWorker {
+    ThreadPoolJob *job;
+    uint32_t index;
+    pthread_t thread;
+} ThreadPoolWorker;
+
+static void *worker_main(void *arg) {
+    ThreadPoolWorker *worker = arg;
+    ThreadPoolJob *job = worker->job;
+
+    for (uint32_t idx = atomic_fetch_add(&job->next, 1); idx < job->count; idx = atomic_fetch_add(&job->next, 1)) {
+        job->task(job->context, idx, worker->index);
+    }
+
+    return NULL;
+}
+
+static void *worker_thread(void *arg) {
+    worker_main(arg);
+
+    // the memory blocks cached by this thread can't be reused by another thread
+    mem_arena_release_cache();
+    return NULL;
+}
+
+uint32_t thread_pool_num_cpus(void) {
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (num_cpus > 0) ? (uint32_t) num_cpus : 1;
+}
+
+void thread_pool_run(uint32_t num_workers, uint32_t count, ThreadPoolTask task, void *context) {
+    assert(task);
+
+    ThreadPoolJob job = {
+        .task = task,
+        .context = context,
+        .count = count
+    };
+    atomic_init(&job.next, 0);
+
+    num_workers = CLAMP(num_workers, 1u, MAX(count, 1u));
+    ThreadPoolWorker *workers = calloc(num_workers, sizeof(ThreadPoolWorker));
+
+    for (uint32_t idx = 0; idx < num_workers; ++idx) {
+        workers[idx] = (ThreadPoolWorker) {.job = &job, .index = idx};
+    }
+
+    // worker 0 is the calling thread, fall back to fewer workers when a thread can't be created
+    uint32_t started = 1;
+    while (started < num_workers && pthread_create(&workers[started].thread, NULL, worker_thread, &workers[started]) == 0) {
+        ++started;
+    }
+
+    worker_main(&workers[0]);
+
+    for (uint32_t idx = 1; idx < started; ++idx) {
+        pthread_join(workers[idx].thread, NULL);
+    }
+
+    free(workers);
+}
+
+#else
+
+uint32_t thread_pool_num_cpus(void) {
+    return 1;
+}
+
+void thread_pool_run(uint32_t num_workers, uint32_t count, ThreadPoolTask task, void *context) {
+    assert(task);
+    (void) num_workers;
+
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        task(context, idx, 0);
+    }
+}
+
+#endif // THREAD_POOL_SUPPORTED
@@ -0,0 +1,23 @@
+// thread_pool.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Run a task for a range of indices on a number of worker threads.
+//  - the workers pick the next index from a shared counter, so tasks of varying length balance out
+//  - the calling thread is one of the workers, the call returns when all indices have been processed
+//  - without thread support (THREAD_POOL_SUPPORTED isn't defined) all tasks run serially on the calling thread
+
+#ifndef JS_SHADER_SIM_THREAD_POOL_H
+#define JS_SHADER_SIM_THREAD_POOL_H
+
+#include "types.h"
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+    #define THREAD_POOL_SUPPORTED
+#endif
+
+// worker is in the range [0, num_workers), use it to index per-worker state
+typedef void (*ThreadPoolTask)(void *context, uint32_t index, uint32_t worker);
+
+uint32_t thread_pool_num_cpus(void);
+void thread_pool_run(uint32_t num_workers, uint32_t count, ThreadPoolTask task, void *context);
+
+#endif // JS_SHADER_SIM_THREAD_POOL_H
@@ -0,0 +1,286 @@
+// typed_map.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// type-specialized hash maps, generated by macros and defined inline (header only)
+//  - same layout as hash_map.h (open addressing, "swiss table" control bytes), but the keys and values are stored
+//    with their own type and the hash / compare of the key are known at compile time
+//  - the tmap__ helpers (control bytes, group probing, growth policy) are the swiss table core: hash_map.c uses
+//    them as well, change them with both containers in mind
+//  - TYPED_MAP_U32(Name, prefix, T)  : uint32_t -> T *
+//    TYPED_MAP_U64(Name, prefix, T)  : uint64_t -> T *
+//    TYPED_MAP_ISTR(Name, prefix, T) : interned string (const char *) -> T *, keys are compared by address
+//  - generated functions (for prefix):
+//      prefix_put / prefix_get (NULL if the key isn't present) / prefix_has / prefix_remove
+//      prefix_clear (keeps the capacity) / prefix_reserve / prefix_free
+//      iteration: prefix_begin / prefix_end / prefix_next, the entry is at map->slots[iter].key / .val
+//  - the map does not copy the values - keep them around long enough or bad things will happen
+//  - iterators can be invalidated by changing the container during iteration
+
+#ifndef JS_TYPED_MAP_H
+#define JS_TYPED_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#define TMAP_GROUP_SIZE     16          // number of control bytes probed at once
+#define TMAP_MIN_CAP        16
+
+// the slots in use store 7 bits of the hash (high bit clear), free slots have the high bit set
+#define TMAP_CTRL_EMPTY     0x80
+#define TMAP_CTRL_DELETED   0xfe
+
+// the upper bits of the hash select the first group, the lower 7 bits are kept in the control byte
+#define tmap__pos(hash)     ((size_t) ((hash) >> 7))
+#define tmap__ctrl(hash)    ((uint8_t) ((hash) & 0x7f))
+
+#define tmap__equal(a, b)   ((a) == (b))
+
+static inline uint64_t tmap__hash_u64(uint64_t key) {
+    // mixer from MurmurHash3 (public domain -- see https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp)
+    key ^= (key >> 33);
+    key *= 0xff51afd7ed558ccd;
+    key ^= (key >> 33);
+    key *= 0xc4ceb9fe1a85ec53;
+    key ^= (key >> 33);
+    return key;
+}
+
+static inline uint64_t tmap__hash_ptr(const void *key) {
+    return tmap__hash_u64((uintptr_t) key);
+}
+
+static inline uint32_t tmap__group_match(const uint8_t *ctrl, uint8_t value) {
+/* bitmask of the slots in the group starting at ctrl that have the control byte value */
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) value)));
+#else
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < TMAP_GROUP_SIZE; ++i) {
+        result |= (uint32_t) (ctrl[i] == value) << i;
+    }
+    return result;
+#endif
+}
+
+static inline uint32_t tmap__group_match_free(const uint8_t *ctrl) {
+/* bitmask of the slots in the group starting at ctrl that are empty or deleted */
+#if defined(__SSE2__)
+    return (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) ctrl));
+#else
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < TMAP_GROUP_SIZE; ++i) {
+        result |= (uint32_t) (ctrl[i] >> 7) << i;
+    }
+    return result;
+#endif
+}
+
+static inline void tmap__set_ctrl(uint8_t *ctrl, size_t cap, size_t idx, uint8_t value) {
+/* the first group is duplicated after the last slot: a group can be loaded at any position without wrapping */
+    ctrl[idx] = value;
+    if (idx < TMAP_GROUP_SIZE) {
+        ctrl[cap + idx] = value;
+    }
+}
+
+static inline size_t tmap__find_free(const uint8_t *ctrl, size_t cap, uint64_t hash) {
+/* first empty or deleted slot in the probe sequence of the hash */
+    size_t mask = cap - 1;
+    size_t pos = tmap__pos(hash) & mask;
+
+    for (size_t stride = TMAP_GROUP_SIZE; ; stride += TMAP_GROUP_SIZE) {
+        uint32_t free_slots = tmap__group_match_free(ctrl + pos);
+        if (free_slots != 0) {
+            return (pos + (size_t) __builtin_ctz(free_slots)) & mask;
+        }
+        pos = (pos + stride) & mask;
+    }
+}
+
+static inline size_t tmap__grow_cap(size_t len, size_t deleted, size_t cap) {
+/* capacity needed to add one element: double when the table becomes 7/8 full, or
+   rehash at the same capacity when most of the used slots are deleted ones (0 = no change) */
+    if ((len + deleted + 1) * 8 <= cap * 7) {
+        return 0;
+    }
+    if (cap == 0) {
+        return TMAP_MIN_CAP;
+    }
+    return ((len + 1) * 2 > cap) ? 2 * cap : cap;
+}
+
+static inline size_t tmap__reserve_cap(size_t count) {
+/* smallest power of two that keeps the load at or below 7/8 */
+    size_t cap = TMAP_MIN_CAP;
+    while (count * 8 > cap * 7) {
+        cap *= 2;
+    }
+    return cap;
+}
+
+static inline int tmap__next(const uint8_t *ctrl, size_t cap, int cur) {
+    int result = cur + 1;
+
+    while (result < (int) cap && (ctrl[result] & TMAP_CTRL_EMPTY)) {
+        ++result;
+    }
+
+    return result;
+}
+
+#define TYPED_MAP(Name, prefix, KeyType, ValType, HASH, EQUAL)                                          \
+                                                                                                        \
+typedef struct Name##Slot {                                                                             \
+    KeyType key;                                                                                        \
+    ValType *val;                                                                                       \
+} Name##Slot;                                                                                           \
+                                                                                                        \
+typedef struct Name {                                                                                   \
+    size_t len;                                                                                         \
+    size_t cap;             /* number of slots: zero or a power of two */                               \
+    size_t deleted;         /* number of slots with a tombstone */                                      \
+    Name##Slot *slots;                                                                                  \
+    uint8_t *ctrl;          /* control byte per slot + a copy of the first group (allocated with slots) */ \
+} Name;                                                                                                 \
+                                                                                                        \
+static inline int64_t prefix##__find(const Name *map, KeyType key, uint64_t hash) {                    \
+    if (map->len == 0) {                                                                                \
+        return -1;                                                                                      \
+    }                                                                                                   \
+                                                                                                        \
+    size_t mask = map->cap - 1;                                                                         \
+    size_t pos = tmap__pos(hash) & mask;                                                                \
+    uint8_t h2 = tmap__ctrl(hash);                                                                      \
+                                                                                                        \
+    for (size_t stride = TMAP_GROUP_SIZE; ; stride += TMAP_GROUP_SIZE) {                                \
+        const uint8_t *group = map->ctrl + pos;                                                         \
+                                                                                                        \
+        for (uint32_t match = tmap__group_match(group, h2); match != 0; match &= match - 1) {           \
+            size_t idx = (pos + (size_t) __builtin_ctz(match)) & mask;                                  \
+            if (EQUAL(map->slots[idx].key, key)) {                                                      \
+                return (int64_t) idx;                                                                   \
+            }                                                                                           \
+        }                                                                                               \
+                                                                                                        \
+        if (tmap__group_match(group, TMAP_CTRL_EMPTY) != 0) {                                           \
+            return -1;                                                                                  \
+        }                                                                                               \
+                                                                                                        \
+        pos = (pos + stride) & mask;                                                                    \
+    }                                                                                                   \
+}                                                                                                       \
+                                                                                                        \
+static inline void prefix##__rehash(Name *map, size_t new_cap) {                                        \
+    Name new_map = (Name) {                                                                             \
+        .cap = new_cap,                                                                                 \
+        .slots = malloc(new_cap * sizeof(Name##Slot) + new_cap + TMAP_GROUP_SIZE)                       \
+    };                                                                                                  \
+    new_map.ctrl = (uint8_t *) (new_map.slots + new_cap);                                               \
+    memset(new_map.ctrl, TMAP_CTRL_EMPTY, new_cap + TMAP_GROUP_SIZE);                                   \
+                                                                                                        \
+    for (size_t idx = 0; idx < map->cap; ++idx) {                                                       \
+        if (!(map->ctrl[idx] & TMAP_CTRL_EMPTY)) {                                                      \
+            uint64_t hash = HASH(map->slots[idx].key);                                                  \
+            size_t dst = tmap__find_free(new_map.ctrl, new_cap, hash);                                  \
+            new_map.slots[dst] = map->slots[idx];                                                       \
+            tmap__set_ctrl(new_map.ctrl, new_cap, dst, tmap__ctrl(hash));                               \
+            new_map.len++;                                                                              \
+        }                                                                                               \
+    }                                                                                                   \
+                                                                                                        \
+    free(map->slots);                                                                                   \
+    *map = new_map;                                                                                     \
+}                                                                                                       \
+                                                                                                        \
+static inline void prefix##_put(Name *map, KeyType key, ValType *val) {                                 \
+    assert(map);                                                                                        \
+                                                                                                        \
+    uint64_t hash = HASH(key);                                                                          \
+                                                                                                        \
+    int64_t found = prefix##__find(map, key, hash);                                                     \
+    if (found >= 0) {                                                                                   \
+        map->slots[found].val = val;                                                                    \
+        return;                                                                                         \
+    }                                                                                                   \
+                                                                                                        \
+    size_t new_cap = tmap__grow_cap(map->len, map->deleted, map->cap);                                  \
+    if (new_cap > 0) {                                                                                  \
+        prefix##__rehash(map, new_cap);                                                                 \
+    }                                                                                                   \
+                                                                                                        \
+    size_t idx = tmap__find_free(map->ctrl, map->cap, hash);                                            \
+    if (map->ctrl[idx] == TMAP_CTRL_DELETED) {                                                          \
+        map->deleted--;                                                                                 \
+    }                                                                                                   \
+    map->slots[idx] = (Name##Slot) {key, val};                                                          \
+    tmap__set_ctrl(map->ctrl, map->cap, idx, tmap__ctrl(hash));                                         \
+    map->len++;                                                                                         \
+}                                                                                                       \
+                                                                                                        \
+static inline ValType *prefix##_get(const Name *map, KeyType key) {                                     \
+    int64_t idx = prefix##__find(map, key, HASH(key));                                                  \
+    return (idx >= 0) ? map->slots[idx].val : NULL;                                                     \
+}                                                                                                       \
+                                                                                                        \
+static inline bool prefix##_has(const Name *map, KeyType key) {                                         \
+    return prefix##__find(map, key, HASH(key)) >= 0;                                                    \
+}                                                                                                       \
+                                                                                                        \
+static inline bool prefix##_remove(Name *map, KeyType key) {                                            \
+    int64_t idx = prefix##__find(map, key, HASH(key));                                                  \
+    if (idx < 0) {                                                                                      \
+        return false;                                                                                   \
+    }                                                                                                   \
+                                                                                                        \
+    /* the slot may be part of the probe sequence of other keys: mark it deleted instead of empty */   \
+    tmap__set_ctrl(map->ctrl, map->cap, (size_t) idx, TMAP_CTRL_DELETED);                               \
+    map->len--;                                                                                         \
+    map->deleted++;                                                                                     \
+    return true;                                                                                        \
+}                                                                                                       \
+                                                                                                        \
+static inline void prefix##_clear(Name *map) {                                                          \
+    if (map->cap > 0) {                                                                                 \
+        memset(map->ctrl, TMAP_CTRL_EMPTY, map->cap + TMAP_GROUP_SIZE);                                 \
+    }                                                                                                   \
+    map->len = 0;                                                                                       \
+    map->deleted = 0;                                                                                   \
+}                                                                                                       \
+                                                                                                        \
+static inline void prefix##_reserve(Name *map, size_t count) {                                          \
+    size_t cap = tmap__reserve_cap(count);                                                              \
+    if (cap > map->cap) {                                                                               \
+        prefix##__rehash(map, cap);                                                                     \
+    }                                                                                                   \
+}                                                                                                       \
+                                                                                                        \
+static inline void prefix##_free(Name *map) {                                                           \
+    free(map->slots);                                                                                   \
+    *map = (Name) {0};                                                                                  \
+}                                                                                                       \
+                                                                                                        \
+static inline int prefix##_begin(const Name *map) {                                                     \
+    return tmap__next(map->ctrl, map->cap, -1);                                                         \
+}                                                                                                       \
+                                                                                                        \
+static inline int prefix##_end(const Name *map) {                                                       \
+    return (int) map->cap;                                                                              \
+}                                                                                                       \
+                                                                                                        \
+static inline int prefix##_next(const Name *map, int cur) {                                             \
+    return tmap__next(map->ctrl, map->cap, cur);                                                        \
+}
+
+#define TYPED_MAP_U32(Name, prefix, ValType)    TYPED_MAP(Name, prefix, uint32_t, ValType, tmap__hash_u64, tmap__equal)
+#define TYPED_MAP_U64(Name, prefix, ValType)    TYPED_MAP(Name, prefix, uint64_t, ValType, tmap__hash_u64, tmap__equal)
+#define TYPED_MAP_ISTR(Name, prefix, ValType)   TYPED_MAP(Name, prefix, const char *, ValType, tmap__hash_ptr, tmap__equal)
+
+#endif // JS_TYPED_MAP_H
@@ -5,6 +5,16 @@
 
 #include <stdio.h>
 #include <assert.h>
+#include <time.h>
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+    #define UTILS_POSIX
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 void fatal_error(const char *fmt, ...) {
     va_list args;
@@ -77,6 +87,128 @@ void file_free(int8_t *buffer) {
     arr_free(buffer);
 }
 
+bool file_map(const char *filename, bool copy_on_write, FileMapping *mapping) {
+    assert(filename);
+    assert(mapping);
+
+    *mapping = (FileMapping) {0};
+
+#ifdef UTILS_POSIX
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    int prot = (copy_on_write) ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *data = mmap(NULL, (size_t) st.st_size, prot, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    *mapping = (FileMapping) {data, (size_t) st.st_size, true};
+    return true;
+#else
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    void *data = (size > 0) ? malloc((size_t) size) : NULL;
+    if (!data || fread(data, 1, (size_t) size, fp) != (size_t) size) {
+        free(data);
+        fclose(fp);
+        return false;
+    }
+
+    fclose(fp);
+    *mapping = (FileMapping) {data, (size_t) size, false};
+    return true;
+#endif
+}
+
+void file_unmap(FileMapping *mapping) {
+    assert(mapping);
+
+    if (mapping->data == NULL) {
+        return;
+    }
+
+#ifdef UTILS_POSIX
+    if (mapping->mapped) {
+        munmap(mapping->data, mapping->size);
+    } else {
+        free(mapping->data);
+    }
+#else
+    free(mapping->data);
+#endif
+
+    *mapping = (FileMapping) {0};
+}
+
+
+bool dir_list_files(const char *dir, const char *extension, char ***files) {
+    assert(dir);
+    assert(extension);
+    assert(files);
+
+#ifdef UTILS_POSIX
+    DIR *dp = opendir(dir);
+    if (!dp) {
+        return false;
+    }
+
+    size_t ext_len = strlen(extension);
+
+    for (struct dirent *entry = readdir(dp); entry != NULL; entry = readdir(dp)) {
+        size_t name_len = strlen(entry->d_name);
+        if (name_len <= ext_len || strcmp(entry->d_name + name_len - ext_len, extension) != 0) {
+            continue;
+        }
+
+        char *path = NULL;
+        arr_printf(path, "%s/%s", dir, entry->d_name);
+
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            arr_free(path);
+            continue;
+        }
+
+        arr_push(*files, path);
+    }
+
+    closedir(dp);
+    return true;
+#else
+    (void) dir;
+    (void) extension;
+    (void) files;
+    return false;
+#endif
+}
+
+uint64_t time_now_ns(void) {
+    struct timespec ts;
+#ifdef UTILS_POSIX
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
 
 #define LINUX_PATH_SEPARATOR '/'
 #define WIN32_PATH_SEPARATOR '\\'
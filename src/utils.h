@@ -13,6 +13,23 @@ size_t file_load_binary(const char *filename, int8_t **buffer);
 size_t file_load_text(const char *filename, int8_t **buffer);
 void file_free(int8_t *buffer);
 
+// a file mapped into memory (or read into a heap block on platforms without mmap)
+typedef struct FileMapping {
+    void *data;
+    size_t size;
+    bool mapped;
+} FileMapping;
+
+// copy_on_write: changes to the data stay private to the process and never reach the file
+bool file_map(const char *filename, bool copy_on_write, FileMapping *mapping);
+void file_unmap(FileMapping *mapping);
+
+// all regular files in dir with the given extension, as full paths (dyn_array of dyn_array strings)
+bool dir_list_files(const char *dir, const char *extension, char ***files);
+
+// monotonic clock for measuring durations
+uint64_t time_now_ns(void);
+
 void path_fix_separator(const char *path_in, char *path_out);
 void path_dirname(const char *path_in, char *dir);
 void path_append(char *path, const char *suffix);
@@ -0,0 +1,305 @@
+// test_allocator.c - Johan Smet - BSD-3-Clause (see LICENSE)
+
+#include "munit/munit.h"
+#include "allocator.h"
+#include "dyn_array.h"
+
+#include <string.h>
+
+static MunitResult test_allocate(const MunitParameter params[], void* user_data_or_fixture) {
+    MemArena arena;
+    mem_arena_init(&arena, 256, ARENA_DEFAULT_ALIGN);
+
+    uint8_t *first = mem_arena_allocate(&arena, 10);
+    uint8_t *second = mem_arena_allocate(&arena, 10);
+    munit_assert_not_null(first);
+    munit_assert_ptr_equal(second, first + 16);
+    munit_assert_int(arr_len(arena.blocks), ==, 1);
+
+    /* allocations that don't fit start a new block, big ones get a block of their own */
+    mem_arena_allocate(&arena, 240);
+    munit_assert_int(arr_len(arena.blocks), ==, 2);
+    uint8_t *big = mem_arena_allocate(&arena, 1000);
+    memset(big, 0xff, 1000);
+    munit_assert_int(arr_len(arena.blocks), ==, 3);
+    munit_assert_size(arena.blocks[2].size, >=, 1000);
+
+    mem_arena_free(&arena);
+    munit_assert_null(arena.blocks);
+    mem_arena_release_cache();
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_mark_rewind(const MunitParameter params[], void* user_data_or_fixture) {
+    MemArena arena;
+    mem_arena_init(&arena, 256, ARENA_DEFAULT_ALIGN);
+
+    /* a mark on an empty arena releases everything */
+    MemArenaMark empty = mem_arena_mark(&arena);
+    mem_arena_allocate(&arena, 100);
+    mem_arena_rewind_to(&arena, empty);
+    munit_assert_int(arr_len(arena.blocks), ==, 0);
+
+    uint8_t *keep = mem_arena_allocate(&arena, 64);
+    MemArenaMark mark = mem_arena_mark(&arena);
+    uint8_t *scratch = mem_arena_allocate(&arena, 64);
+
+    /* rewinding in the same block hands out the same memory again */
+    mem_arena_rewind_to(&arena, mark);
+    munit_assert_ptr_equal(mem_arena_allocate(&arena, 64), scratch);
+
+    /* rewinding releases the blocks allocated after the mark */
+    mem_arena_rewind_to(&arena, mark);
+    for (int idx = 0; idx < 10; ++idx) {
+        mem_arena_allocate(&arena, 200);
+    }
+    munit_assert_int(arr_len(arena.blocks), >, 1);
+    mem_arena_rewind_to(&arena, mark);
+    munit_assert_int(arr_len(arena.blocks), ==, 1);
+    munit_assert_ptr_equal(mem_arena_allocate(&arena, 64), scratch);
+    munit_assert_ptr_equal(arena.blocks[0].data, keep);
+
+    mem_arena_free(&arena);
+    mem_arena_release_cache();
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_reset(const MunitParameter params[], void* user_data_or_fixture) {
+    MemArena arena;
+    mem_arena_init(&arena, 256, ARENA_DEFAULT_ALIGN);
+
+    /* resetting an arena that never allocated is allowed */
+    mem_arena_reset(&arena);
+    munit_assert_int(arr_len(arena.blocks), ==, 0);
+
+    uint8_t *first = mem_arena_allocate(&arena, 32);
+    for (int idx = 0; idx < 10; ++idx) {
+        mem_arena_allocate(&arena, 200);
+    }
+    munit_assert_int(arr_len(arena.blocks), >, 1);
+
+    mem_arena_reset(&arena);
+    munit_assert_int(arr_len(arena.blocks), ==, 1);
+    munit_assert_ptr_equal(mem_arena_allocate(&arena, 32), first);
+
+    mem_arena_free(&arena);
+    mem_arena_release_cache();
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_block_cache(const MunitParameter params[], void* user_data_or_fixture) {
+    mem_arena_release_cache();
+
+    /* the blocks of a freed arena are reused by the next arena that grows */
+    MemArena arena;
+    mem_arena_init(&arena, 4096, ARENA_DEFAULT_ALIGN);
+    uint8_t *block = mem_arena_allocate(&arena, 16);
+    mem_arena_free(&arena);
+
+    mem_arena_init(&arena, 4096, ARENA_DEFAULT_ALIGN);
+    munit_assert_ptr_equal(mem_arena_allocate(&arena, 16), block);
+
+    /* but not when the cached block is much larger than the block that's needed */
+    MemArena small;
+    mem_arena_init(&small, 256, ARENA_DEFAULT_ALIGN);
+    mem_arena_free(&arena);
+    munit_assert_ptr_not_equal(mem_arena_allocate(&small, 16), block);
+
+    /* or too small */
+    MemArena large;
+    mem_arena_init(&large, 8192, ARENA_DEFAULT_ALIGN);
+    munit_assert_ptr_not_equal(mem_arena_allocate(&large, 16), block);
+
+    mem_arena_free(&small);
+    mem_arena_free(&large);
+    mem_arena_release_cache();
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_block_cache_alignment(const MunitParameter params[], void* user_data_or_fixture) {
+    mem_arena_release_cache();
+
+    /* a block with an odd size, from an arena that doesn't align its allocations */
+    MemArena arena;
+    mem_arena_init(&arena, 105, 1);
+    uint8_t *odd_block = mem_arena_allocate(&arena, 100);
+    mem_arena_free(&arena);
+
+    /* an arena with a stricter alignment may not reuse it, every allocation has to stay inside its blocks */
+    mem_arena_init(&arena, 100, 8);
+    size_t sizes[] = {100, 1, 64, 3, 200};
+
+    for (int idx = 0; idx < 5; ++idx) {
+        uint8_t *ptr = mem_arena_allocate(&arena, sizes[idx]);
+        munit_assert_uint64((uintptr_t) ptr % 8, ==, 0);
+        munit_assert_ptr_not_equal(ptr, odd_block);
+
+        bool inside = false;
+        for (MemBlock *block = arena.blocks; block != arr_end(arena.blocks); ++block) {
+            inside |= ptr >= block->data && ptr + sizes[idx] <= block->data + block->size;
+        }
+        munit_assert_true(inside);
+        memset(ptr, idx, sizes[idx]);
+    }
+
+    mem_arena_free(&arena);
+    mem_arena_release_cache();
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_alignment(const MunitParameter params[], void* user_data_or_fixture) {
+    /* alignments beyond the alignment of malloc */
+    uint32_t alignments[] = {ARENA_SIMD_ALIGN, 64, 4096};
+
+    for (int idx = 0; idx < 3; ++idx) {
+        MemArena arena;
+        mem_arena_init(&arena, 1000, alignments[idx]);
+
+        for (int alloc = 0; alloc < 20; ++alloc) {
+            uint8_t *ptr = mem_arena_allocate(&arena, 1 + alloc * 37);
+            munit_assert_uint64((uintptr_t) ptr % alignments[idx], ==, 0);
+            memset(ptr, alloc, 1 + alloc * 37);
+        }
+
+        mem_arena_free(&arena);
+    }
+
+    /* a cached block is only reused when it's aligned well enough */
+    mem_arena_release_cache();
+    MemArena arena;
+    mem_arena_init(&arena, 4096, 1);
+    uint8_t *unaligned = mem_arena_allocate(&arena, 1);
+    mem_arena_free(&arena);
+
+    mem_arena_init(&arena, 4096, 4096);
+    uint8_t *aligned = mem_arena_allocate(&arena, 1);
+    munit_assert_uint64((uintptr_t) aligned % 4096, ==, 0);
+    if ((uintptr_t) unaligned % 4096 != 0) {
+        munit_assert_ptr_not_equal(aligned, unaligned);
+    }
+    mem_arena_free(&arena);
+    mem_arena_release_cache();
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_huge_pages(const MunitParameter params[], void* user_data_or_fixture) {
+    MemArena arena;
+    mem_arena_init(&arena, ARENA_HUGE_PAGE_SIZE, ARENA_SIMD_ALIGN);
+    mem_arena_use_huge_pages(&arena);
+
+    /* the memory is usable whether or not the platform can map huge pages */
+    uint8_t *ptr = mem_arena_allocate(&arena, 3 * 1024 * 1024);
+    munit_assert_not_null(ptr);
+    memset(ptr, 0xaa, 3 * 1024 * 1024);
+    munit_assert_uint64((uintptr_t) ptr % ARENA_SIMD_ALIGN, ==, 0);
+
+#ifdef PLATFORM_LINUX
+    munit_assert_int(arena.blocks[0].kind, ==, MemBlockMapped);
+    munit_assert_uint64((uintptr_t) ptr % ARENA_HUGE_PAGE_SIZE, ==, 0);
+    munit_assert_size(arena.blocks[0].size, ==, 2 * ARENA_HUGE_PAGE_SIZE);
+#endif
+
+    /* small blocks are allocated as usual */
+    MemArena small;
+    mem_arena_init(&small, 4096, ARENA_DEFAULT_ALIGN);
+    mem_arena_use_huge_pages(&small);
+    mem_arena_allocate(&small, 16);
+    munit_assert_int(small.blocks[0].kind, ==, MemBlockMalloc);
+
+    mem_arena_free(&small);
+    mem_arena_free(&arena);
+    mem_arena_release_cache();
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_stats(const MunitParameter params[], void* user_data_or_fixture) {
+    mem_arena_release_cache();
+    mem_stats_enable(true);
+
+    /* arenas count towards their own tag */
+    MemArena arena;
+    mem_arena_init(&arena, 256, ARENA_DEFAULT_ALIGN);
+    arena.tag = MemTagFrame;
+    mem_arena_allocate(&arena, 200);
+    mem_arena_allocate(&arena, 100);
+
+    const MemStats *frame = mem_stats_get(MemTagFrame);
+    munit_assert_size(frame->bytes_requested, ==, 300);
+    munit_assert_size(frame->blocks_allocated, ==, 2);
+    munit_assert_size(frame->bytes_reserved, ==, 512);
+    munit_assert_size(frame->bytes_wasted, ==, 56);
+
+    /* a reset keeps the first block, the peak remains */
+    mem_arena_reset(&arena);
+    munit_assert_size(frame->bytes_reserved, ==, 256);
+    munit_assert_size(frame->peak_reserved, ==, 512);
+
+    /* the next block comes from the cache */
+    mem_arena_allocate(&arena, 256);
+    mem_arena_allocate(&arena, 100);
+    munit_assert_size(frame->blocks_reused, ==, 1);
+    mem_arena_free(&arena);
+    munit_assert_size(frame->bytes_reserved, ==, 0);
+
+    /* untagged arenas and dyn_arrays use the tag of the thread */
+    MemTag prev_tag = mem_stats_set_tag(MemTagText);
+    mem_arena_init(&arena, 256, ARENA_DEFAULT_ALIGN);
+    mem_arena_allocate(&arena, 10);
+
+    int *array = NULL;
+    for (int idx = 0; idx < 100; ++idx) {
+        arr_push(array, idx);
+    }
+    munit_assert_int(mem_stats_set_tag(prev_tag), ==, MemTagText);
+
+    const MemStats *text = mem_stats_get(MemTagText);
+    munit_assert_size(text->bytes_requested, ==, 10);
+    munit_assert_size(text->array_grows, >, 1);
+    munit_assert_size(text->array_bytes_grown, >=, arr_cap(array) * sizeof(int));     // + the block list of the arena
+    munit_assert_size(text->array_bytes_copied, <, arr_cap(array) * sizeof(int));   // the capacity doubles with each grow
+    arr_free(array);
+    mem_arena_free(&arena);
+
+    /* memory allocated outside of an arena */
+    mem_stats_track_alloc(MemTagSimulator, 1000);
+    munit_assert_size(mem_stats_get(MemTagSimulator)->bytes_reserved, ==, 1000);
+    mem_stats_track_free(MemTagSimulator, 1000);
+    munit_assert_size(mem_stats_get(MemTagSimulator)->bytes_reserved, ==, 0);
+    munit_assert_size(mem_stats_get(MemTagSimulator)->peak_reserved, ==, 1000);
+
+    char *report = NULL;
+    mem_stats_report(&report);
+    munit_assert_not_null(strstr(report, "frame"));
+    munit_assert_not_null(strstr(report, "simulator"));
+    arr_free(report);
+
+    /* disabled: nothing is counted */
+    mem_stats_enable(false);
+    mem_arena_init(&arena, 256, ARENA_DEFAULT_ALIGN);
+    arena.tag = MemTagFrame;
+    mem_arena_allocate(&arena, 10);
+    munit_assert_size(mem_stats_get(MemTagFrame)->blocks_allocated, ==, 0);
+    mem_arena_free(&arena);
+    mem_arena_release_cache();
+
+    return MUNIT_OK;
+}
+
+MunitTest allocator_tests[] = {
+    { "/allocate", test_allocate, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/mark_rewind", test_mark_rewind, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/reset", test_reset, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/block_cache", test_block_cache, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/block_cache_alignment", test_block_cache_alignment, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/alignment", test_alignment, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/huge_pages", test_huge_pages, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/stats", test_stats, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
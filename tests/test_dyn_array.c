@@ -95,6 +95,34 @@ MunitResult test_reserve(const MunitParameter params[], void* user_data_or_fixtu
     return MUNIT_OK;
 }
 
+MunitResult test_fit(const MunitParameter params[], void* user_data_or_fixture) {
+
+    uint8_t *test_array = NULL;
+
+    /* only the capacity grows, the length stays the same */
+    arr_fit(test_array, 10);
+    munit_assert_not_null(test_array);
+    munit_assert_int(arr_len(test_array), ==, 0);
+    munit_assert_int(arr_cap(test_array), >=, 10);
+
+    /* pushing within the capacity doesn't move the array */
+    uint8_t *before = test_array;
+    for (uint8_t i = 0; i < 10; ++i) {
+        arr_push(test_array, i);
+    }
+    munit_assert_ptr_equal(test_array, before);
+    munit_assert_int(arr_len(test_array), ==, 10);
+
+    arr_fit(test_array, 5);
+    munit_assert_int(arr_len(test_array), ==, 10);
+    munit_assert_int(arr_cap(test_array), >=, 15);
+    munit_assert_uint8(test_array[9], ==, 9);
+
+    arr_free(test_array);
+
+    return MUNIT_OK;
+}
+
 MunitResult test_pop(const MunitParameter params[], void* user_data_or_fixture) {
     int *test_array = NULL;
 
@@ -189,14 +217,64 @@ MunitResult test_strcat(const MunitParameter params[], void* user_data_or_fixtur
     return MUNIT_OK;
 }
 
+MunitResult test_append(const MunitParameter params[], void* user_data_or_fixture) {
+
+    char *test_string = NULL;
+
+    arr_append_int(test_string, 0);
+    munit_assert_string_equal(test_string, "0");
+    arr_append_char(test_string, ' ');
+    arr_append_int(test_string, -2147483647 - 1);
+    munit_assert_string_equal(test_string, "0 -2147483648");
+    arr_append_char(test_string, ' ');
+    arr_append_uint(test_string, UINT64_MAX);
+    munit_assert_string_equal(test_string, "0 -2147483648 18446744073709551615");
+    munit_assert_int(arr_len(test_string), ==, strlen(test_string));
+
+    arr_clear(test_string);
+    arr_append_fill(test_string, ' ', 3);
+    arr_append_str(test_string, "%");
+    arr_append_uint(test_string, 42);
+    munit_assert_string_equal(test_string, "   %42");
+
+    arr_clear(test_string);
+    arr_append_float(test_string, 3.14159, 4);
+    arr_append_char(test_string, ' ');
+    arr_append_float(test_string, -0.5f, 6);
+    munit_assert_string_equal(test_string, "3.1416 -0.500000");
+
+    /* must match the output of arr_printf exactly */
+    char *expected = NULL;
+    arr_printf(expected, "%.4f %f", 3.14159, -0.5);
+    munit_assert_string_equal(test_string, expected);
+
+    arr_clear(test_string);
+    arr_append_float(test_string, 1e300, 1);
+    arr_clear(expected);
+    arr_printf(expected, "%.1f", 1e300);
+    munit_assert_string_equal(test_string, expected);
+
+    arr_free(expected);
+    arr_free(test_string);
+
+    char *test_empty = NULL;
+    arr_append_str(test_empty, "");
+    munit_assert_string_equal(test_empty, "");
+    arr_free(test_empty);
+
+    return MUNIT_OK;
+}
+
 MunitTest dyn_array_tests[] = {
     { "/basic", test_basic, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { "/iteration", test_iteration, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { "/clear", test_clear, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { "/printf", test_printf, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { "/reserve", test_reserve, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    { "/fit", test_fit, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     { "/pop", test_pop, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     { "/remove_back", test_remove_back, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     { "/strcat", test_strcat, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    { "/append", test_append, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
@@ -0,0 +1,334 @@
+// test_fast_math.c - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Measure the error of the fast approximations against the double precision C library
+// and check them against the precision requirements of the Vulkan specification.
+
+#include "munit/munit.h"
+#include "types.h"
+#include "fast_math.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <math.h>
+#include <float.h>
+
+#define NUM_SAMPLES 100000
+
+typedef void (*FAST_FUNC_1OP)(float *res, const float *x, size_t n);
+typedef double (*REF_FUNC_1OP)(double x);
+
+static double ulp_error(float value, double reference) {
+/* error expressed in units of the last place of the (single precision) reference value */
+    double ulp = (fabs(reference) < FLT_MIN) ? ldexp(1.0, -149) : ldexp(1.0, ilogb(reference) - 23);
+    return fabs((double) value - reference) / ulp;
+}
+
+static void sample_range(float *x, float min, float max) {
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        x[i] = min + (max - min) * ((float) i / (NUM_SAMPLES - 1));
+    }
+}
+
+static void sample_exponents(float *x, int min_exp, int max_exp) {
+/* positive values evenly spread over the exponents (log-uniform) */
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        double t = (double) i / (NUM_SAMPLES - 1);
+        x[i] = (float) exp2(min_exp + t * (max_exp - min_exp));
+    }
+}
+
+static double max_ulp_error(FAST_FUNC_1OP fast_func, REF_FUNC_1OP ref_func, float *x, float *res) {
+    double max_error = 0.0;
+
+    fast_func(res, x, NUM_SAMPLES);
+
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        max_error = MAX(max_error, ulp_error(res[i], ref_func(x[i])));
+    }
+
+    return max_error;
+}
+
+static double max_abs_error(FAST_FUNC_1OP fast_func, REF_FUNC_1OP ref_func, float *x, float *res) {
+    double max_error = 0.0;
+
+    fast_func(res, x, NUM_SAMPLES);
+
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        max_error = MAX(max_error, fabs(res[i] - ref_func(x[i])));
+    }
+
+    return max_error;
+}
+
+static MunitResult test_exp(const MunitParameter params[], void* user_data_or_fixture) {
+/* precision: 3 + 2 * |x| ULP */
+    static float x[NUM_SAMPLES];
+    static float res[NUM_SAMPLES];
+
+    sample_range(x, -87.0f, 88.0f);
+    fast_math_exp(res, x, NUM_SAMPLES);
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        munit_assert_double(ulp_error(res[i], exp(x[i])), <=, 3.0 + 2.0 * fabsf(x[i]));
+    }
+
+    sample_range(x, -126.0f, 127.0f);
+    fast_math_exp2(res, x, NUM_SAMPLES);
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        munit_assert_double(ulp_error(res[i], exp2(x[i])), <=, 3.0 + 2.0 * fabsf(x[i]));
+    }
+
+    /* error on the small, most common arguments should be close to correctly rounded */
+    sample_range(x, -1.0f, 1.0f);
+    munit_assert_double(max_ulp_error(fast_math_exp, exp, x, res), <=, 1.0);
+    munit_assert_double(max_ulp_error(fast_math_exp2, exp2, x, res), <=, 1.0);
+
+    /* special values */
+    float special[] = {-INFINITY, INFINITY, -200.0f, 200.0f, 0.0f};
+    fast_math_exp2(res, special, 5);
+    munit_assert_float(res[0], ==, 0.0f);
+    munit_assert_float(res[1], ==, INFINITY);
+    munit_assert_float(res[2], ==, 0.0f);
+    munit_assert_float(res[3], ==, INFINITY);
+    munit_assert_float(res[4], ==, 1.0f);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_log(const MunitParameter params[], void* user_data_or_fixture) {
+/* precision: 3 ULP outside the range [0.5, 2.0], absolute error < 2^-21 inside the range [0.5, 2.0] */
+    static float x[NUM_SAMPLES];
+    static float res[NUM_SAMPLES];
+
+    sample_exponents(x, -149, 127);
+    fast_math_log(res, x, NUM_SAMPLES);
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        if (x[i] >= 0.5f && x[i] <= 2.0f) {
+            munit_assert_double(fabs(res[i] - log(x[i])), <, ldexp(1.0, -21));
+        } else {
+            munit_assert_double(ulp_error(res[i], log(x[i])), <=, 3.0);
+        }
+    }
+
+    sample_range(x, 0.5f, 2.0f);
+    munit_assert_double(max_abs_error(fast_math_log, log, x, res), <, ldexp(1.0, -21));
+
+    /* special values */
+    float special[] = {0.0f, -1.0f, INFINITY, 1.0f, 8.0f};
+    fast_math_log(res, special, 5);
+    munit_assert_float(res[0], ==, -INFINITY);
+    munit_assert_true(isnan(res[1]));
+    munit_assert_float(res[2], ==, INFINITY);
+    munit_assert_float(res[3], ==, 0.0f);
+    munit_assert_float(res[4], ==, logf(8.0f));
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_sin_cos(const MunitParameter params[], void* user_data_or_fixture) {
+/* precision: absolute error <= 2^-11 inside the range [-pi, pi] */
+    static float x[NUM_SAMPLES];
+    static float res[NUM_SAMPLES];
+
+    sample_range(x, -PI_F, PI_F);
+    munit_assert_double(max_abs_error(fast_math_sin, sin, x, res), <=, ldexp(1.0, -11));
+    munit_assert_double(max_abs_error(fast_math_cos, cos, x, res), <=, ldexp(1.0, -11));
+
+    /* the approximations are a lot better than required, also outside of [-pi, pi] */
+    sample_range(x, -1000.0f, 1000.0f);
+    munit_assert_double(max_abs_error(fast_math_sin, sin, x, res), <=, ldexp(1.0, -23));
+    munit_assert_double(max_abs_error(fast_math_cos, cos, x, res), <=, ldexp(1.0, -23));
+
+    /* special values */
+    float special[] = {INFINITY, -INFINITY, NAN, 0.0f};
+    fast_math_sin(res, special, 4);
+    munit_assert_true(isnan(res[0]));
+    munit_assert_true(isnan(res[1]));
+    munit_assert_true(isnan(res[2]));
+    munit_assert_float(res[3], ==, 0.0f);
+
+    /* tan: inherited from sin(x) / cos(x) */
+    sample_range(x, -1.5f, 1.5f);
+    munit_assert_double(max_ulp_error(fast_math_tan, tan, x, res), <=, 3.0);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_atan(const MunitParameter params[], void* user_data_or_fixture) {
+/* precision: 4096 ULP */
+    static float x[NUM_SAMPLES];
+    static float y[NUM_SAMPLES];
+    static float res[NUM_SAMPLES];
+
+    sample_range(x, -100.0f, 100.0f);
+    munit_assert_double(max_ulp_error(fast_math_atan, atan, x, res), <=, 4096.0);
+
+    sample_exponents(x, -100, 100);
+    munit_assert_double(max_ulp_error(fast_math_atan, atan, x, res), <=, 4096.0);
+
+    /* atan2: all four quadrants */
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        float angle = -PI_F + 2.0f * PI_F * ((float) i / NUM_SAMPLES);
+        float radius = 0.001f + (float) (i % 100);
+        x[i] = radius * cosf(angle);
+        y[i] = radius * sinf(angle);
+    }
+
+    fast_math_atan2(res, y, x, NUM_SAMPLES);
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        munit_assert_double(ulp_error(res[i], atan2(y[i], x[i])), <=, 4096.0);
+    }
+
+    /* asin, acos: inherited from atan2 */
+    sample_range(x, -1.0f, 1.0f);
+    munit_assert_double(max_ulp_error(fast_math_asin, asin, x, res), <=, 4096.0);
+    munit_assert_double(max_ulp_error(fast_math_acos, acos, x, res), <=, 4096.0);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_inverse_sqrt(const MunitParameter params[], void* user_data_or_fixture) {
+/* precision: 2 ULP */
+    static float x[NUM_SAMPLES];
+    static float res[NUM_SAMPLES];
+
+    sample_exponents(x, -126, 127);
+    fast_math_inverse_sqrt(res, x, NUM_SAMPLES);
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+        munit_assert_double(ulp_error(res[i], 1.0 / sqrt(x[i])), <=, 2.0);
+    }
+
+    return MUNIT_OK;
+}
+
+/*
+ * benchmark: fast approximations vs the C library loops of the precise mode, on vec4 operands like the simulator.
+ *  Only runs when the SHADER_SIM_BENCHMARK environment variable is set, the timings are only meaningful in a
+ *  Release build.
+ */
+
+#define BENCH_VECS      4096
+#define BENCH_ROUNDS    16
+#define BENCH_REPEATS   8       // report the best repeat, the others are disturbed by the rest of the system
+
+typedef void (*FAST_FUNC_2OP)(float *res, const float *x, const float *y, size_t n);
+
+#define REF_1OP(name, expr)                                                 \
+    static void ref_##name(float *res, const float *x, size_t n) {          \
+        for (size_t i = 0; i < n; ++i) {                                    \
+            res[i] = expr;                                                  \
+        }                                                                   \
+    }
+
+#define REF_2OP(name, expr)                                                             \
+    static void ref_##name(float *res, const float *x, const float *y, size_t n) {      \
+        for (size_t i = 0; i < n; ++i) {                                                \
+            res[i] = expr;                                                              \
+        }                                                                               \
+    }
+
+REF_1OP(exp, expf(x[i]))
+REF_1OP(exp2, exp2f(x[i]))
+REF_1OP(log, logf(x[i]))
+REF_1OP(sin, sinf(x[i]))
+REF_1OP(cos, cosf(x[i]))
+REF_1OP(tan, tanf(x[i]))
+REF_1OP(asin, asinf(x[i]))
+REF_1OP(acos, acosf(x[i]))
+REF_1OP(atan, atanf(x[i]))
+REF_2OP(atan2, atan2f(x[i], y[i]))
+REF_1OP(inverse_sqrt, 1.0f / sqrtf(x[i]))
+
+static uint64_t bench_1op(FAST_FUNC_1OP func, const float *x, float *res) {
+/* best time per vec4 in nanoseconds */
+    uint64_t best = UINT64_MAX;
+    for (int repeat = 0; repeat < BENCH_REPEATS; ++repeat) {
+        uint64_t start = time_now_ns();
+        for (int round = 0; round < BENCH_ROUNDS; ++round) {
+            for (int v = 0; v < BENCH_VECS; ++v) {
+                func(res + v * 4, x + v * 4, 4);
+            }
+        }
+        best = MIN(best, time_now_ns() - start);
+    }
+    return best / (BENCH_ROUNDS * BENCH_VECS);
+}
+
+static uint64_t bench_2op(FAST_FUNC_2OP func, const float *x, const float *y, float *res) {
+/* best time per vec4 in nanoseconds */
+    uint64_t best = UINT64_MAX;
+    for (int repeat = 0; repeat < BENCH_REPEATS; ++repeat) {
+        uint64_t start = time_now_ns();
+        for (int round = 0; round < BENCH_ROUNDS; ++round) {
+            for (int v = 0; v < BENCH_VECS; ++v) {
+                func(res + v * 4, x + v * 4, y + v * 4, 4);
+            }
+        }
+        best = MIN(best, time_now_ns() - start);
+    }
+    return best / (BENCH_ROUNDS * BENCH_VECS);
+}
+
+static MunitResult test_benchmark(const MunitParameter params[], void* user_data_or_fixture) {
+    static float x[BENCH_VECS * 4];
+    static float y[BENCH_VECS * 4];
+    static float res[BENCH_VECS * 4];
+
+    if (getenv("SHADER_SIM_BENCHMARK") == NULL) {
+        return MUNIT_SKIP;
+    }
+
+    static const struct {
+        const char *name;
+        FAST_FUNC_1OP fast;
+        FAST_FUNC_1OP ref;
+        float min;
+        float max;
+    } funcs_1op[] = {
+        {"exp", fast_math_exp, ref_exp, -80.0f, 80.0f},
+        {"exp2", fast_math_exp2, ref_exp2, -120.0f, 120.0f},
+        {"log", fast_math_log, ref_log, 0.001f, 1000.0f},
+        {"sin", fast_math_sin, ref_sin, -10.0f, 10.0f},
+        {"cos", fast_math_cos, ref_cos, -10.0f, 10.0f},
+        {"tan", fast_math_tan, ref_tan, -1.5f, 1.5f},
+        {"asin", fast_math_asin, ref_asin, -1.0f, 1.0f},
+        {"acos", fast_math_acos, ref_acos, -1.0f, 1.0f},
+        {"atan", fast_math_atan, ref_atan, -100.0f, 100.0f},
+        {"inverse_sqrt", fast_math_inverse_sqrt, ref_inverse_sqrt, 0.001f, 1000.0f},
+    };
+
+    for (size_t f = 0; f < sizeof(funcs_1op) / sizeof(funcs_1op[0]); ++f) {
+        for (int i = 0; i < BENCH_VECS * 4; ++i) {
+            /* spread over the range, but not in order */
+            x[i] = funcs_1op[f].min + (funcs_1op[f].max - funcs_1op[f].min) * (float) ((i * 7919) % (BENCH_VECS * 4)) / (BENCH_VECS * 4);
+        }
+
+        uint64_t fast_ns = bench_1op(funcs_1op[f].fast, x, res);
+        uint64_t ref_ns = bench_1op(funcs_1op[f].ref, x, res);
+        munit_logf(MUNIT_LOG_INFO, "%-12s fast: %4" PRIu64 " ns/vec4, libm: %4" PRIu64 " ns/vec4 (%.2fx)",
+                   funcs_1op[f].name, fast_ns, ref_ns, (double) ref_ns / fast_ns);
+    }
+
+    for (int i = 0; i < BENCH_VECS * 4; ++i) {
+        x[i] = -100.0f + 200.0f * (float) ((i * 7919) % (BENCH_VECS * 4)) / (BENCH_VECS * 4);
+        y[i] = -100.0f + 200.0f * (float) ((i * 104729) % (BENCH_VECS * 4)) / (BENCH_VECS * 4);
+    }
+
+    uint64_t fast_ns = bench_2op(fast_math_atan2, x, y, res);
+    uint64_t ref_ns = bench_2op(ref_atan2, x, y, res);
+    munit_logf(MUNIT_LOG_INFO, "%-12s fast: %4" PRIu64 " ns/vec4, libm: %4" PRIu64 " ns/vec4 (%.2fx)",
+               "atan2", fast_ns, ref_ns, (double) ref_ns / fast_ns);
+
+    return MUNIT_OK;
+}
+
+MunitTest fast_math_tests[] = {
+    { "/exp", test_exp, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/log", test_log, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/sin_cos", test_sin_cos, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/atan", test_atan, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/inverse_sqrt", test_inverse_sqrt, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/benchmark", test_benchmark, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
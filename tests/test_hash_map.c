@@ -2,6 +2,13 @@
 
 #include "munit/munit.h"
 #include "hash_map.h"
+#include "typed_map.h"
+#include "intern.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static MunitResult test_pointer(const MunitParameter params[], void* user_data_or_fixture) {
     char *key1 = "key";
@@ -113,11 +120,391 @@ static MunitResult test_empty(const MunitParameter params[], void* user_data_or_
     return MUNIT_OK;
 }
 
+static MunitResult test_remove(const MunitParameter params[], void* user_data_or_fixture) {
+    HashMap map = {0};
+
+    for (uint64_t idx = 0; idx < 1000; ++idx) {
+        map_int_int_put(&map, idx, idx + 1);
+    }
+
+    /* remove the even keys, the odd keys can still be found past the tombstones */
+    for (uint64_t idx = 0; idx < 1000; idx += 2) {
+        munit_assert_true(map_int_remove(&map, idx));
+    }
+    munit_assert_false(map_int_remove(&map, 0));
+    munit_assert_false(map_int_remove(&map, 5000));
+    munit_assert_int(map_len(&map), ==, 500);
+
+    for (uint64_t idx = 0; idx < 1000; ++idx) {
+        munit_assert_int(map_int_int_has(&map, idx), ==, idx % 2 == 1);
+    }
+
+    /* removing and adding in turn reuses the deleted slots instead of growing forever */
+    size_t cap = map.cap;
+    for (uint64_t round = 0; round < 100; ++round) {
+        for (uint64_t idx = 0; idx < 1000; idx += 2) {
+            map_int_int_put(&map, idx, round);
+        }
+        for (uint64_t idx = 0; idx < 1000; idx += 2) {
+            munit_assert_true(map_int_remove(&map, idx));
+        }
+    }
+    munit_assert_size(map.cap, ==, cap);
+    munit_assert_int(map_len(&map), ==, 500);
+
+    int count = 0;
+    for (int idx = map_begin(&map); idx != map_end(&map); idx = map_next(&map, idx)) {
+        munit_assert_int(map_key_int(&map, idx) % 2, ==, 1);
+        ++count;
+    }
+    munit_assert_int(count, ==, 500);
+
+    map_free(&map);
+
+    /* string keys */
+    map_str_int_put(&map, "one", 1);
+    map_str_int_put(&map, "two", 2);
+    munit_assert_true(map_str_remove(&map, "one"));
+    munit_assert_false(map_str_int_has(&map, "one"));
+    munit_assert_int(map_str_int_get(&map, "two"), ==, 2);
+    map_free(&map);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_clear_reserve(const MunitParameter params[], void* user_data_or_fixture) {
+    HashMap map = {0};
+
+    /* reserve up front: adding the elements doesn't change the table */
+    map_reserve(&map, 1000);
+    size_t cap = map.cap;
+    MapSlot *slots = map.slots;
+    munit_assert_size(cap, >=, 1000);
+
+    for (uint64_t idx = 0; idx < 1000; ++idx) {
+        map_int_ptr_put(&map, idx, &map);
+    }
+    munit_assert_size(map.cap, ==, cap);
+    munit_assert_ptr_equal(map.slots, slots);
+
+    /* reserve keeps the elements */
+    map_reserve(&map, 4000);
+    munit_assert_size(map.cap, >, cap);
+    munit_assert_int(map_len(&map), ==, 1000);
+    for (uint64_t idx = 0; idx < 1000; ++idx) {
+        munit_assert_ptr_equal(map_int_ptr_get(&map, idx), &map);
+    }
+
+    /* clear keeps the memory */
+    cap = map.cap;
+    slots = map.slots;
+    map_clear(&map);
+    munit_assert_int(map_len(&map), ==, 0);
+    munit_assert_false(map_int_ptr_has(&map, 1));
+    munit_assert_int(map_begin(&map), ==, map_end(&map));
+
+    map_int_ptr_put(&map, 1, &map);
+    munit_assert_ptr_equal(map_int_ptr_get(&map, 1), &map);
+    munit_assert_size(map.cap, ==, cap);
+    munit_assert_ptr_equal(map.slots, slots);
+
+    map_free(&map);
+
+    /* rehashing string keys */
+    map_str_int_put(&map, "first", 1);
+    map_reserve(&map, 100);
+    munit_assert_int(map_str_int_get(&map, "first"), ==, 1);
+    map_free(&map);
+
+    return MUNIT_OK;
+}
+
+TYPED_MAP_U32(TestMapU32, test_map_u32, uint64_t)
+TYPED_MAP_U64(TestMapU64, test_map_u64, uint64_t)
+TYPED_MAP_ISTR(TestMapStr, test_map_str, const char)
+
+static MunitResult test_typed_map(const MunitParameter params[], void* user_data_or_fixture) {
+    static uint64_t values[2048];
+
+    /* uint32_t keys */
+    TestMapU32 map32 = {0};
+    munit_assert_null(test_map_u32_get(&map32, 1));
+    munit_assert_false(test_map_u32_remove(&map32, 1));
+    munit_assert_int(test_map_u32_begin(&map32), ==, test_map_u32_end(&map32));
+
+    for (uint32_t idx = 0; idx < 2048; ++idx) {
+        values[idx] = idx * idx;
+        test_map_u32_put(&map32, idx, &values[idx]);
+    }
+    munit_assert_size(map32.len, ==, 2048);
+
+    for (uint32_t idx = 0; idx < 2048; ++idx) {
+        munit_assert_ptr_equal(test_map_u32_get(&map32, idx), &values[idx]);
+    }
+    munit_assert_false(test_map_u32_has(&map32, 2048));
+
+    for (uint32_t idx = 0; idx < 2048; idx += 2) {
+        munit_assert_true(test_map_u32_remove(&map32, idx));
+    }
+    munit_assert_size(map32.len, ==, 1024);
+
+    uint64_t sum = 0;
+    int count = 0;
+    for (int iter = test_map_u32_begin(&map32); iter != test_map_u32_end(&map32); iter = test_map_u32_next(&map32, iter)) {
+        munit_assert_uint64(map32.slots[iter].key & 1, ==, 1);
+        sum += *map32.slots[iter].val;
+        ++count;
+    }
+    munit_assert_int(count, ==, 1024);
+    munit_assert_uint64(sum, ==, 1431655424);    // sum of the squares of the odd keys
+
+    size_t cap = map32.cap;
+    test_map_u32_clear(&map32);
+    munit_assert_size(map32.len, ==, 0);
+    munit_assert_null(test_map_u32_get(&map32, 1));
+    test_map_u32_put(&map32, 1, &values[0]);
+    munit_assert_ptr_equal(test_map_u32_get(&map32, 1), &values[0]);
+    munit_assert_size(map32.cap, ==, cap);
+    test_map_u32_free(&map32);
+
+    /* uint64_t keys: the upper bits are significant */
+    TestMapU64 map64 = {0};
+    test_map_u64_reserve(&map64, 1000);
+    cap = map64.cap;
+    for (uint64_t idx = 0; idx < 1000; ++idx) {
+        test_map_u64_put(&map64, idx << 40, &values[idx]);
+    }
+    munit_assert_size(map64.cap, ==, cap);
+    for (uint64_t idx = 0; idx < 1000; ++idx) {
+        munit_assert_ptr_equal(test_map_u64_get(&map64, idx << 40), &values[idx]);
+        munit_assert_false(test_map_u64_has(&map64, (idx << 40) | 1));
+    }
+    test_map_u64_put(&map64, 0, &values[1]);
+    munit_assert_ptr_equal(test_map_u64_get(&map64, 0), &values[1]);
+    munit_assert_size(map64.len, ==, 1000);
+    test_map_u64_free(&map64);
+
+    /* interned strings: compared by address, not by content */
+    static const char *names[] = {"first", "second", "third"};
+    char copy[] = "first";
+
+    TestMapStr map_str = {0};
+    for (int idx = 0; idx < 3; ++idx) {
+        test_map_str_put(&map_str, names[idx], names[(idx + 1) % 3]);
+    }
+    munit_assert_string_equal(test_map_str_get(&map_str, names[0]), "second");
+    munit_assert_string_equal(test_map_str_get(&map_str, names[2]), "first");
+    munit_assert_false(test_map_str_has(&map_str, copy));
+    test_map_str_free(&map_str);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_intern(const MunitParameter params[], void* user_data_or_fixture) {
+    InternTable table = {0};
+    char buffer[32];
+
+    munit_assert_null(intern_find(&table, "first"));
+
+    /* equal strings intern to the same copy, whatever their address */
+    const char *first = intern_str(&table, "first");
+    strcpy(buffer, "first");
+    munit_assert_ptr_equal(intern_str(&table, buffer), first);
+    munit_assert_ptr_equal(intern_find(&table, buffer), first);
+    munit_assert_ptr_not_equal(first, buffer);
+    munit_assert_string_equal(first, "first");
+
+    const char *second = intern_str(&table, "second");
+    munit_assert_ptr_not_equal(first, second);
+    munit_assert_size(intern_count(&table), ==, 2);
+
+    /* the copies stay valid while the table grows */
+    for (int idx = 0; idx < 1000; ++idx) {
+        snprintf(buffer, sizeof(buffer), "%%string_%d", idx);
+        intern_str(&table, buffer);
+    }
+    munit_assert_size(intern_count(&table), ==, 1002);
+    munit_assert_ptr_equal(intern_find(&table, "first"), first);
+    munit_assert_string_equal(second, "second");
+
+    /* interned strings as the keys of a typed map */
+    TestMapStr map = {0};
+    test_map_str_put(&map, first, second);
+    test_map_str_put(&map, second, first);
+    munit_assert_ptr_equal(test_map_str_get(&map, intern_str(&table, "first")), second);
+    munit_assert_ptr_equal(test_map_str_get(&map, intern_find(&table, "second")), first);
+    test_map_str_free(&map);
+
+    intern_free(&table);
+    munit_assert_size(intern_count(&table), ==, 0);
+
+    return MUNIT_OK;
+}
+
+/* reference: the previous engine (linear probing, modulo indexing, separate key and value arrays, grows at 50% load) */
+typedef struct RefMap {
+    size_t len;
+    size_t cap;
+    uint64_t *keys;
+    uint64_t *vals;
+    uint8_t *used;
+} RefMap;
+
+static uint64_t ref_hash(uint64_t key) {
+    key ^= (key >> 33);
+    key *= 0xff51afd7ed558ccd;
+    key ^= (key >> 33);
+    key *= 0xc4ceb9fe1a85ec53;
+    key ^= (key >> 33);
+    return key;
+}
+
+static void ref_put(RefMap *map, uint64_t key, uint64_t val);
+
+static void ref_grow(RefMap *map) {
+    RefMap old = *map;
+    size_t cap = (old.cap < 16) ? 16 : old.cap * 2;
+
+    *map = (RefMap) {
+        .cap = cap,
+        .keys = calloc(cap, sizeof(uint64_t)),
+        .vals = calloc(cap, sizeof(uint64_t)),
+        .used = calloc(cap, sizeof(uint8_t))
+    };
+
+    for (size_t idx = 0; idx < old.cap; ++idx) {
+        if (old.used[idx]) {
+            ref_put(map, old.keys[idx], old.vals[idx]);
+        }
+    }
+
+    free(old.keys);
+    free(old.vals);
+    free(old.used);
+}
+
+static void ref_put(RefMap *map, uint64_t key, uint64_t val) {
+    if (map->len * 2 >= map->cap) {
+        ref_grow(map);
+    }
+
+    for (uint64_t idx = ref_hash(key) % map->cap; ; idx = (idx + 1) % map->cap) {
+        if (!map->used[idx]) {
+            map->keys[idx] = key;
+            map->vals[idx] = val;
+            map->used[idx] = 1;
+            map->len++;
+            return;
+        } else if (memcmp(&map->keys[idx], &key, sizeof(key)) == 0) {
+            map->vals[idx] = val;
+            return;
+        }
+    }
+}
+
+static uint64_t ref_get(RefMap *map, uint64_t key) {
+    if (map->cap == 0) {
+        return 0;
+    }
+
+    for (uint64_t idx = ref_hash(key) % map->cap; ; idx = (idx + 1) % map->cap) {
+        if (!map->used[idx]) {
+            return 0;
+        } else if (memcmp(&map->keys[idx], &key, sizeof(key)) == 0) {
+            return map->vals[idx];
+        }
+    }
+}
+
+static void ref_free(RefMap *map) {
+    free(map->keys);
+    free(map->vals);
+    free(map->used);
+    *map = (RefMap) {0};
+}
+
+#define BENCH_KEYS      (1 << 16)
+#define BENCH_ROUNDS    8
+
+static MunitResult test_benchmark(const MunitParameter params[], void* user_data_or_fixture) {
+/* insert ids (dense, like SPIR-V ids) and addresses (sparse), then look up hits and misses.
+   Only runs when the SHADER_SIM_BENCHMARK environment variable is set, compare timings of Release builds only. */
+    static uint64_t keys[BENCH_KEYS];
+    uint64_t checksum[3] = {0, 0, 0};
+    uint64_t elapsed[3] = {0, 0, 0};
+
+    if (getenv("SHADER_SIM_BENCHMARK") == NULL) {
+        return MUNIT_SKIP;
+    }
+
+    for (int pattern = 0; pattern < 2; ++pattern) {
+        for (uint64_t idx = 0; idx < BENCH_KEYS; ++idx) {
+            keys[idx] = (pattern == 0) ? idx + 1 : (idx * 0x9e3779b97f4a7c15ull) | 1;
+        }
+
+        for (int round = 0; round < BENCH_ROUNDS; ++round) {
+            uint64_t start = time_now_ns();
+            HashMap map = {0};
+            for (uint64_t idx = 0; idx < BENCH_KEYS; ++idx) {
+                map_int_int_put(&map, keys[idx], idx);
+            }
+            for (uint64_t idx = 0; idx < BENCH_KEYS; ++idx) {
+                checksum[0] += map_int_int_get(&map, keys[idx]);
+                checksum[0] += map_int_int_get(&map, keys[idx] ^ (1ull << 63));
+            }
+            munit_assert_size(map_len(&map), ==, BENCH_KEYS);
+            map_free(&map);
+            elapsed[0] += time_now_ns() - start;
+
+            start = time_now_ns();
+            RefMap ref = {0};
+            for (uint64_t idx = 0; idx < BENCH_KEYS; ++idx) {
+                ref_put(&ref, keys[idx], idx);
+            }
+            for (uint64_t idx = 0; idx < BENCH_KEYS; ++idx) {
+                checksum[1] += ref_get(&ref, keys[idx]);
+                checksum[1] += ref_get(&ref, keys[idx] ^ (1ull << 63));
+            }
+            munit_assert_size(ref.len, ==, BENCH_KEYS);
+            ref_free(&ref);
+            elapsed[1] += time_now_ns() - start;
+
+            start = time_now_ns();
+            TestMapU64 typed = {0};
+            for (uint64_t idx = 0; idx < BENCH_KEYS; ++idx) {
+                test_map_u64_put(&typed, keys[idx], &keys[idx]);
+            }
+            for (uint64_t idx = 0; idx < BENCH_KEYS; ++idx) {
+                uint64_t *hit = test_map_u64_get(&typed, keys[idx]);
+                uint64_t *miss = test_map_u64_get(&typed, keys[idx] ^ (1ull << 63));
+                checksum[2] += (hit != NULL) ? (uint64_t) (hit - keys) : 0;
+                checksum[2] += (miss != NULL) ? (uint64_t) (miss - keys) : 0;
+            }
+            munit_assert_size(typed.len, ==, BENCH_KEYS);
+            test_map_u64_free(&typed);
+            elapsed[2] += time_now_ns() - start;
+        }
+    }
+
+    /* both engines find the same values, the timings are informational */
+    munit_assert_uint64(checksum[0], ==, checksum[1]);
+    munit_assert_uint64(checksum[0], ==, checksum[2]);
+    munit_logf(MUNIT_LOG_INFO, "hash_map: %.3f ms, previous engine: %.3f ms, typed_map: %.3f ms",
+               elapsed[0] / 1e6, elapsed[1] / 1e6, elapsed[2] / 1e6);
+
+    return MUNIT_OK;
+}
+
 MunitTest hash_map_tests[] = {
     { "/pointer", test_pointer, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { "/integer", test_integer, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { "/string", test_string, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { "/iteration", test_iteration, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { "/empty", test_empty, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/remove", test_remove, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/clear_reserve", test_clear_reserve, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/typed_map", test_typed_map, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/intern", test_intern, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
+    { "/benchmark", test_benchmark, NULL, NULL,  MUNIT_TEST_OPTION_NONE, NULL },
     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
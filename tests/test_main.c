@@ -2,8 +2,10 @@
 
 extern MunitTest dyn_array_tests[];
 extern MunitTest hash_map_tests[];
+extern MunitTest allocator_tests[];
 extern MunitTest basic_ops_tests[];
 extern MunitTest spirv_sim_tests[];
+extern MunitTest fast_math_tests[];
 
 static MunitSuite extern_suites[] = {
     { .prefix = "/dyn_array", 
@@ -18,6 +20,12 @@ static MunitSuite extern_suites[] = {
       .iterations = 1,
       .options = MUNIT_SUITE_OPTION_NONE
     },
+    { .prefix = "/allocator",
+      .tests = allocator_tests,
+      .suites = NULL,
+      .iterations = 1,
+      .options = MUNIT_SUITE_OPTION_NONE
+    },
     { .prefix = "/basic_ops",
       .tests = basic_ops_tests,
       .suites = NULL,
@@ -30,6 +38,12 @@ static MunitSuite extern_suites[] = {
       .iterations = 1,
       .options = MUNIT_SUITE_OPTION_NONE
     },
+    { .prefix = "/fast_math",
+      .tests = fast_math_tests,
+      .suites = NULL,
+      .iterations = 1,
+      .options = MUNIT_SUITE_OPTION_NONE
+    },
     { NULL, NULL, NULL, 0, MUNIT_SUITE_OPTION_NONE}
 };
 
@@ -7,10 +7,23 @@
 #include "spirv_binary.h"
 #include "spirv_module.h"
 #include "spirv_simulator.h"
+#include "spirv_module_cache.h"
+#include "spirv_corpus.h"
+#include "spirv_text.h"
+#include "guarded_memory.h"
 #include "spirv/spirv.h"
 #include "spirv/GLSL.std.450.h"
 
 #include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#ifdef GUARDED_MEMORY_SUPPORTED
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #define S(a,b,c,d)  ((uint32_t) (d) << 24 | (c) << 16 | (b) << 8 | (a))
 #define ID(i) i
@@ -716,6 +729,498 @@ MunitResult test_aggregate(const MunitParameter params[], void* user_data_or_fix
     return MUNIT_OK;
 }
 
+MunitResult test_bind_data(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(50), SpvDecorationLocation, 0);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(51), SpvDecorationLocation, 0);
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32);
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(15), SpvStorageClassOutput, ID(11));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(14), ID(50), SpvStorageClassInput);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(51), SpvStorageClassOutput);
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(11), ID(60), ID(50));
+    SPIRV_OP(&spirv_bin, SpvOpFAdd, ID(11), ID(61), ID(60), ID(60));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(51), ID(61));
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 62;
+    spirv_bin_finalize(&spirv_bin);
+    
+    /* prepare simulator */
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+    
+    SPIRV_simulator spirv_sim;
+    float data_in[2][4] = {{1.0f, 2.0f, 3.0f, 4.0f}, {-1.5f, 0.0f, 0.5f, 10.0f}};
+    float data_out[2][4] = {0};
+
+    for (int run = 0; run < 2; ++run) {
+        spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+
+        /* only entire variables that are large enough can be bound */
+        munit_assert_false(spirv_sim_variable_bind_data(
+            &spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 0},
+            (uint8_t *) data_in[run], sizeof(float) * 2));
+        munit_assert_false(spirv_sim_variable_bind_data(
+            &spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 1},
+            (uint8_t *) data_in[run], sizeof(data_in[run])));
+
+        munit_assert_true(spirv_sim_variable_bind_data(
+            &spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 0},
+            (uint8_t *) data_in[run], sizeof(data_in[run])));
+        munit_assert_true(spirv_sim_variable_bind_data(
+            &spirv_sim, ClassOutput, (VariableAccess) {VarAccessLocation, 0},
+            (uint8_t *) data_out[run], sizeof(data_out[run])));
+
+        /* interface pointers follow the binding */
+        SimPointer *ptr = spirv_sim_retrieve_intf_pointer(
+            &spirv_sim, ClassOutput,
+            (VariableAccess) {VarAccessLocation, 0}
+        );
+        munit_assert_ptr_equal(spirv_sim_memory_ptr(&spirv_sim, ptr->pointer), data_out[run]);
+
+        /* run simulator */
+        while (!spirv_sim.finished && !spirv_sim.error_msg) {
+            spirv_sim_step(&spirv_sim);
+            munit_assert_null(spirv_sim.error_msg);
+        }
+
+        /* the result was written directly to the caller's buffer */
+        for (int i = 0; i < 4; ++i) {
+            munit_assert_float(data_out[run][i], ==, data_in[run][i] * 2.0f);
+        }
+
+        spirv_sim_shutdown(&spirv_sim);
+    }
+
+    /* clean-up */
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_interface_handle(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(50), SpvDecorationLocation, 0);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(51), SpvDecorationLocation, 0);
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32);
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(15), SpvStorageClassOutput, ID(11));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(14), ID(50), SpvStorageClassInput);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(51), SpvStorageClassOutput);
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(11), ID(60), ID(50));
+    SPIRV_OP(&spirv_bin, SpvOpFMul, ID(11), ID(61), ID(60), ID(60));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(51), ID(61));
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 62;
+    spirv_bin_finalize(&spirv_bin);
+    
+    /* prepare simulator */
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+    
+    SPIRV_simulator spirv_sim;
+    spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+
+    /* resolve the interface variables */
+    SimInterfaceHandle h_in = spirv_sim_resolve_interface(&spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 0});
+    SimInterfaceHandle h_out = spirv_sim_resolve_interface(&spirv_sim, ClassOutput, (VariableAccess) {VarAccessLocation, 0});
+    munit_assert_uint32(h_in, !=, SIM_INTERFACE_INVALID);
+    munit_assert_uint32(h_out, !=, SIM_INTERFACE_INVALID);
+    munit_assert_uint32(h_in, !=, h_out);
+    munit_assert_uint32(spirv_sim_resolve_interface(&spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 1}), ==, SIM_INTERFACE_INVALID);
+
+    SimInterface *intf = spirv_sim_interface(&spirv_sim, h_in);
+    munit_assert_uint32(intf->size, ==, sizeof(float) * 4);
+    munit_assert_uint32(intf->var->id, ==, 50);
+    munit_assert_int32(intf->member, ==, -1);
+
+    /* handles stay the same when the simulator is reinitialized for the same module */
+    float data_in[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+    float data_out[4] = {0};
+
+    for (int run = 0; run < 2; ++run) {
+        if (run > 0) {
+            spirv_sim_shutdown(&spirv_sim);
+            spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+            munit_assert_uint32(spirv_sim_resolve_interface(&spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 0}), ==, h_in);
+            munit_assert_uint32(spirv_sim_resolve_interface(&spirv_sim, ClassOutput, (VariableAccess) {VarAccessLocation, 0}), ==, h_out);
+        }
+
+        data_in[0] = (float) run;
+        spirv_sim_interface_write(&spirv_sim, h_in, data_in, sizeof(data_in));
+
+        while (!spirv_sim.finished && !spirv_sim.error_msg) {
+            spirv_sim_step(&spirv_sim);
+            munit_assert_null(spirv_sim.error_msg);
+        }
+
+        spirv_sim_interface_read(&spirv_sim, h_out, data_out, sizeof(data_out));
+        for (int i = 0; i < 4; ++i) {
+            munit_assert_float(data_out[i], ==, data_in[i] * data_in[i]);
+        }
+    }
+
+    /* binding through a handle, binding again only replaces the buffer */
+    float bound_a[4] = {0};
+    float bound_b[4] = {0};
+    munit_assert_true(spirv_sim_interface_bind(&spirv_sim, h_out, (uint8_t *) bound_a, sizeof(bound_a)));
+    munit_assert_ptr_equal(spirv_sim_interface_data(&spirv_sim, h_out), bound_a);
+    uint64_t bound_pointer = spirv_sim_interface(&spirv_sim, h_out)->ptr.pointer;
+    munit_assert_true(spirv_sim_interface_bind(&spirv_sim, h_out, (uint8_t *) bound_b, sizeof(bound_b)));
+    munit_assert_ptr_equal(spirv_sim_interface_data(&spirv_sim, h_out), bound_b);
+    munit_assert_uint64(spirv_sim_interface(&spirv_sim, h_out)->ptr.pointer, ==, bound_pointer);
+
+    /* clean-up */
+    spirv_sim_shutdown(&spirv_sim);
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_load_alias(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(50), SpvDecorationLocation, 0);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(51), SpvDecorationLocation, 0);
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32 | TEST_TYPE_UINT32);
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(15), SpvStorageClassInput, ID(12));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(16), SpvStorageClassOutput, ID(12));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(17), SpvStorageClassPrivate, ID(12));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(50), SpvStorageClassInput);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(16), ID(51), SpvStorageClassOutput);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(17), ID(52), SpvStorageClassPrivate);
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(12), ID(60), ID(50));
+    SPIRV_OP(&spirv_bin, SpvOpCompositeExtract, ID(11), ID(61), ID(60), 0);
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(12), ID(62), ID(51));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(51), ID(60));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(52), ID(62));
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(12), ID(63), ID(52));
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 64;
+    spirv_bin_finalize(&spirv_bin);
+    
+    /* prepare simulator */
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+    
+    SPIRV_simulator spirv_sim;
+    spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+
+    float data_in[16];
+    float data_out[16];
+    for (int i = 0; i < 16; ++i) {
+        data_in[i] = (float) i;
+        data_out[i] = (float) -i;
+    }
+
+    spirv_sim_variable_associate_data(
+        &spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 0},
+        (uint8_t *) data_in, sizeof(data_in));
+    spirv_sim_variable_associate_data(
+        &spirv_sim, ClassOutput, (VariableAccess) {VarAccessLocation, 0},
+        (uint8_t *) data_out, sizeof(data_out));
+
+    SimPointer *ptr_in = spirv_sim_retrieve_intf_pointer(&spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 0});
+    SimPointer *ptr_out = spirv_sim_retrieve_intf_pointer(&spirv_sim, ClassOutput, (VariableAccess) {VarAccessLocation, 0});
+
+    /* loading a mat4 doesn't copy the data */
+    spirv_sim_step(&spirv_sim);
+    SimRegister *reg = spirv_sim_register_by_id(&spirv_sim, 60);
+    munit_assert_not_null(reg);
+    munit_assert_int32(reg->alias, >=, 0);
+    munit_assert_ptr_equal(reg->raw, spirv_sim_memory_ptr(&spirv_sim, ptr_in->pointer));
+
+    /* smaller extracted parts are copied */
+    spirv_sim_step(&spirv_sim);
+    ASSERT_REGISTER_VEC4(&spirv_sim, 61, ==, 0.0f, 1.0f, 2.0f, 3.0f);
+
+    /* storing to aliased memory copies the old contents to the register first */
+    spirv_sim_step(&spirv_sim);
+    reg = spirv_sim_register_by_id(&spirv_sim, 62);
+    munit_assert_int32(reg->alias, >=, 0);
+    munit_assert_ptr_equal(reg->raw, spirv_sim_memory_ptr(&spirv_sim, ptr_out->pointer));
+
+    spirv_sim_step(&spirv_sim);
+    munit_assert_int32(reg->alias, ==, -1);
+    munit_assert_ptr_not_equal(reg->raw, spirv_sim_memory_ptr(&spirv_sim, ptr_out->pointer));
+    munit_assert_memory_equal(sizeof(data_out), reg->raw, data_out);
+    munit_assert_memory_equal(sizeof(data_in), spirv_sim_memory_ptr(&spirv_sim, ptr_out->pointer), data_in);
+
+    /* run the remainder of the shader */
+    while (!spirv_sim.finished && !spirv_sim.error_msg) {
+        spirv_sim_step(&spirv_sim);
+        munit_assert_null(spirv_sim.error_msg);
+    }
+
+    reg = spirv_sim_register_by_id(&spirv_sim, 63);
+    munit_assert_memory_equal(sizeof(data_out), reg->raw, data_out);
+
+    /* clean-up */
+    spirv_sim_shutdown(&spirv_sim);
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_storage_buffer(const MunitParameter params[], void* user_data_or_fixture) {
+
+    typedef struct Buffer {
+        uint32_t count;
+        float data[1000];
+    } Buffer;
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(50), SpvDecorationLocation, 0);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(51), SpvDecorationLocation, 0);
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32 | TEST_TYPE_UINT32);
+    SPIRV_OP(&spirv_bin, SpvOpTypeRuntimeArray, ID(40), ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpTypeStruct, ID(41), ID(30), ID(40));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(42), SpvStorageClassStorageBuffer, ID(41));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(43), SpvStorageClassStorageBuffer, ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(42), ID(50), SpvStorageClassStorageBuffer);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(33), ID(51), SpvStorageClassInput);
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(30), ID(60), 0);
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(30), ID(61), 1);
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(30), ID(70), ID(51));
+    SPIRV_OP(&spirv_bin, SpvOpAccessChain, ID(43), ID(71), ID(50), ID(61), ID(70));
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(10), ID(72), ID(71));
+    SPIRV_OP(&spirv_bin, SpvOpFAdd, ID(10), ID(73), ID(72), ID(72));
+    SPIRV_OP(&spirv_bin, SpvOpAccessChain, ID(43), ID(74), ID(50), ID(61), ID(60));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(74), ID(73));
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 75;
+    spirv_bin_finalize(&spirv_bin);
+    
+    /* prepare simulator */
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+    
+    SPIRV_simulator spirv_sim;
+    spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+
+    /* the runtime array doesn't take up memory until a buffer is bound */
+    static Buffer buffer = {1000, {0}};
+    buffer.data[777] = 21.5f;
+    uint32_t index = 777;
+
+    munit_assert_true(spirv_sim_variable_bind_data(
+        &spirv_sim, ClassStorageBuffer, (VariableAccess) {VarAccessLocation, 0},
+        (uint8_t *) &buffer, sizeof(buffer)));
+    spirv_sim_variable_associate_data(
+        &spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 0},
+        (uint8_t *) &index, sizeof(index));
+
+    /* run simulator */
+    while (!spirv_sim.finished && !spirv_sim.error_msg) {
+        spirv_sim_step(&spirv_sim);
+        munit_assert_null(spirv_sim.error_msg);
+    }
+
+    /* pointers into the buffer: segment in the upper bits, dynamic index in the offset */
+    SimRegister *reg = spirv_sim_register_by_id(&spirv_sim, 71);
+    munit_assert_uint64(reg->addr[0] >> SIM_SEGMENT_SHIFT, ==, 1);
+    munit_assert_uint64(reg->addr[0] & SIM_OFFSET_MASK, ==, offsetof(Buffer, data) + 777 * sizeof(float));
+    munit_assert_ptr_equal(spirv_sim_memory_ptr(&spirv_sim, reg->addr[0]), &buffer.data[777]);
+
+    munit_assert_float(buffer.data[0], ==, 43.0f);
+
+    /* clean-up */
+    spirv_sim_shutdown(&spirv_sim);
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_guard_pages(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(51), SpvDecorationLocation, 0);
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32 | TEST_TYPE_UINT32);
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(30), ID(60), 4);
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(61), FLOAT(1.5f));
+    SPIRV_OP(&spirv_bin, SpvOpTypeArray, ID(40), ID(10), ID(60));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(41), SpvStorageClassPrivate, ID(40));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(42), SpvStorageClassPrivate, ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(41), ID(50), SpvStorageClassPrivate);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(33), ID(51), SpvStorageClassInput);
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(30), ID(70), ID(51));
+    SPIRV_OP(&spirv_bin, SpvOpAccessChain, ID(42), ID(71), ID(50), ID(70));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(71), ID(61));
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 72;
+    spirv_bin_finalize(&spirv_bin);
+    
+    /* prepare simulator */
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+    
+    SPIRV_simulator spirv_sim;
+    uint32_t indices[] = {3, 64};
+
+    for (int run = 0; run < 2; ++run) {
+        spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+
+        if (!spirv_sim_use_guard_pages(&spirv_sim)) {
+            spirv_sim_shutdown(&spirv_sim);
+            spirv_module_free(&spirv_module);
+            spirv_bin_free(&spirv_bin);
+            return MUNIT_SKIP;
+        }
+
+        spirv_sim_variable_associate_data(
+            &spirv_sim, ClassInput, (VariableAccess) {VarAccessLocation, 0},
+            (uint8_t *) &indices[run], sizeof(uint32_t));
+
+        while (!spirv_sim.finished && !spirv_sim.error_msg) {
+            spirv_sim_step(&spirv_sim);
+        }
+
+        if (run == 0) {
+            /* in bounds */
+            munit_assert_null(spirv_sim.error_msg);
+            float *data = (float *) (spirv_sim.memory + spirv_module_variable_by_id(&spirv_module, 50)->mem_offset);
+            munit_assert_float(data[3], ==, 1.5f);
+        } else {
+            /* out of bounds: the faulting store is reported instead of crashing the process */
+            munit_assert_not_null(spirv_sim.error_msg);
+            munit_assert_not_null(strstr(spirv_sim.error_msg, "Out of bounds"));
+            munit_assert_false(spirv_sim.finished);
+        }
+
+        spirv_sim_shutdown(&spirv_sim);
+    }
+
+    /* clean-up */
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_guard_pages_other_faults(const MunitParameter params[], void* user_data_or_fixture) {
+#ifdef GUARDED_MEMORY_SUPPORTED
+    /* a fault outside of the guard pages must not be swallowed, even while faults are being caught.
+       Crash a child process and check it wasn't caught (exit code 42) and didn't survive (exit code 43). */
+    pid_t pid = fork();
+    munit_assert_int(pid, >=, 0);
+
+    if (pid == 0) {
+        uint8_t *block = guarded_memory_alloc(16);
+        if (block == NULL) {
+            _exit(0);
+        }
+
+        sigjmp_buf env;
+        if (sigsetjmp(env, 0) != 0) {
+            _exit(42);
+        }
+        guarded_memory_catch_faults(&env);
+
+        volatile int *null_ptr = NULL;
+        *null_ptr = 1;
+        _exit(43);
+    }
+
+    int status = 0;
+    munit_assert_int(waitpid(pid, &status, 0), ==, pid);
+    munit_assert_false(WIFEXITED(status) && (WEXITSTATUS(status) == 42 || WEXITSTATUS(status) == 43));
+
+    return MUNIT_OK;
+#else
+    return MUNIT_SKIP;
+#endif
+}
+
+MunitResult test_decorations(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(50), SpvDecorationDescriptorSet, 1);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(50), SpvDecorationBinding, 3);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(41), SpvDecorationArrayStride, 16);
+    SPIRV_OP(&spirv_bin, SpvOpDecorate, ID(42), SpvDecorationBlock);
+    SPIRV_OP(&spirv_bin, SpvOpMemberDecorate, ID(42), 0, SpvDecorationOffset, 0);
+    SPIRV_OP(&spirv_bin, SpvOpMemberDecorate, ID(42), 1, SpvDecorationOffset, 16);
+    SPIRV_OP(&spirv_bin, SpvOpMemberDecorate, ID(42), 1, SpvDecorationBuiltIn, SpvBuiltInPosition);
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32 | TEST_TYPE_UINT32);
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(30), ID(60), 4);
+    SPIRV_OP(&spirv_bin, SpvOpTypeArray, ID(41), ID(11), ID(60));
+    SPIRV_OP(&spirv_bin, SpvOpTypeStruct, ID(42), ID(10), ID(41));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(43), SpvStorageClassUniform, ID(42));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(43), ID(50), SpvStorageClassUniform);
+    spirv_common_function_header_main(&spirv_bin);
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 61;
+    spirv_bin_finalize(&spirv_bin);
+    
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+
+    /* decorations of an id */
+    const Decorations *var_dec = spirv_module_decorations(&spirv_module, 50, -1);
+    munit_assert_true(spirv_decorations_has(var_dec, SpvDecorationDescriptorSet));
+    munit_assert_true(spirv_decorations_has(var_dec, SpvDecorationBinding));
+    munit_assert_false(spirv_decorations_has(var_dec, SpvDecorationLocation));
+    munit_assert_uint32(var_dec->descriptor_set, ==, 1);
+    munit_assert_uint32(var_dec->binding, ==, 3);
+
+    munit_assert_uint32(spirv_module_decorations(&spirv_module, 41, -1)->array_stride, ==, 16);
+    munit_assert_true(spirv_decorations_has(spirv_module_decorations(&spirv_module, 42, -1), SpvDecorationBlock));
+
+    /* decorations of the members of a structure */
+    const Decorations *member_dec = spirv_module_decorations(&spirv_module, 42, 1);
+    munit_assert_true(spirv_decorations_has(member_dec, SpvDecorationOffset));
+    munit_assert_uint32(member_dec->offset, ==, 16);
+    munit_assert_uint32(member_dec->builtin, ==, SpvBuiltInPosition);
+    munit_assert_false(spirv_decorations_has(spirv_module_decorations(&spirv_module, 42, 0), SpvDecorationBuiltIn));
+    munit_assert_uint64(spirv_module_decorations(&spirv_module, 42, 2)->present, ==, 0);
+    munit_assert_uint64(spirv_module_decorations(&spirv_module, 200, -1)->present, ==, 0);
+
+    /* variable access is resolved from the decoration table */
+    Variable *var = spirv_module_variable_by_id(&spirv_module, 50);
+    munit_assert_int(var->member_access[1].kind, ==, VarAccessBuiltIn);
+    munit_assert_int(var->member_access[1].index, ==, SpvBuiltInPosition);
+    munit_assert_int(var->member_access[0].kind, ==, VarAccessNone);
+
+    /* clean-up */
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
 MunitResult test_function(const MunitParameter params[], void* user_data_or_fixture) {
 
     /* prepare binary */
@@ -784,6 +1289,572 @@ MunitResult test_function(const MunitParameter params[], void* user_data_or_fixt
     return MUNIT_OK;
 } 
 
+MunitResult test_binary_borrowed(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32);
+    spirv_common_function_header_main(&spirv_bin);
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 30;
+    spirv_bin_finalize(&spirv_bin);
+
+    /* load the words of the binary without copying them */
+    const uint32_t *words = (const uint32_t *) spirv_bin.binary_data;
+    size_t word_count = arr_len(spirv_bin.binary_data) / 4;
+
+    SPIRV_binary borrowed;
+    munit_assert_true(spirv_bin_load_borrowed(&borrowed, words, word_count));
+    munit_assert_null(borrowed.binary_data);
+    munit_assert_ptr_equal(borrowed.fst_op, words + 5);
+    munit_assert_ptr_equal(borrowed.end_op, words + word_count);
+    munit_assert_uint32(borrowed.header.bound_ids, ==, 30);
+
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &borrowed);
+    munit_assert_not_null(spirv_module_type_by_id(&spirv_module, 11));
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&borrowed);
+
+    /* validation */
+    munit_assert_false(spirv_bin_load_borrowed(&borrowed, words, 4));
+    munit_assert_not_null(borrowed.error_msg);
+    munit_assert_false(spirv_bin_load_borrowed(&borrowed, words + 1, word_count - 1));
+    munit_assert_not_null(borrowed.error_msg);
+
+    /* clean-up */
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_module_malformed(const MunitParameter params[], void* user_data_or_fixture) {
+/* ids and bounds from a malformed binary fail the load instead of writing past the id table */
+    static const struct {
+        uint32_t bound;
+        uint32_t opcode;
+        uint32_t id;
+        uint32_t member;
+    } cases[] = {
+        {10, SpvOpName, 0xffffffff, 0},
+        {10, SpvOpName, 0x10000000, 0},
+        {0xffffffff, SpvOpName, 1, 0},
+        {10, SpvOpMemberName, 1, 0x7fffffff},
+        {10, SpvOpMemberDecorate, 1, 0xffffffff},
+    };
+
+    for (size_t idx = 0; idx < sizeof(cases) / sizeof(cases[0]); ++idx) {
+        SPIRV_binary spirv_bin;
+        spirv_bin_init(&spirv_bin, 1, 0);
+
+        if (cases[idx].opcode == SpvOpName) {
+            SPIRV_OP(&spirv_bin, SpvOpName, ID(cases[idx].id), S('b','a','d',0));
+        } else if (cases[idx].opcode == SpvOpMemberName) {
+            SPIRV_OP(&spirv_bin, SpvOpMemberName, ID(cases[idx].id), cases[idx].member, S('b','a','d',0));
+        } else {
+            SPIRV_OP(&spirv_bin, SpvOpMemberDecorate, ID(cases[idx].id), cases[idx].member, SpvDecorationLocation, 0);
+        }
+        spirv_bin.header.bound_ids = cases[idx].bound;
+        spirv_bin_finalize(&spirv_bin);
+
+        SPIRV_module spirv_module;
+        munit_assert_false(spirv_module_load(&spirv_module, &spirv_bin));
+        munit_assert_not_null(spirv_module.error_msg);
+        spirv_module_free(&spirv_module);
+        spirv_bin_free(&spirv_bin);
+    }
+
+    /* ids beyond the bound in the header are still accepted */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+    SPIRV_OP(&spirv_bin, SpvOpName, ID(1000), S('o','k',0,0));
+    spirv_bin.header.bound_ids = 10;
+    spirv_bin_finalize(&spirv_bin);
+
+    SPIRV_module spirv_module;
+    munit_assert_true(spirv_module_load(&spirv_module, &spirv_bin));
+    munit_assert_null(spirv_module.error_msg);
+    munit_assert_string_equal(spirv_module_name_by_id(&spirv_module, 1000, -1), "ok");
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_module_cache(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpName, ID(42), S('o', 'u', 't', 0));
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32);
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(15), SpvStorageClassFunction, ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpTypeFunction, ID(40), ID(10), ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpTypeFunction, ID(41), ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(45), FLOAT(5.5f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(46), FLOAT(33.7f));
+    SPIRV_OP(&spirv_bin, SpvOpConstantComposite, ID(11), ID(47), ID(45), ID(46), ID(45), ID(46));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(42), SpvStorageClassOutput);
+    /* entry point */
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(42), ID(46));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionCall, ID(10), ID(81), ID(60), ID(45));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionCall, ID(10), ID(82), ID(70));
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(10), ID(83), ID(42));
+    spirv_common_function_footer(&spirv_bin);
+    /* function float f40(float) */
+    SPIRV_OP(&spirv_bin, SpvOpFunction, ID(10), ID(60), SpvFunctionControlMaskNone, ID(40));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionParameter, ID(10), ID(61));
+    SPIRV_OP(&spirv_bin, SpvOpLabel, ID(62));
+    SPIRV_OP(&spirv_bin, SpvOpFMul, ID(10), ID(63), ID(61), ID(61));
+    SPIRV_OP(&spirv_bin, SpvOpReturnValue, ID(63));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionEnd);
+    /* function float f41(void) */
+    SPIRV_OP(&spirv_bin, SpvOpFunction, ID(10), ID(70), SpvFunctionControlMaskNone, ID(41));
+    SPIRV_OP(&spirv_bin, SpvOpLabel, ID(71));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(72), SpvStorageClassFunction);
+    SPIRV_OP(&spirv_bin, SpvOpFAdd, ID(10), ID(73), ID(45), ID(45));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(72), ID(73));
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(10), ID(74), ID(72));
+    SPIRV_OP(&spirv_bin, SpvOpFMul, ID(10), ID(75), ID(74), ID(45));
+    SPIRV_OP(&spirv_bin, SpvOpReturnValue, ID(75));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionEnd);
+    spirv_bin.header.bound_ids = 84; 
+    spirv_bin_finalize(&spirv_bin);
+
+    /* store the module in the cache (current directory) */
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+    munit_assert_true(spirv_module_cache_store(".", &spirv_module));
+    spirv_module_free(&spirv_module);
+
+    /* load the cached module for a copy of the binary at another address */
+    int8_t *data = NULL;
+    arr_push_buf(data, spirv_bin.binary_data, arr_len(spirv_bin.binary_data));
+
+    SPIRV_binary spirv_copy;
+    munit_assert_true(spirv_bin_load(&spirv_copy, data));
+    munit_assert_true(spirv_module_cache_load(".", &spirv_module, &spirv_copy));
+    munit_assert_not_null(spirv_module.image.data);
+
+    munit_assert_string_equal(spirv_module_name_by_id(&spirv_module, 42, -1), "out");
+    munit_assert_ptr_equal(spirv_module.spirv_bin, &spirv_copy);
+    munit_assert_uint32(spirv_module_opcode_count(&spirv_module), ==, arr_len(spirv_module.opcode_array));
+    for (uint32_t idx = 0; idx < spirv_module_opcode_count(&spirv_module); ++idx) {
+        SPIRV_opcode *op = spirv_module_opcode_by_index(&spirv_module, idx);
+        munit_assert_uint32(spirv_module_index_for_opcode(&spirv_module, op), ==, idx);
+    }
+    munit_assert_uint32(spirv_module_index_for_opcode(&spirv_module, spirv_bin_opcode_end(&spirv_copy)), ==,
+                        spirv_module_opcode_count(&spirv_module));
+    munit_assert_ptr_equal((uint32_t *) spirv_module_function_by_id(&spirv_module, 70)->fst_opcode,
+                           (uint32_t *) spirv_module_opcode_by_label(&spirv_module, 71) + 6);
+    Constant *vec = spirv_module_constant_by_id(&spirv_module, 47);
+    munit_assert_ptr_equal(vec->type, spirv_module_type_by_id(&spirv_module, 11));
+    munit_assert_float(vec->value.as_float_array[1], ==, 33.7f);
+    munit_assert_float(vec->value.as_float_array[2], ==, 5.5f);
+
+    /* the cached module can be simulated */
+    SPIRV_simulator spirv_sim;
+    spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+
+    while (!spirv_sim.finished && !spirv_sim.error_msg) {
+        spirv_sim_step(&spirv_sim);
+        munit_assert_null(spirv_sim.error_msg);
+    }
+
+    ASSERT_REGISTER_FLOAT(&spirv_sim, ID(81), ==, 5.5f * 5.5f);
+    ASSERT_REGISTER_FLOAT(&spirv_sim, ID(82), ==, (5.5f + 5.5f) * 5.5f);
+    ASSERT_REGISTER_FLOAT(&spirv_sim, ID(83), ==, 33.7f);
+
+    /* a modified binary doesn't match the cached module: flip a bit in an operand near the end of the words */
+    SPIRV_module other_module;
+    uint32_t *operand = spirv_copy.end_op - 3;
+    munit_assert_true(operand >= spirv_copy.fst_op && operand < spirv_copy.end_op);
+    *operand ^= 1;
+    munit_assert_false(spirv_module_cache_load(".", &other_module, &spirv_copy));
+    *operand ^= 1;
+
+    /* clean-up */
+    char cache_file[64];
+    snprintf(cache_file, sizeof(cache_file), "%016" PRIx64 ".ssm", spirv_module_cache_key(&spirv_copy));
+    remove(cache_file);
+
+    spirv_sim_shutdown(&spirv_sim);
+    spirv_module_free(&spirv_module);
+    arr_free(data);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_corpus(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpName, ID(42), S('o', 'u', 't', 0));
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32);
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(15), SpvStorageClassOutput, ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(45), FLOAT(5.5f));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(42), SpvStorageClassOutput);
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(42), ID(45));
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin_finalize(&spirv_bin);
+
+    /* write a few valid binaries and a truncated one to the current directory */
+    static const char *valid_files[] = {"corpus_test_0.spv", "corpus_test_1.spv", "corpus_test_2.spv"};
+    static const char *invalid_file = "corpus_test_3.spv";
+
+    for (int idx = 0; idx < 3; ++idx) {
+        FILE *fp = fopen(valid_files[idx], "wb");
+        munit_assert_not_null(fp);
+        fwrite(spirv_bin.binary_data, 1, arr_len(spirv_bin.binary_data), fp);
+        fclose(fp);
+    }
+
+    FILE *fp = fopen(invalid_file, "wb");
+    munit_assert_not_null(fp);
+    fwrite(spirv_bin.binary_data, 1, 12, fp);
+    fclose(fp);
+
+    /* load the corpus on a number of workers */
+    SPIRV_corpus corpus;
+    munit_assert_true(spirv_corpus_scan(&corpus, "."));
+    spirv_corpus_load(&corpus, 4, true);
+
+    int found = 0;
+
+    for (SPIRV_corpus_file *file = corpus.files; file != arr_end(corpus.files); ++file) {
+        const char *name = strrchr(file->filename, '/');
+        name = (name) ? name + 1 : file->filename;
+
+        if (strcmp(name, invalid_file) == 0) {
+            munit_assert_false(file->success);
+            munit_assert_not_null(file->error_msg);
+            ++found;
+        } else if (strncmp(name, "corpus_test_", 12) == 0) {
+            munit_assert_true(file->success);
+            munit_assert_null(file->error_msg);
+            munit_assert_uint32(file->num_opcodes, >, 0);
+            munit_assert_size(file->text_size, >, 0);
+            ++found;
+        }
+    }
+
+    munit_assert_int(found, ==, 4);
+    munit_assert_uint32(corpus.num_failed, >=, 1);
+
+    /* clean-up */
+    for (int idx = 0; idx < 3; ++idx) {
+        remove(valid_files[idx]);
+    }
+    remove(invalid_file);
+
+    spirv_corpus_free(&corpus);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_disassembly(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpName, ID(42), S('o', 'u', 't', 0));
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32 | TEST_TYPE_INT32);
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(15), SpvStorageClassOutput, ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(45), FLOAT(5.5f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(20), ID(46), -3);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(42), SpvStorageClassOutput);
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(42), ID(45));
+    spirv_common_function_footer(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpFunction, ID(2), ID(50), SpvFunctionControlMaskNone, ID(3));
+    SPIRV_OP(&spirv_bin, SpvOpLabel, ID(51));
+    SPIRV_OP(&spirv_bin, SpvOpIAdd, ID(20), ID(52), ID(46), ID(46));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(42), ID(45));
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 53;
+    spirv_bin_finalize(&spirv_bin);
+
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+    spirv_text_set_flag(&spirv_module, SPIRV_TEXT_USE_ID_NAMES, true);
+    spirv_text_set_flag(&spirv_module, SPIRV_TEXT_USE_TYPE_ALIAS, true);
+    spirv_text_set_flag(&spirv_module, SPIRV_TEXT_USE_CONSTANT_ALIAS, true);
+
+    /* build the expected text (and spans) one line at a time */
+    char *expected = NULL;
+    SPIRV_text_span *expected_spans = NULL;
+    SPIRV_header *header = spirv_bin_header(&spirv_bin);
+    for (int idx = 0; idx < spirv_text_header_num_lines(header); ++idx) {
+        char *line = spirv_text_header_line(header, idx);
+        arr_strcat(expected, line);
+        arr_strcat(expected, "\n");
+        arr_free(line);
+    }
+
+    for (uint32_t idx = 0; idx < spirv_module_opcode_count(&spirv_module); ++idx) {
+        SPIRV_text_span *line_spans = NULL;
+        expected = spirv_text_opcode_append(expected, spirv_module_opcode_by_index(&spirv_module, idx), &spirv_module, &line_spans);
+        arr_push_buf(expected_spans, line_spans, arr_len(line_spans));
+        arr_strcat(expected, "\n");
+    }
+
+    /* into a single buffer */
+    char *text = spirv_text_module(NULL, &spirv_module);
+    munit_assert_string_equal(text, expected);
+    munit_assert_not_null(strstr(text, "%out"));
+    munit_assert_not_null(strstr(text, "%c-3"));
+
+    /* span offsets are relative to the start of the output buffer */
+    SPIRV_text_span *spans = NULL;
+    arr_clear(text);
+    arr_strcat(text, "prefix");
+    text = spirv_text_opcode_append(text, spirv_module_opcode_by_index(&spirv_module, 0), &spirv_module, &spans);
+    munit_assert_size(arr_len(spans), >, 0);
+    munit_assert_uint32(spans[0].kind, ==, SPAN_OP);
+    munit_assert_uint32(spans[0].start, >=, 6);
+    munit_assert_uint32(spans[arr_len(spans) - 1].end, <, arr_len(text));
+
+    /* in parallel, with a varying number of workers. Each run gets a freshly loaded module: the aliases
+       of the module above are already complete from the sequential disassembly. */
+    for (uint32_t num_workers = 1; num_workers <= 4; num_workers += 3) {
+        SPIRV_module fresh_module;
+        munit_assert_true(spirv_module_load(&fresh_module, &spirv_bin));
+        spirv_text_set_flag(&fresh_module, SPIRV_TEXT_USE_ID_NAMES, true);
+        spirv_text_set_flag(&fresh_module, SPIRV_TEXT_USE_TYPE_ALIAS, true);
+        spirv_text_set_flag(&fresh_module, SPIRV_TEXT_USE_CONSTANT_ALIAS, true);
+
+        SPIRV_text_span *spans = NULL;
+        char *parallel = spirv_text_module_parallel(NULL, &fresh_module, num_workers, &spans);
+        munit_assert_string_equal(parallel, expected);
+        munit_assert_size(arr_len(spans), ==, arr_len(expected_spans));
+        munit_assert_memory_equal(arr_len(spans) * sizeof(SPIRV_text_span), spans, expected_spans);
+        arr_free(parallel);
+        arr_free(spans);
+        spirv_module_free(&fresh_module);
+    }
+
+    /* straight to a file */
+    FILE *fp = tmpfile();
+    munit_assert_not_null(fp);
+    munit_assert_true(spirv_text_module_to_file(&spirv_module, fp));
+    size_t size = (size_t) ftell(fp);
+    munit_assert_size(size, ==, arr_len(expected));
+
+    char *file_text = malloc(size + 1);
+    rewind(fp);
+    munit_assert_size(fread(file_text, 1, size, fp), ==, size);
+    file_text[size] = '\0';
+    munit_assert_string_equal(file_text, expected);
+    fclose(fp);
+
+    /* clean-up */
+    free(file_text);
+    arr_free(text);
+    arr_free(expected);
+    arr_free(expected_spans);
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+MunitResult test_memory_layout(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32);
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(15), SpvStorageClassFunction, ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(16), SpvStorageClassFunction, ID(11));
+    SPIRV_OP(&spirv_bin, SpvOpTypePointer, ID(17), SpvStorageClassOutput, ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpTypeFunction, ID(40), ID(10), ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpTypeFunction, ID(41), ID(10));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(45), FLOAT(5.5f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(46), FLOAT(33.7f));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(17), ID(42), SpvStorageClassOutput);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(14), ID(43), SpvStorageClassInput);
+    /* entry point: 16 bytes of locals */
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(16), ID(50), SpvStorageClassFunction);
+    SPIRV_OP(&spirv_bin, SpvOpFunctionCall, ID(10), ID(81), ID(60), ID(45));
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(42), ID(81));
+    spirv_common_function_footer(&spirv_bin);
+    /* function float f60(float): 24 bytes of locals */
+    SPIRV_OP(&spirv_bin, SpvOpFunction, ID(10), ID(60), SpvFunctionControlMaskNone, ID(40));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionParameter, ID(10), ID(61));
+    SPIRV_OP(&spirv_bin, SpvOpLabel, ID(62));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(63), SpvStorageClassFunction);
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(16), ID(64), SpvStorageClassFunction);
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(63), ID(61));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionCall, ID(10), ID(65), ID(70));
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(10), ID(66), ID(63));
+    SPIRV_OP(&spirv_bin, SpvOpFAdd, ID(10), ID(67), ID(66), ID(65));
+    SPIRV_OP(&spirv_bin, SpvOpReturnValue, ID(67));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionEnd);
+    /* function float f70(void): 8 bytes of locals */
+    SPIRV_OP(&spirv_bin, SpvOpFunction, ID(10), ID(70), SpvFunctionControlMaskNone, ID(41));
+    SPIRV_OP(&spirv_bin, SpvOpLabel, ID(71));
+    SPIRV_OP(&spirv_bin, SpvOpVariable, ID(15), ID(72), SpvStorageClassFunction);
+    SPIRV_OP(&spirv_bin, SpvOpStore, ID(72), ID(46));
+    SPIRV_OP(&spirv_bin, SpvOpLoad, ID(10), ID(73), ID(72));
+    SPIRV_OP(&spirv_bin, SpvOpReturnValue, ID(73));
+    SPIRV_OP(&spirv_bin, SpvOpFunctionEnd);
+    spirv_bin.header.bound_ids = 84; 
+    spirv_bin_finalize(&spirv_bin);
+
+    /* check the layout computed by the module */
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+
+    munit_assert_uint32(spirv_module.globals_size, ==, 8 + 16);
+
+    /* the functions are decoded when first used: preparing the entry point also prepares its callees */
+    SPIRV_function *main = spirv_module.entry_points[0].function;
+    munit_assert_false(main->prepared);
+    munit_assert_null(spirv_module_variable_by_id(&spirv_module, 72));
+    spirv_module_function_prepare(&spirv_module, main);
+    munit_assert_uint32(spirv_module_variable_by_id(&spirv_module, 64)->mem_offset, ==, 8);
+
+    SPIRV_function *f70 = spirv_module_function_by_id(&spirv_module, 70);
+    munit_assert_true(f70->prepared);
+    munit_assert_uint32(f70->frame_size, ==, 8);
+    munit_assert_uint32(f70->stack_size, ==, 8);
+    SPIRV_function *f60 = spirv_module_function_by_id(&spirv_module, 60);
+    munit_assert_uint32(f60->frame_size, ==, 24);
+    munit_assert_uint32(f60->stack_size, ==, 24 + 8);
+    munit_assert_uint32(main->frame_size, ==, 16);
+    munit_assert_uint32(main->stack_size, ==, 16 + 24 + 8);
+
+    /* the simulator allocates all memory up front */
+    SPIRV_simulator spirv_sim;
+    spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+    munit_assert_uint32(spirv_sim.memory_size, ==, 24 + 48);
+
+    uint8_t *memory = spirv_sim.memory;
+
+    while (!spirv_sim.finished && !spirv_sim.error_msg) {
+        spirv_sim_step(&spirv_sim);
+        munit_assert_null(spirv_sim.error_msg);
+        munit_assert_ptr_equal(spirv_sim.memory, memory);
+        munit_assert_uint32(spirv_sim.memory_free_start, <=, spirv_sim.memory_size);
+
+        SimRegister *reg = spirv_sim_register_by_id(&spirv_sim, 72);
+        if (reg != NULL) {
+            /* the local variable of the deepest function is at the top of the stack */
+            munit_assert_uint64(reg->addr[0], ==, 24 + 16 + 24);
+        }
+    }
+
+    ASSERT_REGISTER_FLOAT(&spirv_sim, ID(81), ==, 5.5f + 33.7f);
+    munit_assert_uint32(spirv_sim.memory_free_start, ==, 24 + 16);
+
+    /* clean-up */
+    spirv_sim_shutdown(&spirv_sim);
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
+static void validation_binary(SPIRV_binary *spirv_bin, int variant) {
+/* if/else where the merge block uses values from before the branch (valid) or from one of the branches (invalid) */
+    spirv_bin_init(spirv_bin, 1, 0);
+
+    spirv_common_header(spirv_bin);
+    spirv_common_types(spirv_bin, TEST_TYPE_FLOAT32 | TEST_TYPE_INT32);
+    SPIRV_OP(spirv_bin, SpvOpTypeBool, ID(16));
+    SPIRV_OP(spirv_bin, SpvOpTypePointer, ID(17), SpvStorageClassOutput, ID(10));
+    SPIRV_OP(spirv_bin, SpvOpConstant, ID(10), ID(40), FLOAT(2.0f));
+    SPIRV_OP(spirv_bin, SpvOpConstant, ID(10), ID(41), FLOAT(3.0f));
+    SPIRV_OP(spirv_bin, SpvOpConstant, ID(20), ID(42), 7);
+    SPIRV_OP(spirv_bin, SpvOpVariable, ID(17), ID(43), SpvStorageClassOutput);
+    spirv_common_function_header_main(spirv_bin);
+    SPIRV_OP(spirv_bin, SpvOpFMul, ID(10), ID(50), ID(40), ID(41));
+    SPIRV_OP(spirv_bin, SpvOpFOrdLessThan, ID(16), ID(51), ID(40), ID(41));
+    SPIRV_OP(spirv_bin, SpvOpSelectionMerge, ID(60), SpvSelectionControlMaskNone);
+    SPIRV_OP(spirv_bin, SpvOpBranchConditional, ID(51), ID(61), ID(62));
+    SPIRV_OP(spirv_bin, SpvOpLabel, ID(61));
+    SPIRV_OP(spirv_bin, SpvOpFAdd, ID(10), ID(52), ID(50), (variant == 2) ? ID(42) : ID(41));
+    SPIRV_OP(spirv_bin, SpvOpStore, ID(43), ID(52));
+    SPIRV_OP(spirv_bin, SpvOpBranch, ID(60));
+    SPIRV_OP(spirv_bin, SpvOpLabel, ID(62));
+    SPIRV_OP(spirv_bin, SpvOpStore, ID(43), ID(40));
+    SPIRV_OP(spirv_bin, SpvOpBranch, ID(60));
+    SPIRV_OP(spirv_bin, SpvOpLabel, ID(60));
+    SPIRV_OP(spirv_bin, SpvOpFSub, ID(10), ID(53), (variant == 1) ? ID(52) : ID(50), ID(40));
+    spirv_common_function_footer(spirv_bin);
+    spirv_bin->header.bound_ids = 70;
+    spirv_bin_finalize(spirv_bin);
+}
+
+MunitResult test_validation(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* valid function: runs without checking the instructions */
+    SPIRV_binary spirv_bin;
+    validation_binary(&spirv_bin, 0);
+
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+
+    SPIRV_simulator spirv_sim;
+    spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+    munit_assert_true(spirv_sim_use_validation(&spirv_sim));
+    munit_assert_true(spirv_sim.validated);
+    munit_assert_null(spirv_sim.error_msg);
+
+    while (!spirv_sim.finished && !spirv_sim.error_msg) {
+        spirv_sim_step(&spirv_sim);
+        munit_assert_null(spirv_sim.error_msg);
+    }
+
+    ASSERT_REGISTER_FLOAT(&spirv_sim, ID(52), ==, 2.0f * 3.0f + 3.0f);
+    ASSERT_REGISTER_FLOAT(&spirv_sim, ID(53), ==, 2.0f * 3.0f - 2.0f);
+
+    spirv_sim_shutdown(&spirv_sim);
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    /* invalid functions: reported before anything is executed */
+    const char *expected[] = {
+        NULL,
+        "[OpFSub]: the definition of %52 doesn't dominate its use",
+        "[OpFAdd]: unsupported operand type"
+    };
+
+    for (int variant = 1; variant <= 2; ++variant) {
+        validation_binary(&spirv_bin, variant);
+        spirv_module_load(&spirv_module, &spirv_bin);
+        spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+
+        munit_assert_false(spirv_sim_use_validation(&spirv_sim));
+        munit_assert_false(spirv_sim.validated);
+        munit_assert_not_null(spirv_sim.error_msg);
+        munit_assert_not_null(strstr(spirv_sim.error_msg, expected[variant]));
+
+        spirv_sim_shutdown(&spirv_sim);
+        spirv_module_free(&spirv_module);
+        spirv_bin_free(&spirv_bin);
+    }
+
+    return MUNIT_OK;
+}
+
 MunitResult test_controlflow(const MunitParameter params[], void* user_data_or_fixture) {
 
     /* prepare binary */
@@ -1125,6 +2196,73 @@ MunitResult test_GLSL_std_450_exp_power(const MunitParameter params[], void* use
     return MUNIT_OK;
 }
 
+MunitResult test_GLSL_std_450_fast_math(const MunitParameter params[], void* user_data_or_fixture) {
+
+    /* prepare binary */
+    SPIRV_binary spirv_bin;
+    spirv_bin_init(&spirv_bin, 1, 0);
+
+    spirv_common_header(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpExtInstImport, ID(1), S('G','L','S','L'), S('.','s','t','d'), S('.','4','5','0'), S(0,0,0,0));
+    spirv_common_types(&spirv_bin, TEST_TYPE_FLOAT32);
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(40), FLOAT(0.0f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(41), FLOAT(1.0f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(42), FLOAT(2.0f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(43), FLOAT(3.0f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(44), FLOAT(4.0f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(45), FLOAT(5.0f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(46), FLOAT(PI_F / 2.0f));
+    SPIRV_OP(&spirv_bin, SpvOpConstant, ID(10), ID(47), FLOAT(PI_F));
+    SPIRV_OP(&spirv_bin, SpvOpConstantComposite, ID(11), ID(51), ID(41), ID(42), ID(43), ID(44));
+    SPIRV_OP(&spirv_bin, SpvOpConstantComposite, ID(11), ID(52), ID(40), ID(43), ID(44), ID(45));
+    SPIRV_OP(&spirv_bin, SpvOpConstantComposite, ID(11), ID(53), ID(40), ID(46), ID(47), ID(41));
+    spirv_common_function_header_main(&spirv_bin);
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(80), ID(1), GLSLstd450Pow, ID(51), ID(52));
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(81), ID(1), GLSLstd450Exp, ID(51));
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(82), ID(1), GLSLstd450Log, ID(81));
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(83), ID(1), GLSLstd450Exp2, ID(51));
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(84), ID(1), GLSLstd450Log2, ID(83));
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(85), ID(1), GLSLstd450InverseSqrt, ID(51));
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(86), ID(1), GLSLstd450Sin, ID(53));
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(87), ID(1), GLSLstd450Cos, ID(53));
+    SPIRV_OP(&spirv_bin, SpvOpExtInst, ID(11), ID(88), ID(1), GLSLstd450Atan2, ID(86), ID(87));
+    spirv_common_function_footer(&spirv_bin);
+    spirv_bin.header.bound_ids = 90; 
+    spirv_bin_finalize(&spirv_bin);
+
+    /* prepare simulator */
+    SPIRV_module spirv_module;
+    spirv_module_load(&spirv_module, &spirv_bin);
+    
+    SPIRV_simulator spirv_sim;
+    spirv_sim_init(&spirv_sim, &spirv_module, SPIRV_SIM_DEFAULT_ENTRYPOINT);
+    spirv_sim.precision = SimPrecisionFast;
+
+    /* run simulator */
+    while (!spirv_sim.finished && !spirv_sim.error_msg) {
+        spirv_sim_step(&spirv_sim);
+        munit_assert_null(spirv_sim.error_msg);
+    }
+
+    /* check registers */
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 80, 1.0f, 8.0f, 81.0f, 1024.0f);
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 81, 2.718281828f, 7.389056099f, 20.085536923f, 54.598150033f);
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 82, 1.0f, 2.0f, 3.0f, 4.0f);
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 83, 2.0f, 4.0f, 8.0f, 16.0f);
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 84, 1.0f, 2.0f, 3.0f, 4.0f);
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 85, 1.0f, 0.707106781f, 0.577350269f, 0.5f);
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 86, 0.0f, 1.0f, 0.0f, 0.841470985f);
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 87, 1.0f, 0.0f, -1.0f, 0.540302306f);
+    ASSERT_REGISTER_VEC4_EQUAL(&spirv_sim, 88, 0.0f, PI_F / 2.0f, -PI_F, 1.0f);
+
+    /* clean-up */
+    spirv_sim_shutdown(&spirv_sim);
+    spirv_module_free(&spirv_module);
+    spirv_bin_free(&spirv_bin);
+
+    return MUNIT_OK;
+}
+
 MunitResult test_GLSL_std_450(const MunitParameter params[], void* user_data_or_fixture) {
 
     /* prepare binary */
@@ -1183,10 +2321,25 @@ MunitTest spirv_sim_tests[] = {
     {"/composite_float32", test_composite_float32, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/conversion", test_conversion, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/aggregate", test_aggregate, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bind_data", test_bind_data, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/interface_handle", test_interface_handle, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/load_alias", test_load_alias, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/storage_buffer", test_storage_buffer, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/guard_pages", test_guard_pages, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/guard_pages_other_faults", test_guard_pages_other_faults, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/decorations", test_decorations, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/function", test_function, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/binary_borrowed", test_binary_borrowed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/module_malformed", test_module_malformed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/module_cache", test_module_cache, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/corpus", test_corpus, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/disassembly", test_disassembly, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/memory_layout", test_memory_layout, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/validation", test_validation, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/controlflow", test_controlflow, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/ext_GLSL_std_450_basic_math", test_GLSL_std_450_basic_math, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/ext_GLSL_std_450_trig", test_GLSL_std_450_trig, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/ext_GLSL_std_450_exp_power", test_GLSL_std_450_exp_power, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/ext_GLSL_std_450_fast_math", test_GLSL_std_450_fast_math, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/ext_GLSL_std_450", test_GLSL_std_450, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};